@@ -0,0 +1,88 @@
+import argparse
+import pathlib
+import sys
+
+
+def parse_args(argv):
+    from minegauler.core import simulate
+
+    parser = argparse.ArgumentParser(description="Run headless minesweeper games")
+    parser.add_argument(
+        "-d",
+        "--difficulty",
+        default="B",
+        help="Difficulty to play (default beginner), ignored if --size is given",
+    )
+    parser.add_argument("--size", help="Custom board size, e.g. 100x100")
+    parser.add_argument("--mines", type=int, help="Mines for a custom board size")
+    parser.add_argument("--per-cell", type=int, default=1, help="Max mines per cell")
+    parser.add_argument(
+        "--no-first-success",
+        action="store_false",
+        dest="first_success",
+        help="Don't guarantee the first click is safe",
+    )
+    parser.add_argument(
+        "-s",
+        "--strategy",
+        choices=simulate.STRATEGIES,
+        default="simple",
+        help="Strategy to play with",
+    )
+    parser.add_argument(
+        "-n", "--games", type=int, default=1000, help="Number of games to play"
+    )
+    parser.add_argument(
+        "-j", "--processes", type=int, help="Worker processes (default CPU count)"
+    )
+    parser.add_argument(
+        "--batch-size", type=int, default=100, help="Games per batch sent to a worker"
+    )
+    parser.add_argument("--seed", type=int, help="Seed for reproducible runs")
+    args = parser.parse_args(argv)
+    if args.size and args.mines is None:
+        parser.error("--mines is required with --size")
+    return args
+
+
+def run():
+    sys.path.append(str(pathlib.Path(__file__).parent.parent))
+    from minegauler.core import simulate
+    from minegauler.shared.types import Difficulty
+
+    args = parse_args(sys.argv[1:])
+    kwargs = dict(
+        per_cell=args.per_cell,
+        first_success=args.first_success,
+        strategy=simulate.STRATEGIES[args.strategy],
+    )
+    if args.size:
+        x_size, y_size = (int(v) for v in args.size.lower().split("x"))
+        config = simulate.SimulationConfig(x_size, y_size, args.mines, **kwargs)
+    else:
+        config = simulate.SimulationConfig.from_difficulty(
+            Difficulty.from_str(args.difficulty), **kwargs
+        )
+
+    stats = None
+    for stats in simulate.run_simulation(
+        config,
+        args.games,
+        processes=args.processes,
+        batch_size=args.batch_size,
+        seed=args.seed,
+    ):
+        print(
+            f"\r{stats.games}/{args.games} games, "
+            f"win rate {stats.win_rate:.2%}, "
+            f"{stats.games_per_sec:.1f} games/s",
+            end="",
+            file=sys.stderr,
+        )
+    print(file=sys.stderr)
+    if stats:
+        print(stats.format_summary())
+
+
+if __name__ == "__main__":
+    run()
@@ -111,3 +111,23 @@ def read_highscore_file(file, version="1.2") -> List[hs.HighscoreStruct]:
             ret.append(hs.HighscoreStruct(**settings, **fields))
 
     return ret
+
+
+def import_highscore_file(
+    file, version="1.2", db: Optional[hs.LocalHighscoresDB] = None
+) -> int:
+    """
+    Import highscores from a legacy highscores file into the local DB.
+
+    :param file:
+        The legacy highscores file to read.
+    :param version:
+        The version of minegauler the file is from.
+    :param db:
+        Optionally specify the DB to import into, defaults to the local DB.
+    :return:
+        The number of highscores added, skipping any already present.
+    """
+    if db is None:
+        db = hs.LocalHighscoresDB()
+    return db.insert_highscores(read_highscore_file(file, version))
@@ -5,14 +5,13 @@ Entry point for the application.
 
 """
 
-# Workaround to get the mysql libcrypto and libssl libs loaded.
-import mysql.connector  # isort:skip
-
 import logging
 import sys
+import time
 
 from . import core, frontend, shared
 from ._version import __version__
+from .shared import metrics
 
 
 logger = logging.getLogger(__name__)
@@ -23,6 +22,30 @@ logging.basicConfig(
     format="%(asctime)s[%(levelname)s](%(name)s) %(message)s",
 )
 
+_phase_start = time.perf_counter()
+
+
+def _log_startup_phase(phase: str) -> None:
+    """Log the time taken by a phase of startup, since the previous phase."""
+    global _phase_start
+    now = time.perf_counter()
+    logger.info("Startup phase '%s' took %.1fms", phase, (now - _phase_start) * 1000)
+    _phase_start = now
+
+
+def _deferred_init() -> None:
+    """Initialisation that isn't needed before the first frame is shown."""
+    _log_startup_phase("show window")
+    # Post any highscores that failed to reach the server last time.
+    try:
+        shared.highscores.start_remote_uploader()
+    except Exception:
+        logger.exception("Failed to start posting highscores to remote")
+    _log_startup_phase("deferred init")
+
+
+_log_startup_phase("imports")
+
 
 read_settings = shared.read_settings_from_file()
 
@@ -36,23 +59,29 @@ else:
     gui_opts = shared.GUIOptsStruct()
 logger.debug("Game options: %s", game_opts)
 logger.debug("GUI options: %s", gui_opts)
+_log_startup_phase("read settings")
 
 
 logger.info("Starting up")
 
 # Create core controller.
 ctrlr = core.BaseController(game_opts)
+_log_startup_phase("create controller")
 # Init frontend and create controller.
 frontend.init_app()
 gui = frontend.MinegaulerGUI(ctrlr, frontend.state.State.from_opts(game_opts, gui_opts))
 # Register frontend with core controller.
 ctrlr.register_listener(gui)
+_log_startup_phase("create GUI")
 
-# Run the app.
+# Run the app, deferring anything not needed to show the window.
 logger.debug("Entering event loop")
-rc = frontend.run_app(gui)
+rc = frontend.run_app(gui, on_shown=_deferred_init)
 logger.debug("Exiting event loop")
 
+if metrics.is_enabled():
+    logger.info("Latency metrics:\n%s", metrics.format_report())
+
 
 persist_settings = shared.AllOptsStruct.from_structs(
     ctrlr.get_game_options(), gui.get_gui_opts()
@@ -15,19 +15,91 @@ Exports
 
 __all__ = ("Board", "Minefield")
 
+import array
+import bisect
+import collections
+import itertools
 import random as rnd
-from typing import Any, Collection, Dict, Iterable, List, Optional, Union
+from typing import (
+    Any,
+    Collection,
+    Dict,
+    Iterable,
+    List,
+    MutableSequence,
+    Optional,
+    Tuple,
+    Union,
+)
 
 from ..shared import utils
-from ..shared.types import CellContents, Coord_T
+from ..shared.types import CellCode, CellContents, Coord_T
+
+
+try:
+    import numpy as np
+except ImportError:  # pragma: no cover
+    np = None
+
+
+def _box_sum_py(cells: Iterable[int], x_size: int, y_size: int) -> List[int]:
+    """
+    Sum each cell's 3x3 neighbourhood (including itself) in pure Python.
+
+    The sum is separable, so rows are summed horizontally and then the
+    results of adjacent rows are added together.
+
+    :param cells:
+        The cell values in row-major order.
+    :param x_size:
+        Number of columns in the grid.
+    :param y_size:
+        Number of rows in the grid.
+    :return:
+        The summed values in row-major order.
+    """
+    cells = list(cells)
+    row_sums = []
+    for y in range(y_size):
+        padded = [0] + cells[y * x_size : (y + 1) * x_size] + [0]
+        row_sums.append([a + b + c for a, b, c in zip(padded, padded[1:], padded[2:])])
+    zero_row = [0] * x_size
+    padded = [zero_row] + row_sums + [zero_row]
+    sums = []
+    for above, row, below in zip(padded, padded[1:], padded[2:]):
+        sums.extend(a + b + c for a, b, c in zip(above, row, below))
+    return sums
+
+
+def _box_sum_numpy(cells: Iterable[int], x_size: int, y_size: int) -> List[int]:
+    """
+    Sum each cell's 3x3 neighbourhood (including itself) using numpy.
+
+    See _box_sum_py().
+    """
+    grid = np.array(cells, dtype=np.int32).reshape(y_size, x_size)
+    padded = np.pad(grid, 1)
+    sums = sum(
+        padded[dy : dy + y_size, dx : dx + x_size] for dy in range(3) for dx in range(3)
+    )
+    return sums.ravel().tolist()
+
+
+_box_sum = _box_sum_numpy if np is not None else _box_sum_py
 
 
 class Board(utils.Grid):
     """
-    Representation of a minesweeper board. To be filled with instances of
-    CellContents.
+    Representation of a minesweeper board, with each cell containing an
+    instance of CellContents.
+
+    The cells are stored in a compact array of integer codes (see CellCode),
+    which can be worked on directly via 'cells'. CellContents are only created
+    when cells are accessed by coordinate.
     """
 
+    _TYPECODE = "H"
+
     def __init__(self, x_size: int, y_size: int):
         """
         Arguments:
@@ -36,22 +108,30 @@ class Board(utils.Grid):
         y_size (int > 0)
             The number of rows.
         """
-        super().__init__(x_size, y_size, fill=CellContents.Unclicked)
+        super().__init__(x_size, y_size, fill=CellCode.UNCLICKED)
 
     def __repr__(self):
         return f"<{self.x_size}x{self.y_size} board>"
 
     def __str__(self):
-        return super().__str__(mapping={CellContents.Num(0): "."})
+        return utils.Grid.from_2d_array(list(self)).__str__(
+            mapping={CellContents.Num(0): "."}
+        )
 
-    def __getitem__(self, item: Coord_T) -> CellContents:
-        return super().__getitem__(item)
+    def __iter__(self):
+        """Iterate over the rows of the board, as CellContents."""
+        from_code = CellContents.from_code
+        for row in super().__iter__():
+            yield [from_code(c) for c in row]
+
+    def __getitem__(self, key: Coord_T) -> CellContents:
+        return CellContents.from_code(super().__getitem__(key))
 
     def __setitem__(self, key: Coord_T, value: CellContents):
         if not isinstance(value, CellContents):
             raise TypeError("Board can only contain CellContents instances")
         else:
-            super().__setitem__(key, value)
+            super().__setitem__(key, value.code)
 
     @classmethod
     def from_2d_array(cls, array: List[List[Union[str, int]]]) -> "Board":
@@ -72,30 +152,46 @@ class Board(utils.Grid):
         """
         grid = utils.Grid.from_2d_array(array)
         board = cls(grid.x_size, grid.y_size)
-        for c in grid.all_coords:
-            if type(grid[c]) is int:
-                board[c] = CellContents.Num(grid[c])
-            elif type(grid[c]) is str and len(grid[c]) == 2:
-                char, num = grid[c]
-                board[c] = CellContents.from_char(char)(int(num))
-            elif grid[c] != CellContents.Unclicked.char:
+        for i, obj in enumerate(grid.cells):
+            if type(obj) is int:
+                board.cells[i] = CellContents.Num(obj).code
+            elif type(obj) is str and len(obj) == 2:
+                char, num = obj
+                board.cells[i] = CellContents.from_char(char)(int(num)).code
+            elif obj != CellContents.Unclicked.char:
                 raise ValueError(
-                    f"Unknown cell contents representation in cell {c}: {grid[c]}"
+                    f"Unknown cell contents representation in cell "
+                    f"{grid.idx_to_coord(i)}: {obj}"
                 )
         return board
 
+    def copy(self) -> "Board":
+        """Create a copy of the board."""
+        ret = Board.__new__(Board)
+        ret.x_size = self.x_size
+        ret.y_size = self.y_size
+        ret.cells = self.cells[:]
+        return ret
+
+    def fill(self, item: CellContents):
+        """Fill the board with the given cell contents."""
+        super().fill(item.code)
+
     def reset(self):
         """Reset the board to the initial state."""
-        for c in self.all_coords:
-            self[c] = CellContents.Unclicked
+        self.fill(CellContents.Unclicked)
 
 
 class Minefield(utils.Grid):
     """
     Grid representation of a minesweeper minefield, with each cell containing
     an integer representing the number of mines in that cell.
+
+    The mine counts are stored in a compact byte array.
     """
 
+    _TYPECODE = "B"
+
     def __init__(
         self,
         x_size: int,
@@ -104,6 +200,7 @@ class Minefield(utils.Grid):
         mines: Union[int, Iterable[Coord_T]],
         per_cell: int = 1,
         safe_coords: Optional[Iterable[Coord_T]] = None,
+        seed: Optional[int] = None,
     ):
         """
         :param x_size:
@@ -119,11 +216,17 @@ class Minefield(utils.Grid):
             Optionally specify coordinates that should not contain a mine when
             filling the minefield. Ignored if a list of mine coords is passed
             in.
+        :param seed:
+            Optionally seed the random placement of mines, to allow a minefield
+            to be reproduced. Ignored if a list of mine coords is passed in.
         :raise ValueError:
-            If the number of mines is too high to fit in the grid or if a list
+            If the number of mines is too high to fit in the grid, if a list
             of mine coordinates is supplied and the number of mines in a cell
-            exceeds the max per cell value.
+            exceeds the max per cell value, or if the max per cell value is too
+            large to be stored.
         """
+        if per_cell > 255:
+            raise ValueError(f"Max per cell of {per_cell} is too large, max is 255")
         super().__init__(x_size, y_size)
         # Maximum number of mines per cell.
         self.per_cell: int = per_cell
@@ -133,33 +236,55 @@ class Minefield(utils.Grid):
         self.mine_coords: List[Coord_T]
         # The successfully completed board for the minefield.
         self.completed_board: Board
-        # Groups of cells that form the board openings.
-        self.openings: Collection[Collection[Coord_T]]
+        # Groups of cells that form the board openings, see 'openings'.
+        self._openings: Optional[List[List[Coord_T]]] = None
+        # The opening each blank cell belongs to, indexed by flat cell index,
+        #  or -1 for non-blank cells (which may border multiple openings).
+        self.opening_ids: array.array
+        # The flat indices of the cells revealed by each opening, in order.
+        self.opening_idxs: List[Tuple[int, ...]]
         # The 3bv of the minefield.
         self.bbbv: int
 
         if isinstance(mines, int):
             self.nr_mines = mines
-            mine_coords = self._choose_mine_coords(safe_coords)
+            mine_coords = self._choose_mine_coords(safe_coords, seed=seed)
         else:
             mine_coords = list(mines)
             self.nr_mines = len(mine_coords)
 
+        cells = self.cells
         for c in mine_coords:
-            if self[c] == self.per_cell:
+            if not self.is_coord_in_grid(c):
+                raise IndexError(f"Mine coordinate {c} is outside of the grid")
+            idx = self.coord_to_idx(c)
+            if cells[idx] == self.per_cell:
                 raise ValueError(
                     f"Too many mines at coord {c} with max per cell of {self.per_cell}"
                 )
-            self[c] += 1
+            cells[idx] += 1
         self.mine_coords = mine_coords
         self.completed_board = self._calc_completed_board()
-        self.openings = self._find_openings()
+        self.opening_ids, self.opening_idxs = self._find_openings()
         self.bbbv = self._calc_3bv()
 
     def __repr__(self):
         mines_str = f" with {self.nr_mines} mines" if self.nr_mines else ""
         return f"<{self.x_size}x{self.y_size} minefield{mines_str}>"
 
+    @property
+    def openings(self) -> Collection[Collection[Coord_T]]:
+        """
+        Groups of cells that form the board openings, as sorted coordinates.
+
+        These are created from 'opening_idxs' on first access.
+        """
+        if self._openings is None:
+            self._openings = [
+                sorted(map(self.idx_to_coord, opening)) for opening in self.opening_idxs
+            ]
+        return self._openings
+
     @classmethod
     def from_grid(cls, grid: utils.Grid, *, per_cell: int = 1) -> "Minefield":
         """
@@ -174,12 +299,69 @@ class Minefield(utils.Grid):
             The created minefield.
         """
         mine_coords = []
-        for c in grid.all_coords:
-            for _ in range(grid[c]):
-                mine_coords.append(c)
+        for i, num in enumerate(grid.cells):
+            if num:
+                mine_coords.extend([grid.idx_to_coord(i)] * num)
 
         return cls(grid.x_size, grid.y_size, mines=mine_coords, per_cell=per_cell)
 
+    @classmethod
+    def from_precomputed(
+        cls,
+        x_size: int,
+        y_size: int,
+        *,
+        cells: Iterable[int],
+        per_cell: int,
+        nums: Iterable[int],
+        opening_idxs: List[Tuple[int, ...]],
+        bbbv: int,
+    ) -> "Minefield":
+        """
+        Create a minefield from previously calculated board information, which
+        is trusted to be correct, skipping the calculations done on creation.
+
+        :param x_size:
+            Number of columns in the grid.
+        :param y_size:
+            Number of rows in the grid.
+        :param cells:
+            The number of mines in each cell.
+        :param per_cell:
+            Maximum number of mines per cell.
+        :param nums:
+            The number shown in each cell of the completed board.
+        :param opening_idxs:
+            The flat indices of the cells revealed by each opening, as in the
+            'opening_idxs' attribute.
+        :param bbbv:
+            The 3bv of the minefield.
+        :return:
+            The created minefield.
+        """
+        mf = cls.__new__(cls)
+        mf.x_size = x_size
+        mf.y_size = y_size
+        mf.cells = mf._make_buffer(items=cells)
+        mf.per_cell = per_cell
+        mf.nr_mines = sum(mf.cells)
+        mf.mine_coords = []
+        for i, n in enumerate(mf.cells):
+            if n:
+                mf.mine_coords.extend([mf.idx_to_coord(i)] * n)
+        mf.completed_board = mf._make_completed_board(nums)
+        blank = CellCode.BLANK
+        board_cells = mf.completed_board.cells
+        mf.opening_ids = array.array("l", [-1]) * len(mf.cells)
+        for label, opening in enumerate(opening_idxs):
+            for i in opening:
+                if board_cells[i] == blank:
+                    mf.opening_ids[i] = label
+        mf.opening_idxs = opening_idxs
+        mf._openings = None
+        mf.bbbv = bbbv
+        return mf
+
     @classmethod
     def from_2d_array(cls, array: List[List[int]], *, per_cell: int = 1) -> "Minefield":
         """
@@ -220,40 +402,78 @@ class Minefield(utils.Grid):
         )
 
     def _choose_mine_coords(
-        self, safe_coords: Optional[Iterable[Coord_T]] = None
+        self,
+        safe_coords: Optional[Iterable[Coord_T]] = None,
+        *,
+        seed: Optional[int] = None,
     ) -> List[Coord_T]:
         """
         Randomly choose coordinates for mines to be in.
 
+        Each available cell provides 'per_cell' slots for mines, and the
+        required number of slots are sampled without building the full list of
+        slots. Sparse boards only pay for the mines placed, while dense boards
+        instead sample the slots that are left empty.
+
         :param safe_coords:
             Optionally specify coordinates that should not contain a mine when
             filling the minefield. Ignored if a list of mine coords is passed
             in.
+        :param seed:
+            Optionally seed the random choice of mine coords.
         :return:
             A list of randomly chosen mine coords.
         :raise ValueError:
             If the number of mines is too high to fit in the grid.
         """
-        safe_coords = set(safe_coords) if safe_coords else None
+        rng = rnd.Random(seed)
+        nr_cells = len(self.cells)
+        if safe_coords:
+            safe_idxs = sorted(
+                {self.coord_to_idx(c) for c in safe_coords if self.is_coord_in_grid(c)}
+            )
+        else:
+            safe_idxs = []
         self.check_enough_space(
             x_size=self.x_size,
             y_size=self.y_size,
             mines=self.nr_mines,
             per_cell=self.per_cell,
-            nr_safe_cells=len(safe_coords) if safe_coords else 1,
+            nr_safe_cells=len(safe_idxs) if safe_idxs else 1,
         )
+        # Make sure there is at least one safe cell.
+        if not safe_idxs:
+            safe_idxs = [rng.randrange(nr_cells)]
 
-        # Get a list of coordinates which can have mines placed in them.
-        if safe_coords is None:
-            avble_coords = self.all_coords.copy()
+        # Mine slots are numbered such that slot // per_cell gives the position
+        #  of the cell among those available (skipping safe cells).
+        per_cell = self.per_cell
+        nr_slots = (nr_cells - len(safe_idxs)) * per_cell
+        mine_coords = []
+        if 2 * self.nr_mines <= nr_slots:
+            # Sparse - only sample the slots containing mines.
+            for slot in rng.sample(range(nr_slots), self.nr_mines):
+                # Map the position among available cells to a cell index by
+                #  stepping over the safe cells that come before it.
+                idx = slot // per_cell
+                skip = bisect.bisect_right(safe_idxs, idx)
+                while skip < len(safe_idxs) and safe_idxs[skip] <= idx + skip:
+                    skip += 1
+                mine_coords.append(self.idx_to_coord(idx + skip))
         else:
-            avble_coords = [c for c in self.all_coords if c not in safe_coords]
-        # Make sure there is at least one safe cell.
-        if len(avble_coords) == len(self.all_coords):
-            avble_coords.pop(rnd.randint(0, len(avble_coords) - 1))
-        avble_coords *= self.per_cell
-        rnd.shuffle(avble_coords)
-        return avble_coords[: self.nr_mines]
+            # Dense - sample the slots left empty and fill the rest.
+            empty_slots = rng.sample(range(nr_slots), nr_slots - self.nr_mines)
+            empty_per_cell = collections.Counter(s // per_cell for s in empty_slots)
+            safe_idxs = set(safe_idxs)
+            rank = 0
+            for idx in range(nr_cells):
+                if idx in safe_idxs:
+                    continue
+                nr_mines = per_cell - empty_per_cell[rank]
+                rank += 1
+                if nr_mines:
+                    mine_coords.extend([self.idx_to_coord(idx)] * nr_mines)
+        return mine_coords
 
     @staticmethod
     def check_enough_space(
@@ -293,59 +513,273 @@ class Minefield(utils.Grid):
         """
         return self[coord] > 0
 
+    def relocate_mines(
+        self, safe_coords: Iterable[Coord_T], *, seed: Optional[int] = None
+    ) -> None:
+        """
+        Move any mines out of the given cells, to randomly chosen free slots in
+        other cells, updating the completed board, openings and 3bv in place.
+
+        This is equivalent to having created the minefield with the safe
+        coordinates, since the mine slots outside of the safe cells remain
+        uniformly chosen. Only the board information around the moved mines is
+        recalculated, so this is much cheaper than creating a new minefield.
+
+        :param safe_coords:
+            The coordinates that should not contain a mine.
+        :param seed:
+            Optionally seed the random choice of new mine positions.
+        :raise ValueError:
+            If the number of mines is too high to fit outside the safe cells.
+        """
+        safe_idxs = {
+            self.coord_to_idx(c) for c in safe_coords if self.is_coord_in_grid(c)
+        }
+        self.check_enough_space(
+            x_size=self.x_size,
+            y_size=self.y_size,
+            mines=self.nr_mines,
+            per_cell=self.per_cell,
+            nr_safe_cells=len(safe_idxs),
+        )
+        cells = self.cells
+        nr_moved = sum(cells[i] for i in safe_idxs)
+        if not nr_moved:
+            return
+        rng = rnd.Random(seed)
+        per_cell = self.per_cell
+        nr_cells = len(cells)
+        nbr_table = self.nbr_table
+        moved_from = [i for i in safe_idxs if cells[i]]
+
+        # Choose the new mine slots. The first 'cells[i]' slots of each cell are
+        #  taken, so picking a random free slot outside of the safe cells keeps
+        #  the placement uniform.
+        free_slots = (nr_cells - len(safe_idxs)) * per_cell - (
+            self.nr_mines - nr_moved
+        )
+        moved_to = []
+        if 4 * free_slots >= nr_cells * per_cell:
+            # Plenty of space - sample random slots, rejecting taken slots.
+            while len(moved_to) < nr_moved:
+                idx, slot = divmod(rng.randrange(nr_cells * per_cell), per_cell)
+                if idx not in safe_idxs and slot >= cells[idx]:
+                    cells[idx] += 1
+                    moved_to.append(idx)
+        else:
+            slots = [
+                i
+                for i in range(nr_cells)
+                if i not in safe_idxs
+                for _ in range(per_cell - cells[i])
+            ]
+            for idx in rng.sample(slots, nr_moved):
+                cells[idx] += 1
+                moved_to.append(idx)
+        for i in moved_from:
+            cells[i] = 0
+        self.mine_coords = [
+            c for c in self.mine_coords if self.coord_to_idx(c) not in safe_idxs
+        ] + [self.idx_to_coord(i) for i in moved_to]
+
+        # The cells whose number may have changed, and the cells whose 3bv
+        #  contribution may have changed due to a neighbour becoming blank or
+        #  not.
+        changed = set()
+        for i in itertools.chain(moved_from, moved_to):
+            changed.update(nbr_table.nbrs_incl_origin(i))
+        region = set()
+        for i in changed:
+            region.update(nbr_table.nbrs_incl_origin(i))
+        old_openings = {self.opening_ids[i] for i in region if self.opening_ids[i] >= 0}
+        old_isolated = sum(map(self._is_isolated_cell, region))
+
+        # Patch the completed board.
+        blank = CellCode.BLANK
+        board_cells = self.completed_board.cells
+        for i in changed:
+            if cells[i]:
+                board_cells[i] = CellCode.make(CellCode.FLAG, cells[i])
+            else:
+                board_cells[i] = CellCode.make(
+                    CellCode.NUM, sum(cells[j] for j in nbr_table.nbrs(i))
+                )
+
+        # Recreate the openings that were touched, reusing their ids.
+        opening_ids = self.opening_ids
+        seeds = [i for i in changed if board_cells[i] == blank]
+        for label in old_openings:
+            for i in self.opening_idxs[label]:
+                if opening_ids[i] == label:
+                    opening_ids[i] = -1
+                    if board_cells[i] == blank:
+                        seeds.append(i)
+        for i in changed:
+            opening_ids[i] = -1
+        free_labels = sorted(old_openings, reverse=True)
+        last_opening = collections.defaultdict(lambda: -1)
+        new_label = -2  # Temporary labels, to avoid clashing with existing ids
+        new_openings = []
+        for i in seeds:
+            if board_cells[i] == blank and opening_ids[i] == -1:
+                new_openings.append(
+                    self._fill_opening(i, new_label, opening_ids, last_opening)
+                )
+                new_label -= 1
+        for j, opening in enumerate(new_openings):
+            if free_labels:
+                label = free_labels.pop()
+                self.opening_idxs[label] = opening
+            else:
+                label = len(self.opening_idxs)
+                self.opening_idxs.append(opening)
+            for i in opening:
+                if opening_ids[i] == -2 - j:
+                    opening_ids[i] = label
+        # Fill any unused ids by moving the last openings down.
+        for label in sorted(free_labels):
+            while len(self.opening_idxs) - 1 in free_labels:
+                free_labels.remove(len(self.opening_idxs) - 1)
+                self.opening_idxs.pop()
+            if label >= len(self.opening_idxs):
+                break
+            free_labels.remove(label)
+            last = len(self.opening_idxs) - 1
+            opening = self.opening_idxs.pop()
+            self.opening_idxs[label] = opening
+            for i in opening:
+                if opening_ids[i] == last:
+                    opening_ids[i] = label
+        self._openings = None
+
+        self.bbbv += (
+            len(new_openings)
+            - len(old_openings)
+            + sum(map(self._is_isolated_cell, region))
+            - old_isolated
+        )
+
+    def _is_isolated_cell(self, idx: int) -> bool:
+        """
+        Whether a cell is safe and not revealed by any opening, so needs its
+        own click. Only the completed board is used.
+        """
+        blank = CellCode.BLANK
+        board_cells = self.completed_board.cells
+        return (
+            board_cells[idx] & CellCode.KIND_MASK == CellCode.NUM
+            and board_cells[idx] != blank
+            and all(board_cells[i] != blank for i in self.nbr_table.nbrs(idx))
+        )
+
     def _calc_completed_board(self) -> Board:
         """
         Create the completed board with the flags and numbers that should be
         seen upon game completion.
         """
+        # The neighbourhood sum includes the cell itself, but this is only
+        #  non-zero for mine cells, which don't display a number.
+        return self._make_completed_board(
+            _box_sum(self.cells, self.x_size, self.y_size)
+        )
+
+    def _make_completed_board(self, nums: Iterable[int]) -> Board:
+        """
+        Create the completed board from the number to display in each cell.
+
+        :param nums:
+            The number of neighbouring mines for each cell, ignored for cells
+            containing mines.
+        """
+        mines = self.cells
         completed_board = Board(self.x_size, self.y_size)
-        completed_board.fill(CellContents.Num(0))
-        for c in self.all_coords:
-            mines = self[c]
-            if mines > 0:
-                completed_board[c] = CellContents.Flag(mines)
-                for nbr in self.get_nbrs(c):
-                    # For neighbouring cells that don't contain mines, increment
-                    #  their number.
-                    if not self.cell_contains_mine(nbr):
-                        completed_board[nbr] += mines
+        # Mine cells are flagged, others display the number of neighbouring
+        #  mines.
+        flags = [None] + [
+            CellCode.make(CellCode.FLAG, m) for m in range(1, self.per_cell + 1)
+        ]
+        numbers = [CellCode.make(CellCode.NUM, n) for n in range(9 * self.per_cell + 1)]
+        completed_board.cells = completed_board._make_buffer(
+            items=[flags[m] if m else numbers[n] for m, n in zip(mines, nums)]
+        )
         return completed_board
 
-    def _find_openings(self) -> List[List[Coord_T]]:
+    def _find_openings(self) -> Tuple[array.array, List[Tuple[int, ...]]]:
         """
         Find the openings of the board.
 
-        A list of openings is stored, each represented as a list of
-        coordinates belonging to that opening. Note that each cell
-        cannot belong to multiple openings.
+        Blank cells are labelled with the opening they belong to in a single
+        pass over the completed board. Each opening is also stored as the
+        sorted flat indices of all cells it reveals, including the numbered
+        cells on its border - these may belong to multiple openings.
+
+        :return:
+            A tuple of the per-cell opening ids (-1 for non-blank cells) and
+            the cells revealed by each opening.
         """
+        blank = CellCode.BLANK
+        board_cells = self.completed_board.cells
+        opening_ids = array.array("l", [-1]) * len(board_cells)
+        # The last opening each border cell was added to, to avoid duplicates.
+        last_opening = array.array("l", [-1]) * len(board_cells)
         openings = []
-        blanks_to_check = {
-            c for c in self.all_coords if self.completed_board[c] is CellContents.Num(0)
-        }
-        while blanks_to_check:
-            orig_coord = blanks_to_check.pop()
-            # If the coordinate is part of an opening and hasn't already been
-            #  considered, start a new opening.
-            opening = {orig_coord}  # Coords belonging to the opening
-            check = {orig_coord}  # Coords whose neighbours need checking
-            while check:
-                coord = check.pop()
-                nbrs = set(self.get_nbrs(coord))
-                check |= {
-                    c
-                    for c in nbrs - opening
-                    if self.completed_board[c] is CellContents.Num(0)
-                }
-                opening |= nbrs
-            openings.append(sorted(opening))
-            blanks_to_check -= opening
-        return openings
+        for orig_idx, code in enumerate(board_cells):
+            if code != blank or opening_ids[orig_idx] >= 0:
+                continue
+            # The cell is part of an opening that hasn't already been
+            #  considered, so start a new opening.
+            openings.append(
+                self._fill_opening(orig_idx, len(openings), opening_ids, last_opening)
+            )
+        return opening_ids, openings
+
+    def _fill_opening(
+        self,
+        orig_idx: int,
+        label: int,
+        opening_ids: MutableSequence[int],
+        last_opening: MutableSequence[int],
+    ) -> Tuple[int, ...]:
+        """
+        Flood-fill the opening containing a blank cell.
+
+        :param orig_idx:
+            The blank cell to start from.
+        :param label:
+            The id to label the opening's blank cells with in 'opening_ids'.
+        :param opening_ids:
+            The per-cell opening ids, updated in place.
+        :param last_opening:
+            The last opening each border cell was added to, updated in place.
+        :return:
+            The sorted flat indices of the cells revealed by the opening.
+        """
+        blank = CellCode.BLANK
+        board_cells = self.completed_board.cells
+        nbr_table = self.nbr_table
+        opening_ids[orig_idx] = label
+        opening = [orig_idx]  # Cells belonging to the opening
+        check = [orig_idx]  # Blank cells whose neighbours need checking
+        while check:
+            for i in nbr_table.nbrs(check.pop()):
+                if board_cells[i] == blank:
+                    if opening_ids[i] != label:
+                        opening_ids[i] = label
+                        opening.append(i)
+                        check.append(i)
+                elif last_opening[i] != label:
+                    last_opening[i] = label
+                    opening.append(i)
+        return tuple(sorted(opening))
 
     def _calc_3bv(self) -> int:
         """Calculate the 3bv of the board."""
-        assert self.openings is not None
-        clicks = len(self.openings)
-        exposed = len({c for opening in self.openings for c in opening})
-        clicks += self.x_size * self.y_size - len(set(self.mine_coords)) - exposed
+        assert self.opening_idxs is not None
+        clicks = len(self.opening_idxs)
+        exposed = bytearray(len(self.cells))
+        for opening in self.opening_idxs:
+            for i in opening:
+                exposed[i] = 1
+        mine_cells = len(self.cells) - self.cells.count(0)
+        clicks += len(self.cells) - mine_cells - sum(exposed)
         return clicks
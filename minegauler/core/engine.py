@@ -13,13 +13,14 @@ Exports
 __all__ = ("BaseController",)
 
 import abc
-import json
+import concurrent.futures
 import logging
 import os
-from typing import Dict, Optional
+from typing import Dict, Optional, Tuple
 
 import attr
 
+from ..shared import metrics
 from ..shared.types import (
     CellContents,
     Coord_T,
@@ -29,12 +30,35 @@ from ..shared.types import (
     UIMode,
 )
 from ..shared.utils import GameOptsStruct, Grid
-from . import api, game
+from . import api, game, mgb
 from .board import Board, Minefield
 
 
 logger = logging.getLogger(__name__)
 
+_MinefieldKey_T = Tuple[int, int, int, int]
+
+# Single worker thread for creating minefields in the background, created on
+#  first use.
+_pregen_executor: Optional[concurrent.futures.ThreadPoolExecutor] = None
+
+
+def _get_pregen_executor() -> concurrent.futures.ThreadPoolExecutor:
+    """Get the executor for creating minefields in the background."""
+    global _pregen_executor
+    if _pregen_executor is None:
+        _pregen_executor = concurrent.futures.ThreadPoolExecutor(
+            max_workers=1, thread_name_prefix="minefield-pregen"
+        )
+    return _pregen_executor
+
+
+def _generate_minefield(
+    x_size: int, y_size: int, mines: int, per_cell: int
+) -> Minefield:
+    """Create a random minefield, run in the background worker."""
+    return Minefield(x_size, y_size, mines=mines, per_cell=per_cell)
+
 
 def _save_minefield(mf: Minefield, file: PathLike) -> None:
     """
@@ -49,8 +73,7 @@ def _save_minefield(mf: Minefield, file: PathLike) -> None:
     """
     if os.path.isfile(file):
         logger.warning("Overwriting file at %s", file)
-    with open(file, "w") as f:
-        json.dump(mf.to_json(), f)
+    mgb.save_minefield(mf, file)
 
 
 @attr.attrs(auto_attribs=True, kw_only=True)
@@ -60,8 +83,8 @@ class _SharedInfo:
     
     Elements:
     cell_updates
-        Dictionary of updates to cells, mapping the coordinate to the new
-        contents of the cell.
+        Dictionary of updates to cells, mapping the coordinate to the code
+        for the new contents of the cell (see CellCode).
     game_state
         The state of the game.
     mines_remaining
@@ -72,7 +95,7 @@ class _SharedInfo:
         The number of lives remaining.
     """
 
-    cell_updates: Optional[Dict[Coord_T, CellContents]] = None
+    cell_updates: Optional[Dict[Coord_T, int]] = None
     game_state: GameState = GameState.READY
     mines_remaining: int = 0
     lives_remaining: int = 0
@@ -191,14 +214,21 @@ class _GameController(_AbstractSubController):
             lives=self._opts.lives,
             first_success=self._opts.first_success,
         )
+        # The minefield being created in the background for the next game,
+        #  along with the board options it is being created for.
+        self._pregen: Optional[
+            Tuple[_MinefieldKey_T, concurrent.futures.Future]
+        ] = None
         self._last_update = _SharedInfo()
         self._send_updates()
         self._notif.set_mines(self._opts.mines)
+        self._start_pregen()
 
     @property
     def board(self) -> Board:
         return self._game.board
 
+    @metrics.timed("engine.get_game_info")
     def get_game_info(self) -> api.GameInfo:
         """Get info about the current game."""
         ret = api.GameInfo(
@@ -250,6 +280,7 @@ class _GameController(_AbstractSubController):
             first_success=self._opts.first_success,
         )
         self._send_reset_update()
+        self._start_pregen()
 
     def restart_game(self) -> None:
         """See AbstractController."""
@@ -262,8 +293,13 @@ class _GameController(_AbstractSubController):
     def select_cell(self, coord: Coord_T) -> None:
         """See AbstractController."""
         super().select_cell(coord)
+        if not (self._game.state.started() or self._game.mf or self._game.pregenerated):
+            self._game.pregenerated = self._take_pregen()
         cells = self._game.select_cell(coord)
         self._send_updates(cells)
+        if self._game.state.started():
+            # Create the next game's minefield while this game is played.
+            self._start_pregen()
 
     def flag_cell(self, coord: Coord_T, *, flag_only: bool = False) -> None:
         """See AbstractController."""
@@ -280,13 +316,13 @@ class _GameController(_AbstractSubController):
             else:
                 self._game.set_cell_flags(coord, cell_state.num + 1)
 
-        self._send_updates({coord: self._game.board[coord]})
+        self._send_updates(self._get_cell_update(coord))
 
     def remove_cell_flags(self, coord: Coord_T) -> None:
         """See AbstractController."""
         super().remove_cell_flags(coord)
         self._game.set_cell_flags(coord, 0)
-        self._send_updates({coord: self._game.board[coord]})
+        self._send_updates(self._get_cell_update(coord))
 
     def chord_on_cell(self, coord: Coord_T) -> None:
         """See AbstractController."""
@@ -320,6 +356,7 @@ class _GameController(_AbstractSubController):
         self._opts.x_size = x_size
         self._opts.y_size = y_size
         self._opts.mines = mines
+        self._discard_pregen()
 
         self._game = game.Game(
             x_size=self._opts.x_size,
@@ -330,6 +367,7 @@ class _GameController(_AbstractSubController):
             first_success=self._opts.first_success,
         )
         self._send_resize_update()
+        self._start_pregen()
 
     def set_first_success(self, value: bool) -> None:
         """
@@ -349,12 +387,16 @@ class _GameController(_AbstractSubController):
             raise ValueError(
                 f"Max number of mines per cell must be at least 1, got {value}"
             )
+        if value != self._opts.per_cell:
+            self._discard_pregen()
         self._opts.per_cell = value
         # If the game is not started and the minefiels is not known then the
         # new per-cell value should be picked up immediately, and the board
         # cleared of any flags (e.g. 3-flag cells may no longer be allowed!).
         if not (self._game.state.started() or self._game.minefield_known):
             self.new_game()
+        else:
+            self._start_pregen()
 
     def save_current_minefield(self, file: PathLike) -> None:
         """
@@ -381,8 +423,7 @@ class _GameController(_AbstractSubController):
             The location of the file to load from. Should have the extension
             ".mgb".
         """
-        with open(file) as f:
-            mf = Minefield.from_json(json.load(f))
+        mf = mgb.load_minefield(file)
 
         logger.debug(
             "Loaded minefield from file (%d x %d, %d mines)",
@@ -395,10 +436,69 @@ class _GameController(_AbstractSubController):
         self._opts.mines = mf.nr_mines
         self._game = game.Game(minefield=mf, lives=self._opts.lives)
         self._send_resize_update()
+        self._start_pregen()
 
     # --------------------------------------------------------------------------
     # Helper methods
     # --------------------------------------------------------------------------
+    def _get_pregen_key(self) -> _MinefieldKey_T:
+        """Get the board options that a pregenerated minefield must match."""
+        return (
+            self._opts.x_size,
+            self._opts.y_size,
+            self._opts.mines,
+            self._opts.per_cell,
+        )
+
+    def _start_pregen(self) -> None:
+        """
+        Start creating a minefield for the next game in the background, unless
+        one is already being created for the current options.
+        """
+        key = self._get_pregen_key()
+        if self._pregen is not None:
+            if self._pregen[0] == key:
+                return
+            self._discard_pregen()
+        x_size, y_size, mines, per_cell = key
+        try:
+            Minefield.check_enough_space(
+                x_size=x_size, y_size=y_size, mines=mines, per_cell=per_cell
+            )
+        except ValueError:
+            return
+        logger.debug("Starting creation of minefield for next game in background")
+        future = _get_pregen_executor().submit(_generate_minefield, *key)
+        self._pregen = (key, future)
+
+    def _discard_pregen(self) -> None:
+        """Discard any minefield being created for the next game."""
+        if self._pregen is not None:
+            logger.debug("Discarding pregenerated minefield")
+            self._pregen[1].cancel()
+            self._pregen = None
+
+    def _take_pregen(self) -> Optional[Minefield]:
+        """
+        Take the minefield created in the background, waiting for it to be
+        completed if required.
+
+        :return:
+            The minefield, or None if there isn't one for the current options.
+        """
+        if self._pregen is None:
+            return None
+        key, future = self._pregen
+        self._pregen = None
+        if key != self._get_pregen_key():
+            future.cancel()
+            return None
+        try:
+            return future.result()
+        except Exception:
+            logger.exception("Failed to create minefield in the background")
+            return None
+
     def _send_reset_update(self) -> None:
         """Send an update to reset the board."""
         self._notif.reset()
@@ -410,10 +510,18 @@ class _GameController(_AbstractSubController):
         self._notif.set_mines(self._opts.mines)
         self._send_updates()
 
-    def _send_updates(
-        self, cells_updated: Optional[Dict[Coord_T, CellContents]] = None
-    ) -> None:
-        """Send updates to registered listeners."""
+    def _get_cell_update(self, coord: Coord_T) -> Dict[Coord_T, int]:
+        """Get an update containing the current code for a cell."""
+        board = self._game.board
+        return {coord: board.cells[board.coord_to_idx(coord)]}
+
+    def _send_updates(self, cells_updated: Optional[Dict[Coord_T, int]] = None) -> None:
+        """
+        Send updates to registered listeners.
+
+        Cell updates are passed in as codes, and only converted to CellContents
+        here for the listeners.
+        """
         update = _SharedInfo(
             cell_updates=cells_updated,
             mines_remaining=self._game.mines_remaining,
@@ -423,7 +531,10 @@ class _GameController(_AbstractSubController):
 
         # Send updates to registered listeners.
         if update.cell_updates:
-            self._notif.update_cells(update.cell_updates)
+            from_code = CellContents.from_code
+            self._notif.update_cells(
+                {c: from_code(code) for c, code in update.cell_updates.items()}
+            )
         if update.mines_remaining != self._last_update.mines_remaining:
             self._notif.update_mines_remaining(update.mines_remaining)
         # if update.lives_remaining != self._last_update.lives_remaining:
@@ -12,18 +12,37 @@ Exports
 
 __all__ = ("Game", "GameNotStartedError")
 
+import array
 import functools
 import logging
 import math
 import time as tm
-from typing import Callable, Dict, Iterable, Optional, Union
-
-from ..shared.types import CellContents, CellContents_T, Coord_T, Difficulty, GameState
+from typing import Callable, Dict, Iterable, List, Optional, Set, Union
+
+from ..shared import metrics
+from ..shared.types import (
+    CellCode,
+    CellContents,
+    CellContents_T,
+    Coord_T,
+    Difficulty,
+    GameState,
+)
 from .board import Board, Minefield
 
 
 logger = logging.getLogger(__name__)
 
+# Cell codes used on the hot path, bound here for fast lookup.
+_KIND_BITS = CellCode.KIND_BITS
+_KIND_MASK = CellCode.KIND_MASK
+_UNCLICKED = CellCode.UNCLICKED
+_NUM = CellCode.NUM
+_BLANK = CellCode.BLANK
+_MINE = CellCode.MINE
+_HIT_MINE = CellCode.HIT_MINE
+_FLAG = CellCode.FLAG
+
 
 def _check_coord(method: Callable) -> Callable:
     """
@@ -62,14 +81,16 @@ def _ignore_decorator_helper(conditions_sense, game_state, cell_state) -> Callab
             cell_states = [cell_state]
         else:
             cell_states = cell_state
+        # Match the cell states by their kind of cell code.
+        cell_kinds = frozenset(s.kind for s in cell_states)
 
         @functools.wraps(method)
         def wrapped(game: "Game", coord: Coord_T = None, *args, **kwargs):
             conditions = [any(game.state is s for s in game_states)]
-            if cell_states:
-                conditions.append(
-                    any(game.board[coord].is_type(s) for s in cell_states)
-                )
+            if cell_kinds:
+                board = game.board
+                code = board.cells[board.coord_to_idx(coord)]
+                conditions.append(code & _KIND_MASK in cell_kinds)
 
             # fmt: off
             if (
@@ -142,6 +163,127 @@ class GameNotStartedError(Exception):
     """Game has not been started, so no minefield has been created."""
 
 
+class _RemainingBBBVTracker:
+    """
+    Incremental tracker of the remaining 3bv of a game.
+
+    The remaining 3bv is the number of remaining openings (groups of connected
+    unrevealed blank cells) plus the number of unrevealed safe cells that have
+    no unrevealed blank neighbours.
+
+    Cells are passed in as they are revealed, updating the counts locally. The
+    number of groups within an opening is only recounted on the next read, and
+    only for openings that were touched, so reads are O(1) when idle.
+    """
+
+    def __init__(self, mf: Minefield, board: Board):
+        """
+        :param mf:
+            The minefield of the game.
+        :param board:
+            The current board, used to catch up with already-revealed cells.
+        """
+        mines = mf.cells
+        completed = mf.completed_board.cells
+        nbr_table = mf.nbr_table
+        nr_cells = len(mines)
+        self._nbr_table = nbr_table
+        self._mines = mines
+        self._revealed = bytearray(nr_cells)
+        # The opening each blank cell belongs to, or -1 for non-blank cells.
+        self._opening_of = mf.opening_ids
+        # The blank cells in each opening.
+        self._opening_blanks: List[List[int]] = [
+            [i for i in opening if completed[i] == _BLANK]
+            for opening in mf.opening_idxs
+        ]
+        # Number of unrevealed blank cells in each opening.
+        self._unrevealed_blanks = [len(b) for b in self._opening_blanks]
+        # Number of separate groups each opening has been split into.
+        self._opening_groups = [1] * len(self._opening_blanks)
+        self._rem_openings: int = len(self._opening_blanks)
+        # Openings that need their groups recounting.
+        self._dirty_openings: Set[int] = set()
+        # Number of unrevealed blank neighbours of each cell.
+        self._blank_nbrs = array.array("l", [0]) * nr_cells
+        for blanks in self._opening_blanks:
+            for i in blanks:
+                for j in nbr_table.nbrs(i):
+                    self._blank_nbrs[j] += 1
+        # Unrevealed safe cells that each require their own click.
+        self._isolated: int = sum(
+            1
+            for i in range(nr_cells)
+            if not mines[i] and self._opening_of[i] < 0 and not self._blank_nbrs[i]
+        )
+
+        for i, code in enumerate(board.cells):
+            if code & _KIND_MASK == _NUM:
+                self.reveal(i)
+
+    def reveal(self, idx: int) -> None:
+        """
+        Update the tracker for a safe cell being revealed.
+
+        :param idx:
+            The flat index of the revealed cell.
+        """
+        if self._revealed[idx]:
+            return
+        self._revealed[idx] = 1
+        opening = self._opening_of[idx]
+        if opening < 0:
+            if not self._blank_nbrs[idx]:
+                self._isolated -= 1
+            return
+
+        self._unrevealed_blanks[opening] -= 1
+        self._dirty_openings.add(opening)
+        blank_nbrs = self._blank_nbrs
+        for j in self._nbr_table.nbrs(idx):
+            blank_nbrs[j] -= 1
+            if (
+                not blank_nbrs[j]
+                and not self._revealed[j]
+                and not self._mines[j]
+                and self._opening_of[j] < 0
+            ):
+                self._isolated += 1
+
+    def get_rem_3bv(self) -> int:
+        """Get the remaining 3bv."""
+        for opening in self._dirty_openings:
+            groups = self._count_groups(opening)
+            self._rem_openings += groups - self._opening_groups[opening]
+            self._opening_groups[opening] = groups
+        self._dirty_openings.clear()
+        return self._rem_openings + self._isolated
+
+    def _count_groups(self, opening: int) -> int:
+        """Count the groups of connected unrevealed blank cells in an opening."""
+        if self._unrevealed_blanks[opening] == 0:
+            return 0
+        elif self._unrevealed_blanks[opening] == len(self._opening_blanks[opening]):
+            return 1
+        revealed = self._revealed
+        nbr_table = self._nbr_table
+        opening_of = self._opening_of
+        groups = 0
+        seen = set()
+        for orig_idx in self._opening_blanks[opening]:
+            if revealed[orig_idx] or orig_idx in seen:
+                continue
+            groups += 1
+            seen.add(orig_idx)
+            check = [orig_idx]
+            while check:
+                for i in nbr_table.nbrs(check.pop()):
+                    if opening_of[i] == opening and not revealed[i] and i not in seen:
+                        seen.add(i)
+                        check.append(i)
+        return groups
+
+
 class Game:
     """
     A minesweeper game, storing a minefield and the state of a game, including
@@ -159,6 +301,7 @@ class Game:
         lives: int = 1,
         first_success: bool = False,
         minefield: Optional[Minefield] = None,
+        seed: Optional[int] = None,
     ):
         """
         :param x_size:
@@ -183,6 +326,9 @@ class Game:
         :param minefield:
             A minefield to use for the game. Takes precedence over various other
             arguments, see above.
+        :param seed:
+            Optionally seed the random creation of the minefield, to allow a
+            game to be reproduced. Ignored if a minefield is passed in.
         :raise ValueError:
             If the number of mines is too high to fit in the grid.
         """
@@ -212,14 +358,23 @@ class Game:
         self.per_cell: int = per_cell
         self.lives: int = lives
         self.first_success: bool = first_success
+        self.seed: Optional[int] = seed
+        # A minefield created in advance to use when the game starts, which has
+        #  mines moved out of the way of the first click as required.
+        self.pregenerated: Optional[Minefield] = None
         self.board: Board = Board(x_size, y_size)
         self.start_time: Optional[float] = None
         self.end_time: Optional[float] = None
         self.state: GameState = GameState.READY
         self.mines_remaining: int = self.mines
         self.lives_remaining: int = self.lives
-        self._cell_updates: Dict[Coord_T, CellContents] = dict()
+        # Codes of the cells updated by the current action, see CellCode.
+        self._cell_updates: Dict[Coord_T, int] = dict()
         self._num_flags: int = 0
+        # Number of safe cells still to be revealed, counted once the
+        #  minefield is known.
+        self._unrevealed_safe: Optional[int] = None
+        self._bbbv_tracker: Optional[_RemainingBBBVTracker] = None
 
     @property
     def difficulty(self) -> Difficulty:
@@ -236,26 +391,11 @@ class Game:
         elif self.state is GameState.WON:
             return 0
         else:
-            partial_mf = Minefield.from_grid(self.mf, per_cell=self.per_cell)
-            # Replace any openings already found with normal clicks (ones).
-            for c in self.board.all_coords:
-                if type(self.board[c]) is CellContents.Num:
-                    partial_mf.completed_board[c] = CellContents.Num(1)
-            # Find the openings which remain.
-            partial_mf.openings = partial_mf._find_openings()
-            rem_opening_coords = {c for opening in partial_mf.openings for c in opening}
-            # Count the number of essential clicks that have already been
-            # done by counting clicked cells minus the ones at the edge of
-            # an undiscovered opening.
-            completed_3bv = len(
-                {
-                    c
-                    for c in self.board.all_coords
-                    if type(self.board[c]) is CellContents.Num
-                }
-                - rem_opening_coords
-            )
-            return partial_mf._calc_3bv() - completed_3bv
+            if self._bbbv_tracker is None:
+                # Only start tracking on first use, catching up with any cells
+                #  already revealed.
+                self._bbbv_tracker = _RemainingBBBVTracker(self.mf, self.board)
+            return self._bbbv_tracker.get_rem_3bv()
 
     def get_prop_complete(self) -> float:
         """Calculate the progress of solving the board using 3bv."""
@@ -308,7 +448,31 @@ class Game:
 
     def _create_minefield(self, coord: Coord_T) -> None:
         """Create the minefield in response to a cell being selected."""
-        if self.first_success:
+        mf, self.pregenerated = self.pregenerated, None
+        if mf and (mf.x_size, mf.y_size, mf.nr_mines, mf.per_cell) != (
+            self.x_size,
+            self.y_size,
+            self.mines,
+            self.per_cell,
+        ):
+            logger.warning("Ignoring pregenerated minefield that doesn't match game")
+            mf = None
+        if mf:
+            logger.debug("Using pregenerated minefield")
+            self.mf = mf
+            if self.first_success:
+                try:
+                    mf.relocate_mines(
+                        self.board.get_nbrs(coord, include_origin=True),
+                        seed=self.seed,
+                    )
+                except ValueError:
+                    logger.info(
+                        "Unable to give opening on the first click, "
+                        "still ensuring a safe click"
+                    )
+                    mf.relocate_mines([coord], seed=self.seed)
+        elif self.first_success:
             safe_coords = self.board.get_nbrs(coord, include_origin=True)
             logger.debug(
                 "Trying to create minefield with the following safe coordinates: %s",
@@ -321,6 +485,7 @@ class Game:
                     mines=self.mines,
                     per_cell=self.per_cell,
                     safe_coords=safe_coords,
+                    seed=self.seed,
                 )
             except ValueError:
                 logger.info(
@@ -334,34 +499,52 @@ class Game:
                     mines=self.mines,
                     per_cell=self.per_cell,
                     safe_coords=[coord],
+                    seed=self.seed,
                 )
             else:
                 logger.debug("Successfully created minefield")
         else:
             logger.debug("Creating minefield without guaranteed first click success")
             self.mf = Minefield(
-                self.x_size, self.y_size, mines=self.mines, per_cell=self.per_cell
+                self.x_size,
+                self.y_size,
+                mines=self.mines,
+                per_cell=self.per_cell,
+                seed=self.seed,
             )
 
-    def _set_cell(self, coord: Coord_T, state: CellContents):
+    def _set_cell(self, coord: Coord_T, code: int):
         """
         Set the contents of a cell and store the update.
 
         :param coord:
             The coordinate of the cell to set.
-        :param state:
-            The state to set the cell to.
+        :param code:
+            The code for the contents to set the cell to, see CellCode.
         """
-        self.board[coord] = state
-        self._cell_updates[coord] = state
+        idx = self.board.coord_to_idx(coord)
+        if code & _KIND_MASK == _NUM:
+            if self._unrevealed_safe is not None and (
+                self.board.cells[idx] & _KIND_MASK != _NUM
+            ):
+                self._unrevealed_safe -= 1
+            if self._bbbv_tracker is not None:
+                self._bbbv_tracker.reveal(idx)
+        self.board.cells[idx] = code
+        self._cell_updates[coord] = code
 
     def _select_cell_action(self, coord: Coord_T) -> None:
         """
         Implementation of the action of selecting/clicking a cell.
         """
-        if self.mf.cell_contains_mine(coord):
+        board_cells = self.board.cells
+        completed_cells = self.mf.completed_board.cells
+        orig_idx = self.board.coord_to_idx(coord)
+        if self.mf.cells[orig_idx]:
             logger.debug("Mine hit at %s", coord)
-            self._set_cell(coord, CellContents.HitMine(self.mf[coord]))
+            self._set_cell(
+                coord, CellCode.make(CellCode.HIT_MINE, self.mf.cells[orig_idx])
+            )
             self.lives_remaining -= 1
 
             if self.lives_remaining == 0:
@@ -369,100 +552,94 @@ class Game:
                 self.end_time = tm.time()
                 self.state = GameState.LOST
 
-                for c in self.mf.all_coords:
-                    if (
-                        self.mf.cell_contains_mine(c)
-                        and self.board[c] is CellContents.Unclicked
-                    ):
-                        self._set_cell(c, CellContents.Mine(self.mf[c]))
-
-                    elif (
-                        type(self.board[c]) is CellContents.Flag
-                        and self.board[c] != self.mf.completed_board[c]
-                    ):
-                        self._set_cell(c, CellContents.WrongFlag(self.board[c].num))
+                for i, mines in enumerate(self.mf.cells):
+                    code = board_cells[i]
+                    if mines and code == _UNCLICKED:
+                        self._set_cell(
+                            self.board.idx_to_coord(i),
+                            CellCode.make(CellCode.MINE, mines),
+                        )
+                    elif code & _KIND_MASK == _FLAG and code != completed_cells[i]:
+                        self._set_cell(
+                            self.board.idx_to_coord(i),
+                            CellCode.make(CellCode.WRONG_FLAG, CellCode.num(code)),
+                        )
             else:
-                self.mines_remaining -= self.mf[coord]
-        elif self.mf.completed_board[coord] is CellContents.Num(0):
-            for full_opening in self.mf.openings:
-                if coord in full_opening:
-                    # Found the opening, quit the loop here.
-                    logger.debug("Opening hit: %s", full_opening)
-                    break
+                self.mines_remaining -= self.mf.cells[orig_idx]
+        elif completed_cells[orig_idx] == _BLANK:
+            full_opening = self.mf.opening_idxs[self.mf.opening_ids[orig_idx]]
+            logger.debug("Opening hit at %s", coord)
+
+            if all(board_cells[i] == _UNCLICKED for i in full_opening):
+                # None of the opening revealed or flagged, so reveal all of it.
+                opening = full_opening
             else:
-                logger.error(
-                    "Coordinate %s not found in openings %s", coord, self.mf.openings
-                )
-
-            # Get the propagation of cells forming part of the opening.
-            opening = set()  # Coords belonging to the opening
-            check = {coord}  # Coords whose neighbours need checking
-            while check:
-                c = check.pop()
-                unclicked_nbrs = {
-                    z
-                    for z in self.board.get_nbrs(c, include_origin=True)
-                    if self.board[z] is CellContents.Unclicked
-                }
-                check |= {
-                    z
-                    for z in unclicked_nbrs - opening
-                    if self.mf.completed_board[z] is CellContents.Num(0)
-                }
-                opening |= unclicked_nbrs
-
-            logger.debug("Propagated opening: %s", list(opening))
-            bad_opening_cells = {}
-            for c in opening:
-                if self.board[c] is CellContents.Unclicked:
-                    self._set_cell(c, self.mf.completed_board[c])
-                else:
-                    bad_opening_cells[c] = self.board[c]
-            if bad_opening_cells:
-                logger.error(
-                    "Should only have clicked cells in opening, found: %s",
-                    bad_opening_cells,
-                )
+                # Get the propagation of cells forming part of the opening,
+                #  which stops at flagged and revealed cells, since a flag may
+                #  have split the opening into separate pockets.
+                nbr_table = self.board.nbr_table
+                opening = {orig_idx}  # Cells belonging to the opening
+                check = [orig_idx]  # Blank cells whose neighbours need checking
+                while check:
+                    for i in nbr_table.nbrs(check.pop()):
+                        if i in opening or board_cells[i] != _UNCLICKED:
+                            continue
+                        opening.add(i)
+                        if completed_cells[i] == _BLANK:
+                            check.append(i)
+
+            logger.debug("Propagated opening: %s cells", len(opening))
+            for i in opening:
+                self._set_cell(self.board.idx_to_coord(i), completed_cells[i])
         else:
             logger.debug("Regular cell revealed")
-            self._set_cell(coord, self.mf.completed_board[coord])
+            self._set_cell(coord, completed_cells[orig_idx])
 
     def _check_for_completion(self) -> None:
         """
-        Check if game is complete by comparing the board to the minefield's
-        completed board. If it is, display flags in remaining unclicked cells.
+        Check if game is complete by checking whether any safe cells remain
+        unrevealed. If it is, display flags in remaining unclicked cells.
         """
-        # Assume (for contradiction) that game is complete.
-        is_complete = True
-        for c in self.mf.all_coords:
-            exp_val = self.mf.completed_board[c]
-            if type(exp_val) is CellContents.Num and exp_val != self.board[c]:
-                is_complete = False
-                break
-
-        if is_complete:
-            logger.info("Game won")
-
-            self.end_time = tm.time()
-            self.state = GameState.WON
-            self.mines_remaining = 0
-
-            for c in self.mf.all_coords:
-                if (
-                    self.mf.cell_contains_mine(c)
-                    and type(self.board[c]) is not CellContents.HitMine
-                ):
-                    self._set_cell(c, CellContents.Flag(self.mf[c]))
+        if self._unrevealed_safe is None:
+            # Count on first use, after which the count is kept up to date as
+            #  cells are revealed.
+            self._unrevealed_safe = self.mf.cells.count(0) - sum(
+                1 for c in self.board.cells if c & _KIND_MASK == _NUM
+            )
+        if self._unrevealed_safe > 0:
+            return
+
+        logger.info("Game won")
+
+        self.end_time = tm.time()
+        self.state = GameState.WON
+        self.mines_remaining = 0
+
+        # Flag all the mines in one pass, leaving any that were hit.
+        board_cells = self.board.cells
+        updates = dict()
+        for c in dict.fromkeys(self.mf.mine_coords):
+            idx = self.board.coord_to_idx(c)
+            if board_cells[idx] & _KIND_MASK != _HIT_MINE:
+                board_cells[idx] = updates[c] = CellCode.make(
+                    _FLAG, self.mf.cells[idx]
+                )
+        self._cell_updates.update(updates)
 
+    @metrics.timed("game.select_cell")
     @_check_coord
     @_ignore_if_not(
         game_state=(GameState.READY, GameState.ACTIVE),
         cell_state=CellContents.Unclicked,
     )
-    def select_cell(self, coord: Coord_T) -> Dict[Coord_T, CellContents]:
+    def select_cell(self, coord: Coord_T) -> Dict[Coord_T, int]:
         """
         Perform the action of selecting/clicking a cell. Game must be started
         before calling this method.
+
+        :return:
+            The updated cells, mapped to the codes of their new contents (see
+            CellCode).
         """
         just_started = False
         if self.state is GameState.READY:
@@ -486,23 +663,20 @@ class Game:
         game_state=(GameState.READY, GameState.ACTIVE),
         cell_state=(CellContents.Flag, CellContents.Unclicked),
     )
-    def set_cell_flags(
-        self, coord: Coord_T, nr_flags: int
-    ) -> Dict[Coord_T, CellContents]:
-        """Set the number of flags in a cell."""
+    def set_cell_flags(self, coord: Coord_T, nr_flags: int) -> Dict[Coord_T, int]:
+        """Set the number of flags in a cell, returning the updated cell codes."""
         if nr_flags < 0 or nr_flags > self.per_cell:
             raise ValueError(
                 f"Invalid number of flags ({nr_flags}) - should be between 0 and "
                 f"{self.per_cell}"
             )
 
-        old_nr_flags = (
-            0 if self.board[coord] is CellContents.Unclicked else self.board[coord].num
-        )
+        # The number of an unclicked cell's code is zero.
+        old_nr_flags = CellCode.num(self.board.cells[self.board.coord_to_idx(coord)])
         if nr_flags == 0:
-            self._set_cell(coord, CellContents.Unclicked)
+            self._set_cell(coord, _UNCLICKED)
         else:
-            self._set_cell(coord, CellContents.Flag(nr_flags))
+            self._set_cell(coord, CellCode.make(CellCode.FLAG, nr_flags))
         self.mines_remaining += old_nr_flags - nr_flags
         self._num_flags += nr_flags - old_nr_flags
 
@@ -511,13 +685,24 @@ class Game:
         finally:
             self._cell_updates = dict()
 
+    @metrics.timed("game.chord_on_cell")
     @_check_coord
     @_ignore_if_not(game_state=GameState.ACTIVE, cell_state=CellContents.Num)
-    def chord_on_cell(self, coord: Coord_T) -> Dict[Coord_T, CellContents]:
-        """Chord on a cell that contains a revealed number."""
-        nbrs = self.board.get_nbrs(coord)
+    def chord_on_cell(self, coord: Coord_T) -> Dict[Coord_T, int]:
+        """
+        Chord on a cell that contains a revealed number, returning the updated
+        cell codes.
+        """
+        board_cells = self.board.cells
+        idx = self.board.coord_to_idx(coord)
+        nbrs = self.board.get_nbr_idxs(idx)
+        # Mine-type kinds come last, so these are the cells with flags or mines.
         num_flagged_nbrs = sum(
-            [self.board[c].num for c in nbrs if self.board[c].is_mine_type()]
+            [
+                board_cells[i] >> _KIND_BITS
+                for i in nbrs
+                if board_cells[i] & _KIND_MASK >= _MINE
+            ]
         )
         logger.debug(
             "%s flagged mine(s) around clicked cell showing number %s",
@@ -525,9 +710,11 @@ class Game:
             self.board[coord],
         )
 
-        unclicked_nbrs = [c for c in nbrs if self.board[c] is CellContents.Unclicked]
+        unclicked_nbrs = [
+            self.board.idx_to_coord(i) for i in nbrs if board_cells[i] == _UNCLICKED
+        ]
         if (
-            self.board[coord] != CellContents.Num(num_flagged_nbrs)
+            board_cells[idx] != CellCode.make(CellCode.NUM, num_flagged_nbrs)
             or not unclicked_nbrs
         ):
             return dict()
@@ -0,0 +1,205 @@
+# October 2020, Lewis Gaul
+
+"""
+Streaming of the game being played to the server, for live spectating.
+
+Exports
+-------
+.. class:: LiveStreamListener
+    Listener that streams the game being played to the server.
+
+"""
+
+__all__ = ("LiveStreamListener",)
+
+import logging
+import secrets
+import threading
+import time
+from typing import TYPE_CHECKING, Dict, Optional
+
+from ..shared.live import LiveEncoder
+from ..shared.types import CellContents, Coord_T, GameState, UIMode
+from . import api
+from .board import Board
+
+
+if TYPE_CHECKING:
+    import requests
+
+
+logger = logging.getLogger(__name__)
+
+_LIVE_URL = "http://minegauler.lewisgaul.co.uk/api/v1/live"
+
+
+class LiveStreamListener(api.AbstractListener):
+    """
+    Streams the game being played to the server, from which it can be
+    watched live.
+
+    Cell updates are encoded as they are received, and a single background
+    thread posts them to the server in batches of at most one per frame over a
+    persistent HTTP session. If posting a batch fails, the next batch is a
+    keyframe so that spectators don't miss any updates.
+    """
+
+    FRAME_INTERVAL = 1 / 30
+    MAX_BACKOFF = 60
+
+    def __init__(
+        self,
+        board: Board,
+        *,
+        player: str,
+        elapsed: float = 0,
+        url: str = _LIVE_URL,
+    ):
+        """
+        :param board:
+            The current board.
+        :param player:
+            The name of the player, which spectators can find the game by.
+        :param elapsed:
+            The elapsed time of the current game, if it has started.
+        :param url:
+            The URL of the server's live games API.
+        """
+        self.game_id: str = secrets.token_urlsafe(12)
+        self.player: str = player
+        self._url = f"{url}/{self.game_id}"
+        self._lock = threading.Lock()
+        self._wakeup = threading.Event()
+        self._stop = threading.Event()
+        self._encoder = LiveEncoder(board.x_size, board.y_size)
+        self._start_time: Optional[float] = None
+        if elapsed:
+            self._start_time = time.monotonic() - elapsed
+            self._encoder.add_event(elapsed, {c: board[c] for c in board.all_coords})
+        self._thread = threading.Thread(
+            target=self._run, name="live-stream", daemon=True
+        )
+
+    def start(self) -> None:
+        """Start streaming."""
+        logger.info("Starting live stream of game %s", self.game_id)
+        self._thread.start()
+
+    def stop(self) -> None:
+        """Stop streaming, ending the game's stream on the server."""
+        logger.info("Stopping live stream of game %s", self.game_id)
+        self._stop.set()
+        self._wakeup.set()
+
+    def _add_metadata(self, **metadata) -> None:
+        with self._lock:
+            self._encoder.add_metadata(metadata)
+        self._wakeup.set()
+
+    def _new_game(
+        self, x_size: Optional[int] = None, y_size: Optional[int] = None
+    ) -> None:
+        """Start a new game, keeping the board size if not given."""
+        with self._lock:
+            if x_size is None:
+                x_size, y_size = self._encoder.x_size, self._encoder.y_size
+            self._encoder.new_game(x_size, y_size)
+            self._start_time = None
+        self._wakeup.set()
+
+    # --------------------------------------------------------------------------
+    # Listener methods
+    # --------------------------------------------------------------------------
+    def reset(self) -> None:
+        self._new_game()
+
+    def resize_minefield(self, x_size: int, y_size: int) -> None:
+        self._new_game(x_size, y_size)
+
+    def set_mines(self, mines: int) -> None:
+        self._add_metadata(mines=mines)
+
+    def update_cells(self, cell_updates: Dict[Coord_T, CellContents]) -> None:
+        now = time.monotonic()
+        with self._lock:
+            if self._start_time is None:
+                self._start_time = now
+            self._encoder.add_event(now - self._start_time, cell_updates)
+        self._wakeup.set()
+
+    def update_game_state(self, game_state: GameState) -> None:
+        self._add_metadata(state=game_state.name)
+
+    def update_mines_remaining(self, mines_remaining: int) -> None:
+        self._add_metadata(mines_remaining=mines_remaining)
+
+    def ui_mode_changed(self, mode: UIMode) -> None:
+        self._add_metadata(mode=mode.name)
+
+    def handle_exception(self, method: str, exc: Exception) -> None:
+        logger.error(
+            "Error occurred when calling %s() on live stream listener:\n%s", method, exc
+        )
+
+    # --------------------------------------------------------------------------
+    # Sending
+    # --------------------------------------------------------------------------
+    def _run(self) -> None:
+        import requests
+
+        session = requests.Session()
+        session.headers["Content-Type"] = "application/octet-stream"
+        last_sent = 0
+        backoff = 0
+        while not self._stop.is_set():
+            self._wakeup.wait()
+            # Wait for the rest of the frame, to batch the updates made in it.
+            time.sleep(max(0, last_sent + self.FRAME_INTERVAL - time.monotonic()))
+            self._wakeup.clear()
+            if self._stop.is_set():
+                break
+            with self._lock:
+                batch = self._encoder.flush()
+            if batch is None:
+                continue
+            last_sent = time.monotonic()
+            try:
+                self._post_batch(session, batch)
+            except requests.RequestException as e:
+                backoff = min(max(2 * backoff, 1), self.MAX_BACKOFF)
+                logger.warning(
+                    "Failed to post live game update, retrying in %ds: %s", backoff, e
+                )
+                with self._lock:
+                    self._encoder.request_keyframe()
+                # Updates don't cut the wait short, but stopping does.
+                if self._stop.wait(backoff):
+                    break
+                self._wakeup.set()
+            else:
+                backoff = 0
+
+        try:
+            session.delete(self._url, timeout=5)
+        except requests.RequestException as e:
+            logger.warning("Failed to end live stream: %s", e)
+        session.close()
+
+    def _post_batch(self, session: "requests.Session", batch: bytes) -> None:
+        """
+        Post a batch to the server.
+
+        :raise requests.RequestException:
+            If posting failed.
+        """
+        response = session.post(
+            self._url, data=batch, params={"player": self.player}, timeout=5
+        )
+        if response.status_code == 409:
+            # The server needs a keyframe, e.g. because it was restarted.
+            logger.debug("Server requested a live stream keyframe")
+            with self._lock:
+                self._encoder.request_keyframe()
+            self._wakeup.set()
+            return
+        response.raise_for_status()
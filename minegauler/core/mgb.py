@@ -0,0 +1,286 @@
+# October 2020, Lewis Gaul
+
+"""
+Reading and writing minefield (.mgb) files.
+
+There are two versions of the file format:
+ - Version 1 is JSON, as produced by Minefield.to_json(). These files can
+   still be loaded, but are no longer written.
+ - Version 2 is binary, described below.
+
+All integers in the version 2 format are little-endian. The file starts with
+a fixed-size header:
+ - The 4-byte magic string b"\\x89MGB".
+ - The format version (u8).
+ - Flags (u8), with bit 0 set if precomputed board information is included.
+ - The max number of mines per cell (u8), followed by a padding byte.
+ - The x_size, y_size, 3bv and number of openings (u32 each). The 3bv and
+   openings are zero if precomputed information is not included.
+
+The header is followed by the number of mines in each cell, in flat cell
+order. These are packed into 2 bits per cell (4 cells per byte, starting with
+the least significant bits) when per_cell is at most 3, otherwise one byte is
+used per cell.
+
+If the precomputed flag is set, this is followed by:
+ - The number shown in each cell of the completed board, using one byte per
+   cell (u16 if per_cell is too large for a byte), with zero for mine cells.
+ - The number of cells in each opening (u32 each).
+ - The flat indices of the cells in each opening, concatenated (u32 each).
+
+Files are read by memory-mapping, only decoding the sections needed.
+
+Exports
+-------
+.. function:: load_minefield
+    Load a minefield from a file in any supported format.
+
+.. function:: save_minefield
+    Save a minefield to a file in the binary format.
+
+"""
+
+__all__ = ("load_minefield", "save_minefield")
+
+import array
+import itertools
+import json
+import logging
+import mmap
+import struct
+import sys
+from typing import Union
+
+from ..shared.types import CellCode, PathLike
+from .board import Minefield
+
+
+logger = logging.getLogger(__name__)
+
+MAGIC = b"\x89MGB"
+VERSION = 2
+
+_HEADER = struct.Struct("<4sBBBxIIII")
+_FLAG_PRECOMPUTED = 0x01
+
+# Lookup table for unpacking a byte of 2-bit cells into a byte per cell.
+_UNPACK_2BIT = [
+    bytes((b >> shift) & 0b11 for shift in range(0, 8, 2)) for b in range(256)
+]
+
+
+def _packs_2bit(per_cell: int) -> bool:
+    """Whether mine counts are packed into 2 bits per cell."""
+    return per_cell <= 3
+
+
+def _nums_typecode(per_cell: int) -> str:
+    """The array typecode used for the completed board numbers."""
+    return "B" if 8 * per_cell <= 0xFF else "H"
+
+
+def _to_le_bytes(arr: array.array) -> bytes:
+    """Convert an array to little-endian bytes."""
+    if sys.byteorder == "big" and arr.itemsize > 1:
+        arr = array.array(arr.typecode, arr)
+        arr.byteswap()
+    return arr.tobytes()
+
+
+def _from_le_bytes(typecode: str, data: bytes) -> array.array:
+    """Create an array from little-endian bytes."""
+    arr = array.array(typecode)
+    arr.frombytes(data)
+    if sys.byteorder == "big" and arr.itemsize > 1:
+        arr.byteswap()
+    return arr
+
+
+def _u32_array(items=()) -> array.array:
+    """Create an array of unsigned 32-bit integers."""
+    typecode = "I" if array.array("I").itemsize == 4 else "L"
+    return array.array(typecode, items)
+
+
+def _pack_cells(cells: bytes, per_cell: int) -> bytes:
+    """Pack the number of mines in each cell."""
+    if not _packs_2bit(per_cell):
+        return bytes(cells)
+    # Pad to a multiple of 4 cells, filling the final byte.
+    cells = bytes(cells) + bytes(-len(cells) % 4)
+    return bytes(
+        a | b << 2 | c << 4 | d << 6
+        for a, b, c, d in zip(cells[0::4], cells[1::4], cells[2::4], cells[3::4])
+    )
+
+
+def _unpack_cells(data: bytes, nr_cells: int, per_cell: int) -> bytes:
+    """Unpack the number of mines in each cell."""
+    if not _packs_2bit(per_cell):
+        return data
+    return b"".join(map(_UNPACK_2BIT.__getitem__, data))[:nr_cells]
+
+
+def save_minefield(
+    mf: Minefield, file: PathLike, *, include_precomputed: bool = True
+) -> None:
+    """
+    Save a minefield to file in the binary format.
+
+    :param mf:
+        The minefield to save.
+    :param file:
+        The path of the file to save at.
+    :param include_precomputed:
+        Whether to include the completed board, openings and 3bv, so that they
+        don't need to be recalculated on load.
+    :raise OSError:
+        If saving to file fails.
+    """
+    nr_cells = mf.x_size * mf.y_size
+    flags = 0
+    sections = [_pack_cells(mf.cells.tobytes(), mf.per_cell)]
+    if include_precomputed:
+        flags |= _FLAG_PRECOMPUTED
+        nums = array.array(
+            _nums_typecode(mf.per_cell),
+            (
+                CellCode.num(c) if c & CellCode.KIND_MASK == CellCode.NUM else 0
+                for c in mf.completed_board.cells
+            ),
+        )
+        sections.append(_to_le_bytes(nums))
+        sections.append(_to_le_bytes(_u32_array(map(len, mf.opening_idxs))))
+        sections.append(
+            _to_le_bytes(_u32_array(itertools.chain.from_iterable(mf.opening_idxs)))
+        )
+    header = _HEADER.pack(
+        MAGIC,
+        VERSION,
+        flags,
+        mf.per_cell,
+        mf.x_size,
+        mf.y_size,
+        mf.bbbv if include_precomputed else 0,
+        len(mf.opening_idxs) if include_precomputed else 0,
+    )
+    logger.debug(
+        "Saving %d cell minefield to %s (%s precomputed info)",
+        nr_cells,
+        file,
+        "with" if include_precomputed else "without",
+    )
+    with open(file, "wb") as f:
+        f.write(header)
+        for section in sections:
+            f.write(section)
+
+
+def _decode(buf: Union[bytes, mmap.mmap], *, use_precomputed: bool) -> Minefield:
+    """
+    Decode a minefield in the binary format.
+
+    :param buf:
+        The buffer containing the encoded minefield, which supports slicing.
+    :param use_precomputed:
+        Whether to use any precomputed board information rather than
+        recalculating it.
+    :raise ValueError:
+        If the encoding is invalid.
+    """
+
+    def read(nr_bytes: int) -> bytes:
+        nonlocal offset
+        if offset + nr_bytes > len(buf):
+            raise ValueError("Minefield file is truncated")
+        data = buf[offset : offset + nr_bytes]
+        offset += nr_bytes
+        return data
+
+    offset = 0
+    (
+        magic,
+        version,
+        flags,
+        per_cell,
+        x_size,
+        y_size,
+        bbbv,
+        nr_openings,
+    ) = _HEADER.unpack(read(_HEADER.size))
+    if magic != MAGIC:
+        raise ValueError("Not a binary minefield file")
+    if version != VERSION:
+        raise ValueError(f"Unsupported minefield file version {version}")
+    if x_size == 0 or y_size == 0 or per_cell == 0:
+        raise ValueError("Invalid minefield dimensions in file")
+
+    nr_cells = x_size * y_size
+    if _packs_2bit(per_cell):
+        cells_len = (nr_cells + 3) // 4
+    else:
+        cells_len = nr_cells
+    cells = _unpack_cells(read(cells_len), nr_cells, per_cell)
+    if max(cells) > per_cell:
+        raise ValueError(f"Cell contains more than {per_cell} mines")
+
+    if not (use_precomputed and flags & _FLAG_PRECOMPUTED):
+        mine_coords = [
+            (i % x_size, i // x_size) for i, n in enumerate(cells) for _ in range(n)
+        ]
+        return Minefield(x_size, y_size, mines=mine_coords, per_cell=per_cell)
+
+    nums_typecode = _nums_typecode(per_cell)
+    nums = _from_le_bytes(
+        nums_typecode, read(nr_cells * array.array(nums_typecode).itemsize)
+    )
+    u32_size = _u32_array().itemsize
+    lengths = _from_le_bytes(_u32_array().typecode, read(nr_openings * u32_size))
+    idxs = _from_le_bytes(_u32_array().typecode, read(sum(lengths) * u32_size))
+    if any(i >= nr_cells for i in idxs):
+        raise ValueError("Opening cell index out of range")
+    opening_idxs = []
+    start = 0
+    for length in lengths:
+        opening_idxs.append(tuple(idxs[start : start + length]))
+        start += length
+    return Minefield.from_precomputed(
+        x_size,
+        y_size,
+        cells=cells,
+        per_cell=per_cell,
+        nums=nums,
+        opening_idxs=opening_idxs,
+        bbbv=bbbv,
+    )
+
+
+def load_minefield(file: PathLike, *, use_precomputed: bool = True) -> Minefield:
+    """
+    Load a minefield from file, in either the binary or legacy JSON format.
+
+    :param file:
+        The path of the file to load.
+    :param use_precomputed:
+        Whether to use any precomputed board information in the file rather
+        than recalculating it.
+    :return:
+        The loaded minefield.
+    :raise OSError:
+        If reading the file fails.
+    :raise ValueError:
+        If the file contents are invalid.
+    """
+    with open(file, "rb") as f:
+        is_binary = f.read(len(MAGIC)) == MAGIC
+        if is_binary:
+            with mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_READ) as mm:
+                mf = _decode(mm, use_precomputed=use_precomputed)
+    if not is_binary:
+        logger.debug("Loading minefield from legacy JSON file %s", file)
+        with open(file) as f:
+            try:
+                mf = Minefield.from_json(json.load(f))
+            except json.JSONDecodeError as e:
+                raise ValueError("Invalid minefield file") from e
+    return mf
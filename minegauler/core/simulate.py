@@ -0,0 +1,461 @@
+# October 2020, Lewis Gaul
+
+"""
+Headless game simulation, for running large numbers of automated games.
+
+Games are played by a strategy directly on a Game instance, without a
+controller or any listeners, and are fanned out across a pool of worker
+processes. Aggregate statistics are streamed back as each batch of games
+completes.
+
+Exports
+-------
+.. class:: Strategy
+    Abstract base class for a strategy that plays a game.
+
+.. class:: RandomStrategy
+    Strategy that selects cells at random.
+
+.. class:: SimpleStrategy
+    Strategy that makes trivial deductions, guessing when stuck.
+
+.. class:: SafestStrategy
+    Strategy that selects the cell least likely to contain a mine.
+
+.. class:: SimulationConfig
+    Settings for the games to simulate.
+
+.. class:: GameResult
+    The result of a single simulated game.
+
+.. class:: SimulationStats
+    Aggregate statistics over a number of simulated games.
+
+.. data:: STRATEGIES
+    The available strategies, by name.
+
+.. function:: play_game
+    Play a single game with a strategy.
+
+.. function:: run_simulation
+    Run a number of games, yielding aggregate statistics as they complete.
+
+"""
+
+__all__ = (
+    "GameResult",
+    "RandomStrategy",
+    "STRATEGIES",
+    "SafestStrategy",
+    "SimpleStrategy",
+    "SimulationConfig",
+    "SimulationStats",
+    "Strategy",
+    "play_game",
+    "run_simulation",
+)
+
+import abc
+import collections
+import logging
+import math
+import multiprocessing
+import os
+import random
+import time as tm
+from typing import Dict, Iterator, Optional, Tuple
+
+import attr
+
+from ..shared.types import CellCode, CellContents, Coord_T, Difficulty, GameState
+from .game import Game
+from .solver import ProbabilitySolver
+
+
+logger = logging.getLogger(__name__)
+
+
+class Strategy(metaclass=abc.ABCMeta):
+    """
+    A strategy for playing a game.
+
+    Strategies are passed to worker processes, so must be picklable (e.g. an
+    instance of a class defined at module level).
+    """
+
+    name: str
+
+    @abc.abstractmethod
+    def play(self, game: Game, rng: random.Random) -> None:
+        """
+        Play a game until it is finished.
+
+        :param game:
+            The game to play, which has not yet been started.
+        :param rng:
+            The random number generator to use for any random choices, so that
+            games can be reproduced.
+        """
+        raise NotImplementedError
+
+
+class RandomStrategy(Strategy):
+    """Select unclicked cells at random until the game ends."""
+
+    name = "random"
+
+    def play(self, game: Game, rng: random.Random) -> None:
+        coords = list(game.board.all_coords)
+        rng.shuffle(coords)
+        for c in coords:
+            if game.state.finished():
+                break
+            if game.board[c] is CellContents.Unclicked:
+                game.select_cell(c)
+
+
+class SimpleStrategy(Strategy):
+    """
+    Make trivial deductions from each revealed number, guessing at random when
+    no deduction can be made.
+
+    A number with all of its mines flagged is chorded, and a number whose
+    unclicked neighbours must all be full of mines has them flagged.
+    """
+
+    name = "simple"
+
+    def play(self, game: Game, rng: random.Random) -> None:
+        board = game.board
+        cells = board.cells
+        while not game.state.finished():
+            if not self._make_deductions(game):
+                unclicked = [i for i, c in enumerate(cells) if c == CellCode.UNCLICKED]
+                game.select_cell(board.idx_to_coord(rng.choice(unclicked)))
+
+    @staticmethod
+    def _make_deductions(game: Game) -> bool:
+        """
+        Make a pass over the board, acting on any trivial deductions.
+
+        :return:
+            Whether any progress was made.
+        """
+        board = game.board
+        cells = board.cells
+        kind_bits, kind_mask = CellCode.KIND_BITS, CellCode.KIND_MASK
+        mine = CellCode.MINE
+        progress = False
+        for idx, code in enumerate(cells):
+            if game.state.finished():
+                break
+            if code & kind_mask != CellCode.NUM or code == CellCode.BLANK:
+                continue
+            nbrs = board.get_nbr_idxs(idx)
+            unclicked = [i for i in nbrs if cells[i] == CellCode.UNCLICKED]
+            if not unclicked:
+                continue
+            # Mine-type kinds come last, so these are the cells with flags or
+            #  mines.
+            rem_mines = (code >> kind_bits) - sum(
+                cells[i] >> kind_bits for i in nbrs if cells[i] & kind_mask >= mine
+            )
+            if rem_mines == 0:
+                game.chord_on_cell(board.idx_to_coord(idx))
+                progress = True
+            elif rem_mines == len(unclicked) * game.per_cell:
+                for i in unclicked:
+                    game.set_cell_flags(board.idx_to_coord(i), game.per_cell)
+                progress = True
+        return progress
+
+
+class SafestStrategy(Strategy):
+    """
+    Select the unclicked cell with the lowest probability of containing a mine,
+    as calculated by the probability solver, choosing at random between equally
+    safe cells.
+
+    All cells known to be safe are selected before recalculating.
+    """
+
+    name = "safest"
+
+    def play(self, game: Game, rng: random.Random) -> None:
+        board = game.board
+        solver = ProbabilitySolver(board, mines=game.mines, per_cell=game.per_cell)
+        solver.update(game.select_cell(rng.choice(board.all_coords)))
+        while not game.state.finished():
+            probs = solver.get_frontier_probabilities()
+            safe = [c for c, p in probs.items() if p == 0]
+            if safe:
+                for c in safe:
+                    if game.state.finished():
+                        break
+                    if board[c] is CellContents.Unclicked:
+                        solver.update(game.select_cell(c))
+                continue
+            interior_prob = solver.get_interior_probability()
+            best_prob = min(probs.values(), default=1)
+            # The interior probability is NaN if there are no interior cells.
+            if probs and not best_prob > interior_prob:
+                choices = [c for c, p in probs.items() if p - best_prob < 1e-9]
+                coord = rng.choice(sorted(choices))
+            else:
+                coord = self._choose_interior_cell(board, probs, rng)
+            solver.update(game.select_cell(coord))
+
+    @staticmethod
+    def _choose_interior_cell(
+        board, frontier: Dict[Coord_T, float], rng: random.Random
+    ) -> Coord_T:
+        """Choose a random unclicked cell that isn't on the frontier."""
+        choices = [
+            c
+            for c in board.all_coords
+            if board[c] is CellContents.Unclicked and c not in frontier
+        ]
+        return rng.choice(choices)
+
+
+STRATEGIES: Dict[str, Strategy] = {
+    s.name: s for s in [RandomStrategy(), SimpleStrategy(), SafestStrategy()]
+}
+
+
+@attr.attrs(auto_attribs=True, frozen=True)
+class SimulationConfig:
+    """Settings for the games to simulate."""
+
+    x_size: int
+    y_size: int
+    mines: int
+    per_cell: int = 1
+    first_success: bool = True
+    strategy: Strategy = STRATEGIES["simple"]
+
+    @classmethod
+    def from_difficulty(cls, difficulty: Difficulty, **kwargs) -> "SimulationConfig":
+        """Create an instance with the board values for a difficulty."""
+        x_size, y_size, mines = difficulty.get_board_values()
+        return cls(x_size, y_size, mines, **kwargs)
+
+
+@attr.attrs(auto_attribs=True, frozen=True)
+class GameResult:
+    """The result of a single simulated game."""
+
+    won: bool
+    bbbv: int
+    # The proportion of the 3bv that was completed.
+    prop_complete: float
+    # The number of actions taken, i.e. selects, flags and chords.
+    clicks: int
+    # Time taken to create and play the game, in seconds.
+    duration: float
+
+
+@attr.attrs(auto_attribs=True)
+class SimulationStats:
+    """Aggregate statistics over a number of simulated games."""
+
+    games: int = 0
+    wins: int = 0
+    clicks: int = 0
+    bbbv: int = 0
+    prop_complete: float = 0
+    duration: float = 0
+    # Number of games played with each 3bv.
+    bbbv_counts: Dict[int, int] = attr.Factory(collections.Counter)
+    # The seed used for the run, to allow it to be reproduced.
+    seed: Optional[int] = None
+    # Wall-clock time since the start of the run, in seconds.
+    wall_time: float = 0
+
+    @property
+    def win_rate(self) -> float:
+        return self.wins / self.games if self.games else math.nan
+
+    @property
+    def mean_bbbv(self) -> float:
+        return self.bbbv / self.games if self.games else math.nan
+
+    @property
+    def mean_clicks(self) -> float:
+        return self.clicks / self.games if self.games else math.nan
+
+    @property
+    def mean_prop_complete(self) -> float:
+        return self.prop_complete / self.games if self.games else math.nan
+
+    @property
+    def mean_duration(self) -> float:
+        return self.duration / self.games if self.games else math.nan
+
+    @property
+    def games_per_sec(self) -> float:
+        return self.games / self.wall_time if self.wall_time else math.nan
+
+    def add_result(self, result: GameResult) -> None:
+        """Add the result of a game to the statistics."""
+        self.games += 1
+        self.wins += result.won
+        self.clicks += result.clicks
+        self.bbbv += result.bbbv
+        self.prop_complete += result.prop_complete
+        self.duration += result.duration
+        self.bbbv_counts[result.bbbv] += 1
+
+    def merge(self, other: "SimulationStats") -> None:
+        """Merge in statistics from another set of games."""
+        self.games += other.games
+        self.wins += other.wins
+        self.clicks += other.clicks
+        self.bbbv += other.bbbv
+        self.prop_complete += other.prop_complete
+        self.duration += other.duration
+        for bbbv, count in other.bbbv_counts.items():
+            self.bbbv_counts[bbbv] += count
+
+    def format_summary(self) -> str:
+        """Get a human-readable summary of the statistics."""
+        return "\n".join(
+            [
+                f"Games:          {self.games}",
+                f"Win rate:       {self.win_rate:.2%}",
+                f"Mean 3bv:       {self.mean_bbbv:.2f}",
+                f"Mean clicks:    {self.mean_clicks:.2f}",
+                f"Mean completed: {self.mean_prop_complete:.2%}",
+                f"Mean game time: {self.mean_duration * 1000:.3f}ms",
+                f"Throughput:     {self.games_per_sec:.1f} games/s",
+                f"Seed:           {self.seed}",
+            ]
+        )
+
+
+class _CountingGame(Game):
+    """A game that counts the actions taken on it."""
+
+    def __init__(self, **kwargs):
+        super().__init__(**kwargs)
+        self.clicks = 0
+
+    def select_cell(self, coord: Coord_T):
+        self.clicks += 1
+        return super().select_cell(coord)
+
+    def set_cell_flags(self, coord: Coord_T, nr_flags: int):
+        self.clicks += 1
+        return super().set_cell_flags(coord, nr_flags)
+
+    def chord_on_cell(self, coord: Coord_T):
+        self.clicks += 1
+        return super().chord_on_cell(coord)
+
+
+def play_game(config: SimulationConfig, rng: random.Random) -> GameResult:
+    """
+    Play a single game with the configured strategy.
+
+    :param config:
+        The game settings.
+    :param rng:
+        Random number generator, used to seed the minefield and passed to the
+        strategy.
+    :return:
+        The result of the game.
+    """
+    start = tm.perf_counter()
+    game = _CountingGame(
+        x_size=config.x_size,
+        y_size=config.y_size,
+        mines=config.mines,
+        per_cell=config.per_cell,
+        first_success=config.first_success,
+        seed=rng.getrandbits(64),
+    )
+    config.strategy.play(game, rng)
+    duration = tm.perf_counter() - start
+    if not game.mf:
+        raise RuntimeError(f"Strategy {config.strategy.name!r} did not start the game")
+    return GameResult(
+        won=game.state is GameState.WON,
+        bbbv=game.mf.bbbv,
+        prop_complete=game.get_prop_complete(),
+        clicks=game.clicks,
+        duration=duration,
+    )
+
+
+def _run_batch(args: Tuple[SimulationConfig, int, int, int]) -> SimulationStats:
+    """
+    Play a batch of games, run in a worker process.
+
+    Each batch has its own RNG, seeded from the run's seed and the batch index,
+    so that results don't depend on how batches are spread across workers.
+    """
+    config, seed, batch_idx, nr_games = args
+    rng = random.Random(f"{seed}:{batch_idx}")
+    stats = SimulationStats(seed=seed)
+    for _ in range(nr_games):
+        stats.add_result(play_game(config, rng))
+    return stats
+
+
+def run_simulation(
+    config: SimulationConfig,
+    nr_games: int,
+    *,
+    processes: Optional[int] = None,
+    batch_size: int = 100,
+    seed: Optional[int] = None,
+) -> Iterator[SimulationStats]:
+    """
+    Run a number of games across a pool of worker processes.
+
+    Games are split into batches, and the aggregate statistics are yielded each
+    time a batch completes. The same stats object is updated and yielded each
+    time, with the final value covering all games.
+
+    :param config:
+        The game settings.
+    :param nr_games:
+        The number of games to play.
+    :param processes:
+        The number of worker processes, defaulting to the number of CPUs. If 1,
+        games are played in the current process.
+    :param batch_size:
+        The number of games in each batch sent to a worker.
+    :param seed:
+        Seed for the run, for reproducible results. A random seed is chosen if
+        not given, which is stored in the returned stats.
+    """
+    if seed is None:
+        seed = random.SystemRandom().getrandbits(64)
+    if processes is None:
+        processes = os.cpu_count() or 1
+    batches = [
+        (config, seed, i, min(batch_size, nr_games - start))
+        for i, start in enumerate(range(0, nr_games, batch_size))
+    ]
+    logger.info(
+        "Running %d games in %d batches across %d processes with seed %d",
+        nr_games,
+        len(batches),
+        processes,
+        seed,
+    )
+
+    stats = SimulationStats(seed=seed)
+    start = tm.perf_counter()
+    if processes == 1:
+        for batch in batches:
+            stats.merge(_run_batch(batch))
+            stats.wall_time = tm.perf_counter() - start
+            yield stats
+    else:
+        with multiprocessing.Pool(processes) as pool:
+            for batch_stats in pool.imap_unordered(_run_batch, batches):
+                stats.merge(batch_stats)
+                stats.wall_time = tm.perf_counter() - start
+                yield stats
@@ -0,0 +1,635 @@
+# October 2020, Lewis Gaul
+
+"""
+Mine probability calculation for a board in play.
+
+The maths is described in 'docs/Minesweeper Probabilities.pdf'. In summary:
+ - Unknown cells (unclicked or flagged) next to a revealed number form the
+   'frontier'. Flags are not trusted, since they may be wrong.
+ - Each revealed number constrains the number of mines in its unknown
+   neighbours. Frontier cells linked by shared constraints form independent
+   components, and every consistent assignment of mines to a component's
+   cells is enumerated.
+ - Mines are placed by choosing 'slots' uniformly, with 'per_cell' slots per
+   cell (see Minefield). A cell holding k mines therefore has C(per_cell, k)
+   slot choices, and the remaining mines are spread over the slots of the
+   cells away from the frontier, giving a binomial weight for each total
+   number of mines in the frontier.
+ - Components are combined by convolving their mine count distributions,
+   weighted by the number of ways of placing the remaining mines.
+
+Components are cached between updates, with only those touching changed
+cells being rebuilt and re-enumerated. Components whose enumeration exceeds a
+search budget are not solved exactly, and their cells are instead treated as
+if they were away from the frontier.
+
+Exports
+-------
+.. class:: ProbabilitySolver
+    Calculates the probability of unknown cells containing a mine.
+
+"""
+
+__all__ = ("ProbabilitySolver",)
+
+import logging
+import math
+from typing import Dict, Iterable, List, Optional, Sequence, Set, Tuple
+
+from ..shared import utils
+from ..shared.types import CellCode, Coord_T
+from .board import Board
+
+
+logger = logging.getLogger(__name__)
+
+_UNKNOWN = 0
+_NUM = 1
+_MINE = 2
+
+# Classification of each kind of cell code as unknown, a revealed number, or a
+#  known mine. Flags are treated as unknown since they may be wrong.
+_KIND_CLASSES = {
+    CellCode.UNCLICKED: _UNKNOWN,
+    CellCode.NUM: _NUM,
+    CellCode.MINE: _MINE,
+    CellCode.HIT_MINE: _MINE,
+    CellCode.FLAG: _UNKNOWN,
+    CellCode.WRONG_FLAG: _UNKNOWN,
+}
+_CLASSIFY_TABLE = [
+    _KIND_CLASSES.get(kind, _UNKNOWN) for kind in range(CellCode.KIND_MASK + 1)
+]
+
+
+def _classify(code: int) -> int:
+    """Classify a cell code as unknown, a revealed number, or a known mine."""
+    return _CLASSIFY_TABLE[code & CellCode.KIND_MASK]
+
+
+def _log_comb(n: int, k: int) -> float:
+    """The natural log of n choose k, or -inf if k is out of range."""
+    if k < 0 or k > n:
+        return -math.inf
+    return math.lgamma(n + 1) - math.lgamma(k + 1) - math.lgamma(n - k + 1)
+
+
+def _comb(n: int, k: int) -> int:
+    """n choose k, for small values."""
+    if k < 0 or k > n:
+        return 0
+    result = 1
+    for i in range(min(k, n - k)):
+        result = result * (n - i) // (i + 1)
+    return result
+
+
+def _convolve(a: Sequence[float], b: Sequence[float]) -> List[float]:
+    """Convolve two distributions over numbers of mines."""
+    result = [0] * (len(a) + len(b) - 1)
+    for i, x in enumerate(a):
+        if x:
+            for j, y in enumerate(b):
+                result[i + j] += x * y
+    return result
+
+
+class _BudgetExceeded(Exception):
+    """Raised when enumerating a component exceeds the search budget."""
+
+
+class _Component:
+    """
+    A set of frontier cells linked by the constraints of revealed numbers.
+
+    The enumeration results are:
+     - weights[m] : The total weight of configurations with m mines.
+     - safe_weights[j][m] : The weight of those configurations that have no
+       mine in the j-th cell.
+    """
+
+    def __init__(
+        self,
+        cells: List[int],
+        constraint_cells: List[int],
+        constraints: List[Tuple[int, List[int]]],
+    ):
+        # Frontier cell indices, in the order they are assigned.
+        self.cells = cells
+        # Indices of the revealed numbers giving the constraints.
+        self.constraint_cells = constraint_cells
+        # Pairs of (number of mines, local indices of the constrained cells).
+        self.constraints = constraints
+        self.weights: Optional[List[int]] = None
+        self.safe_weights: Optional[List[List[int]]] = None
+        self.solved = False
+
+    def __repr__(self):
+        return f"<_Component cells={len(self.cells)} solved={self.solved}>"
+
+    def enumerate(self, per_cell: int, budget: int) -> None:
+        """
+        Enumerate the consistent mine configurations.
+
+        Cells that are forced by a constraint are fixed first, which may split
+        the remaining cells into independent groups that are enumerated
+        separately and then combined.
+
+        :param per_cell:
+            The max number of mines per cell.
+        :param budget:
+            The max number of search steps before giving up.
+        """
+        n = len(self.cells)
+        fixed = self._propagate(per_cell)
+        if fixed is None:
+            logger.warning("No consistent mine configurations for component")
+            return
+        # The weights for the fixed cells, which are either empty or full so
+        # have a single slot choice.
+        nr_fixed_mines = sum(fixed.values())
+        weights = [0] * nr_fixed_mines + [1]
+        safe_weights: List[Optional[List[int]]] = [None] * n
+        for j, k in fixed.items():
+            safe_weights[j] = weights if k == 0 else [0] * len(weights)
+
+        steps = [0]
+        for cells, constraints in self._split_free_cells(fixed):
+            try:
+                group_weights, group_safe = self._search(
+                    cells, constraints, per_cell, budget, steps
+                )
+            except _BudgetExceeded:
+                logger.debug(
+                    "Search budget exceeded for component with %d cells", n
+                )
+                return
+            for j, sw in enumerate(safe_weights):
+                if sw is not None:
+                    safe_weights[j] = _convolve(sw, group_weights)
+            for j, sw in zip(cells, group_safe):
+                safe_weights[j] = _convolve(weights, sw)
+            weights = _convolve(weights, group_weights)
+
+        if not any(weights):
+            logger.warning("No consistent mine configurations for component")
+            return
+        # Trim trailing mine counts that have no configurations.
+        length = max(m for m, w in enumerate(weights) if w) + 1
+        self.weights = weights[:length]
+        self.safe_weights = [sw[:length] for sw in safe_weights]
+        self.solved = True
+
+    def _propagate(self, per_cell: int) -> Optional[Dict[int, int]]:
+        """
+        Fix the cells that are forced to be empty or full by a constraint.
+
+        :return:
+            The number of mines in each fixed cell, or None if the constraints
+            are inconsistent.
+        """
+        fixed: Dict[int, int] = dict()
+        changed = True
+        while changed:
+            changed = False
+            for value, local_cells in self.constraints:
+                free = [j for j in local_cells if j not in fixed]
+                if not free:
+                    if value != sum(fixed[j] for j in local_cells):
+                        return None
+                    continue
+                rem = value - sum(fixed.get(j, 0) for j in local_cells)
+                if rem < 0 or rem > len(free) * per_cell:
+                    return None
+                elif rem == 0 or rem == len(free) * per_cell:
+                    for j in free:
+                        fixed[j] = 0 if rem == 0 else per_cell
+                    changed = True
+        return fixed
+
+    def _split_free_cells(
+        self, fixed: Dict[int, int]
+    ) -> Iterable[Tuple[List[int], List[Tuple[int, List[int]]]]]:
+        """
+        Split the cells that aren't fixed into groups linked by constraints.
+
+        :return:
+            Pairs of the local indices of a group's cells, and the group's
+            constraints in terms of remaining mines and positions in the group.
+        """
+        cell_constraints: List[List[int]] = [[] for _ in self.cells]
+        for c_idx, (_, local_cells) in enumerate(self.constraints):
+            for j in local_cells:
+                cell_constraints[j].append(c_idx)
+        seen = set(fixed)
+        for start in range(len(self.cells)):
+            if start in seen:
+                continue
+            seen.add(start)
+            cells = []
+            c_idxs = set()
+            todo = [start]
+            while todo:
+                j = todo.pop()
+                cells.append(j)
+                for c_idx in cell_constraints[j]:
+                    c_idxs.add(c_idx)
+                    for i in self.constraints[c_idx][1]:
+                        if i not in seen:
+                            seen.add(i)
+                            todo.append(i)
+            pos = {j: i for i, j in enumerate(cells)}
+            constraints = []
+            for c_idx in sorted(c_idxs):
+                value, local_cells = self.constraints[c_idx]
+                rem = value - sum(fixed.get(j, 0) for j in local_cells)
+                constraints.append((rem, [pos[j] for j in local_cells if j in pos]))
+            yield cells, constraints
+
+    @staticmethod
+    def _search(
+        cells: List[int],
+        constraints: List[Tuple[int, List[int]]],
+        per_cell: int,
+        budget: int,
+        steps: List[int],
+    ) -> Tuple[List[int], List[List[int]]]:
+        """
+        Enumerate the configurations of a group of cells by backtracking.
+
+        :param steps:
+            Single-item list holding the search steps taken so far, shared
+            between groups.
+        :return:
+            The total weight for each number of mines, and for each cell the
+            weight of configurations with that cell empty.
+        :raise _BudgetExceeded:
+            If the search budget is exceeded.
+        """
+        n = len(cells)
+        slot_weights = [_comb(per_cell, k) for k in range(per_cell + 1)]
+        cell_constraints: List[List[int]] = [[] for _ in range(n)]
+        rem = []
+        unassigned = []
+        for c_idx, (value, local_cells) in enumerate(constraints):
+            rem.append(value)
+            unassigned.append(len(local_cells))
+            for j in local_cells:
+                cell_constraints[j].append(c_idx)
+        assigned = [0] * n
+        weights = [0] * (n * per_cell + 1)
+        safe_weights = [[0] * (n * per_cell + 1) for _ in range(n)]
+
+        def search(j: int, mines: int, weight: int) -> None:
+            steps[0] += 1
+            if steps[0] > budget:
+                raise _BudgetExceeded
+            if j == n:
+                weights[mines] += weight
+                for i, k in enumerate(assigned):
+                    if k == 0:
+                        safe_weights[i][mines] += weight
+                return
+            constraints = cell_constraints[j]
+            for c_idx in constraints:
+                unassigned[c_idx] -= 1
+            for k in range(per_cell + 1):
+                if all(
+                    0 <= rem[c] - k <= unassigned[c] * per_cell for c in constraints
+                ):
+                    for c_idx in constraints:
+                        rem[c_idx] -= k
+                    assigned[j] = k
+                    search(j + 1, mines + k, weight * slot_weights[k])
+                    for c_idx in constraints:
+                        rem[c_idx] += k
+            assigned[j] = 0
+            for c_idx in constraints:
+                unassigned[c_idx] += 1
+
+        search(0, 0, 1)
+        return weights, safe_weights
+
+
+class ProbabilitySolver:
+    """
+    Calculates the probability of each unknown cell containing a mine.
+
+    The solver reads the board it is given, which should be kept up to date by
+    passing the cells that change to `update()`, e.g. with the cell updates
+    returned by each game action. Probabilities are calculated lazily when
+    requested, recomputing only the frontier components that have changed.
+    """
+
+    def __init__(
+        self,
+        board: Board,
+        *,
+        mines: int,
+        per_cell: int = 1,
+        search_budget: int = 200_000,
+    ):
+        """
+        :param board:
+            The board to calculate probabilities for.
+        :param mines:
+            The total number of mines in the minefield.
+        :param per_cell:
+            The max number of mines per cell.
+        :param search_budget:
+            The max number of search steps when enumerating a single component.
+        """
+        self.board = board
+        self.mines = mines
+        self.per_cell = per_cell
+        self.search_budget = search_budget
+        self._nbr_table = board.nbr_table
+        nr_cells = board.x_size * board.y_size
+        self._kinds = [_UNKNOWN] * nr_cells
+        self._nr_unknown = nr_cells
+        # The number of mines in each revealed mine cell, and the total.
+        self._mine_cells: Dict[int, int] = dict()
+        self._known_mines = 0
+        # The component containing each frontier cell and each constraint cell.
+        self._cell_comps: Dict[int, _Component] = dict()
+        self._constraint_comps: Dict[int, _Component] = dict()
+        self._comps: Set[_Component] = set()
+        self._dirty: Set[int] = set(range(nr_cells))
+        # The results of the last calculation, cleared on update.
+        self._frontier_probs: Optional[Dict[int, float]] = None
+        self._interior_prob: float = 0
+
+    # --------------------------------------------------------------------------
+    # Public API
+    # --------------------------------------------------------------------------
+    def update(self, cells: Iterable[Coord_T]) -> None:
+        """
+        Notify the solver of cells that have changed on the board.
+
+        :param cells:
+            The coordinates of the changed cells, e.g. the cell updates dict
+            returned by a game action.
+        """
+        coord_to_idx = self.board.coord_to_idx
+        for c in cells:
+            self._dirty.add(coord_to_idx(c))
+        if self._dirty:
+            self._frontier_probs = None
+
+    def get_frontier_probabilities(self) -> Dict[Coord_T, float]:
+        """
+        Get the probability of each frontier cell containing a mine.
+
+        :return:
+            Probabilities for the unknown cells next to a revealed number.
+        """
+        self._calculate()
+        idx_to_coord = self.board.idx_to_coord
+        return {idx_to_coord(i): p for i, p in self._frontier_probs.items()}
+
+    def get_interior_probability(self) -> float:
+        """
+        Get the probability of an unknown cell away from the frontier (not next
+        to any revealed number) containing a mine.
+
+        :return:
+            The probability, or NaN if there are no such cells.
+        """
+        self._calculate()
+        return self._interior_prob
+
+    def get_probability(self, coord: Coord_T) -> float:
+        """
+        Get the probability of a cell containing a mine.
+
+        :param coord:
+            The cell coordinate.
+        :return:
+            The probability, which is 0 for revealed numbers and 1 for
+            revealed mines.
+        """
+        self._calculate()
+        idx = self.board.coord_to_idx(coord)
+        kind = self._kinds[idx]
+        if kind == _NUM:
+            return 0
+        elif kind == _MINE:
+            return 1
+        return self._frontier_probs.get(idx, self._interior_prob)
+
+    def get_probabilities(self) -> utils.Grid:
+        """
+        Get the probability of every cell containing a mine.
+
+        :return:
+            A grid of probabilities in the shape of the board.
+        """
+        self._calculate()
+        grid = utils.Grid(self.board.x_size, self.board.y_size)
+        for idx, kind in enumerate(self._kinds):
+            if kind == _NUM:
+                prob = 0
+            elif kind == _MINE:
+                prob = 1
+            else:
+                prob = self._frontier_probs.get(idx, self._interior_prob)
+            grid.cells[idx] = prob
+        return grid
+
+    # --------------------------------------------------------------------------
+    # Internal methods
+    # --------------------------------------------------------------------------
+    def _calculate(self) -> None:
+        """Bring the components up to date and recombine them if required."""
+        if self._frontier_probs is not None:
+            return
+        self._refresh_components()
+        self._combine()
+
+    def _is_frontier(self, idx: int) -> bool:
+        kinds = self._kinds
+        return kinds[idx] == _UNKNOWN and any(
+            kinds[i] == _NUM for i in self._nbr_table.nbrs(idx)
+        )
+
+    def _is_constraint(self, idx: int) -> bool:
+        kinds = self._kinds
+        return kinds[idx] == _NUM and any(
+            kinds[i] == _UNKNOWN for i in self._nbr_table.nbrs(idx)
+        )
+
+    def _remove_component(self, comp: _Component) -> Iterable[int]:
+        """
+        Remove a component.
+
+        :return:
+            The frontier and constraint cells that were in the component.
+        """
+        self._comps.discard(comp)
+        for i in comp.cells:
+            del self._cell_comps[i]
+        for i in comp.constraint_cells:
+            del self._constraint_comps[i]
+        return comp.cells + comp.constraint_cells
+
+    def _refresh_components(self) -> None:
+        """Rebuild the components touching cells that have changed."""
+        if not self._dirty:
+            return
+        cells = self.board.cells
+        nbr_table = self._nbr_table
+        kinds = self._kinds
+        affected = set()
+        for idx in self._dirty:
+            old_kind, new_kind = kinds[idx], _classify(cells[idx])
+            self._nr_unknown += (new_kind == _UNKNOWN) - (old_kind == _UNKNOWN)
+            self._known_mines -= self._mine_cells.pop(idx, 0)
+            if new_kind == _MINE:
+                self._mine_cells[idx] = CellCode.num(cells[idx])
+                self._known_mines += CellCode.num(cells[idx])
+            kinds[idx] = new_kind
+            affected.update(nbr_table.nbrs_incl_origin(idx))
+        self._dirty.clear()
+
+        seeds = set(affected)
+        for idx in affected:
+            for comps in (self._cell_comps, self._constraint_comps):
+                comp = comps.get(idx)
+                if comp is not None:
+                    seeds.update(self._remove_component(comp))
+
+        for idx in seeds:
+            if idx in self._cell_comps or idx in self._constraint_comps:
+                continue
+            if self._is_frontier(idx) or self._is_constraint(idx):
+                self._build_component(idx)
+
+    def _build_component(self, start: int) -> None:
+        """
+        Build the component containing a frontier or constraint cell by
+        flood-filling through shared constraints.
+        """
+        cells = self.board.cells
+        nbr_table = self._nbr_table
+        kinds = self._kinds
+        frontier: List[int] = []
+        constraints: List[int] = []
+        seen = {start}
+        todo = [start]
+        while todo:
+            idx = todo.pop()
+            # Absorb any existing component that turns out to be connected,
+            # whose cells are reached by the flood-fill.
+            for comps in (self._cell_comps, self._constraint_comps):
+                comp = comps.get(idx)
+                if comp is not None:
+                    self._remove_component(comp)
+            if kinds[idx] == _UNKNOWN:
+                frontier.append(idx)
+                want = _NUM
+            else:
+                constraints.append(idx)
+                want = _UNKNOWN
+            for i in nbr_table.nbrs(idx):
+                if i not in seen and kinds[i] == want:
+                    seen.add(i)
+                    todo.append(i)
+
+        local = {idx: j for j, idx in enumerate(frontier)}
+        comp_constraints = []
+        for idx in constraints:
+            value = CellCode.num(cells[idx])
+            local_cells = []
+            for i in nbr_table.nbrs(idx):
+                if kinds[i] == _MINE:
+                    value -= CellCode.num(cells[i])
+                elif kinds[i] == _UNKNOWN:
+                    local_cells.append(local[i])
+            comp_constraints.append((value, local_cells))
+        comp = _Component(frontier, constraints, comp_constraints)
+        comp.enumerate(self.per_cell, self.search_budget)
+        self._comps.add(comp)
+        for idx in frontier:
+            self._cell_comps[idx] = comp
+        for idx in constraints:
+            self._constraint_comps[idx] = comp
+
+    def _combine(self) -> None:
+        """Combine the component results into per-cell probabilities."""
+        per_cell = self.per_cell
+        solved = [c for c in self._comps if c.solved]
+        nr_interior = self._nr_unknown - sum(len(c.cells) for c in solved)
+        interior_slots = nr_interior * per_cell
+        rem_mines = self.mines - self._known_mines
+
+        # Normalise each component's weights to avoid huge numbers, which
+        # cancels out in the final ratios.
+        dists = []
+        for comp in solved:
+            scale = max(comp.weights)
+            dists.append([w / scale for w in comp.weights])
+
+        # The distribution over all components, and excluding each component, by
+        # convolving prefixes and suffixes.
+        prefixes = [[1.0]]
+        for d in dists:
+            prefixes.append(_convolve(prefixes[-1], d))
+        suffixes = [[1.0]]
+        for d in reversed(dists):
+            suffixes.append(_convolve(suffixes[-1], d))
+        suffixes.reverse()
+        total_dist = prefixes[-1]
+
+        # Weight for each number of mines in the frontier, from the number of
+        # ways of placing the remaining mines in the interior slots.
+        log_factors = [
+            _log_comb(interior_slots, rem_mines - m) for m in range(len(total_dist))
+        ]
+        max_log = max(log_factors)
+        if max_log == -math.inf:
+            logger.warning("No consistent mine configurations for the board")
+            self._frontier_probs = {i: 0.5 for c in solved for i in c.cells}
+            self._interior_prob = 0.5 if nr_interior else math.nan
+            return
+        factors = [math.exp(f - max_log) for f in log_factors]
+        total = sum(w * f for w, f in zip(total_dist, factors))
+
+        if nr_interior:
+            # The proportion of placements with no mine in a given interior cell.
+            interior_safe = sum(
+                w
+                * f
+                * math.exp(
+                    _log_comb(interior_slots - per_cell, rem_mines - m)
+                    - log_factors[m]
+                )
+                for m, (w, f) in enumerate(zip(total_dist, factors))
+                if f
+            )
+            self._interior_prob = 1 - interior_safe / total
+        else:
+            self._interior_prob = math.nan
+
+        frontier_probs = dict()
+        for c_idx, comp in enumerate(solved):
+            others = _convolve(prefixes[c_idx], suffixes[c_idx + 1])
+            # The weight of the rest of the board given the component's mines.
+            rest = [
+                sum(
+                    w * factors[m + b]
+                    for b, w in enumerate(others)
+                    if m + b < len(factors)
+                )
+                for m in range(len(comp.weights))
+            ]
+            scale = max(comp.weights)
+            for j, idx in enumerate(comp.cells):
+                safe = comp.safe_weights[j]
+                if safe == comp.weights:
+                    frontier_probs[idx] = 0
+                elif not any(safe):
+                    frontier_probs[idx] = 1
+                else:
+                    safe_prob = sum(s / scale * r for s, r in zip(safe, rest)) / total
+                    frontier_probs[idx] = min(max(1 - safe_prob, 0), 1)
+        self._frontier_probs = frontier_probs
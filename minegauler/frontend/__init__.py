@@ -7,6 +7,7 @@ Available imports from the package.
 
 import signal
 import sys
+from typing import Callable, Optional
 
 from PyQt5.QtCore import QTimer, pyqtRemoveInputHook
 from PyQt5.QtWidgets import QApplication, QWidget
@@ -28,12 +29,15 @@ def init_app() -> None:
     pyqtRemoveInputHook()
 
 
-def run_app(gui: QWidget) -> int:
+def run_app(gui: QWidget, on_shown: Optional[Callable[[], None]] = None) -> int:
     """
     Run the GUI application.
 
     :param gui:
         The main GUI widget.
+    :param on_shown:
+        Optionally specify a callback to run from the event loop once the GUI
+        has been shown, e.g. for initialisation that can be deferred.
     :return:
         Exit code.
     """
@@ -50,4 +54,7 @@ def run_app(gui: QWidget) -> int:
     _timer.timeout.connect(lambda: None)
     _timer.start(100)
 
+    if on_shown:
+        QTimer.singleShot(0, on_shown)
+
     return _app.exec_()
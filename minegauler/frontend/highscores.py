@@ -8,14 +8,22 @@ Exports
 .. class:: HighscoresWindow
     Widget for displaying highscores.
 
+.. function:: cache_new_highscore
+    Update cached highscores with a newly inserted highscore.
+
+.. function:: clear_highscores_cache
+    Clear cached highscores, e.g. after merging in highscores.
+
 """
 
-__all__ = ("HighscoresWindow",)
+__all__ = ("HighscoresWindow", "cache_new_highscore", "clear_highscores_cache")
 
+import bisect
 import logging
 import time
-from typing import Dict, List, Optional
+from typing import Callable, Dict, List, Optional, Tuple
 
+import attr
 from PyQt5.QtCore import (
     QAbstractTableModel,
     QModelIndex,
@@ -49,6 +57,105 @@ from . import state
 logger = logging.getLogger(__name__)
 
 
+class _LeaderboardCache:
+    """
+    Cache of ranked highscores, shared between highscores windows.
+
+    Each entry is the ranked list for a settings group, sort key and filters, as
+    returned by `highscores.get_leaderboard()`. Entries are fetched from the DB
+    on first use and updated when a new highscore is inserted. The lists are
+    replaced rather than modified, so can be held on to by a model.
+    """
+
+    _SORT_KEYS: Dict[str, Callable[[highscores.HighscoreStruct], Tuple]] = {
+        "time": lambda h: (h.elapsed, -h.bbbv),
+        "3bv/s": lambda h: (-h.bbbvps, h.bbbv, h.elapsed),
+    }
+
+    def __init__(self):
+        self._entries: Dict[Tuple, List[highscores.HighscoreStruct]] = dict()
+
+    @staticmethod
+    def _make_key(
+        settings: highscores.HighscoreSettingsStruct,
+        sort_by: str,
+        filters: Dict[str, Optional[str]],
+    ) -> Tuple:
+        name = filters.get("name")
+        return (
+            highscores.HighscoreSettingsStruct.from_dict(attr.asdict(settings)),
+            sort_by,
+            name.lower() if name else None,
+            filters.get("flagging") or None,
+        )
+
+    def get(
+        self,
+        settings: highscores.HighscoreSettingsStruct,
+        sort_by: str,
+        filters: Dict[str, Optional[str]],
+    ) -> List[highscores.HighscoreStruct]:
+        """Get the ranked highscores, fetching from the DB if not cached."""
+        key = self._make_key(settings, sort_by, filters)
+        if key not in self._entries:
+            self._entries[key] = highscores.get_leaderboard(
+                settings=settings, sort_by=sort_by, filters=filters
+            )
+        return self._entries[key]
+
+    def add(self, highscore: highscores.HighscoreStruct) -> None:
+        """Update the cached entries with a newly inserted highscore."""
+        settings = highscores.HighscoreSettingsStruct.from_dict(attr.asdict(highscore))
+        for key, ranked in self._entries.items():
+            group, sort_by, name, flagging = key
+            if (
+                group != settings
+                or name is not None
+                and name != highscore.name.lower()
+                or flagging == "F"
+                and not utils.is_flagging_threshold(highscore.flagging)
+                or flagging == "NF"
+                and utils.is_flagging_threshold(highscore.flagging)
+            ):
+                continue
+            sort_key = self._SORT_KEYS[sort_by]
+            new_key = sort_key(highscore)
+            ranked = list(ranked)
+            if name is None:
+                # Only each player's best highscore is included.
+                existing = [
+                    i
+                    for i, h in enumerate(ranked)
+                    if h.name.lower() == highscore.name.lower()
+                ]
+                if existing:
+                    if sort_key(ranked[existing[0]]) <= new_key:
+                        continue
+                    ranked.pop(existing[0])
+            idx = bisect.bisect_right([sort_key(h) for h in ranked], new_key)
+            ranked.insert(idx, highscore)
+            self._entries[key] = ranked
+
+    def clear(self) -> None:
+        self._entries.clear()
+
+
+_cache = _LeaderboardCache()
+
+
+def cache_new_highscore(highscore: highscores.HighscoreStruct) -> None:
+    """
+    Update cached highscores with a highscore that has been inserted into the
+    local DB.
+    """
+    _cache.add(highscore)
+
+
+def clear_highscores_cache() -> None:
+    """Clear cached highscores, required if the local DB is changed in bulk."""
+    _cache.clear()
+
+
 class HighscoresWindow(QDialog):
     """A standalone highscores window."""
 
@@ -104,12 +211,18 @@ class HighscoresModel(QAbstractTableModel):
 
     sort_changed = pyqtSignal(int)
     _HEADERS = ["name", "time", "3bv", "3bv/s", "date", "flagging"]
+    # Number of rows to make available to the view at a time.
+    _FETCH_BATCH_SIZE = 100
 
     def __init__(self, parent: Optional[QWidget], state_: state.HighscoreWindowState):
         super().__init__(parent)
         self._state: state.HighscoreWindowState = state_
-        self._all_data: List[highscores.HighscoreStruct] = []
+        self._settings: Optional[highscores.HighscoreSettingsStruct] = None
         self._displayed_data: List[highscores.HighscoreStruct] = []
+        # Only this many rows are exposed to the view, more being fetched as the
+        #  view scrolls.
+        self._nr_fetched = 0
+        self._active_row: Optional[int] = None
 
     @property
     def _filters(self) -> Dict[str, Optional[str]]:
@@ -132,7 +245,25 @@ class HighscoresModel(QAbstractTableModel):
     def rowCount(self, parent: QModelIndex = QModelIndex()) -> int:
         if parent.isValid():
             return 0
-        return len(self._displayed_data)
+        return self._nr_fetched
+
+    def canFetchMore(self, parent: QModelIndex = QModelIndex()) -> bool:
+        if parent.isValid():
+            return False
+        return self._nr_fetched < len(self._displayed_data)
+
+    def fetchMore(self, parent: QModelIndex = QModelIndex()) -> None:
+        if parent.isValid():
+            return
+        count = min(
+            self._FETCH_BATCH_SIZE, len(self._displayed_data) - self._nr_fetched
+        )
+        if count <= 0:
+            return
+        first = self._nr_fetched
+        self.beginInsertRows(QModelIndex(), first, first + count - 1)
+        self._nr_fetched += count
+        self.endInsertRows()
 
     def headerData(
         self, section: int, orientation: Qt.Orientation, role: Qt.ItemDataRole
@@ -195,15 +326,12 @@ class HighscoresModel(QAbstractTableModel):
         """
         Change the data to be highscores for a different set of settings.
         """
-        self._all_data = highscores.get_highscores(settings=settings)
+        self._settings = settings
         self.filter_and_sort()
 
     def _get_active_row(self) -> Optional[int]:
         """Get the index of the row containing the active highscore."""
-        if self._state.current_highscore in self._displayed_data:
-            return self._displayed_data.index(self._state.current_highscore)
-        else:
-            return None
+        return self._active_row
 
     def _format_data(self, row: int, key: str) -> str:
         """Get the string to display in a given cell."""
@@ -225,13 +353,25 @@ class HighscoresModel(QAbstractTableModel):
 
     def filter_and_sort(self):
         """Update the displayed data based on current filters/sorting."""
-        self.layoutAboutToBeChanged.emit()
-        self._displayed_data = highscores.filter_and_sort(
-            self._all_data, self._state.sort_by, self._filters
+        self.beginResetModel()
+        if self._settings is None:
+            self._displayed_data = []
+        else:
+            self._displayed_data = _cache.get(
+                self._settings, self._state.sort_by, self._filters
+            )
+        if self._state.current_highscore in self._displayed_data:
+            self._active_row = self._displayed_data.index(
+                self._state.current_highscore
+            )
+        else:
+            self._active_row = None
+        # Make sure the active row is available to be displayed.
+        self._nr_fetched = min(
+            len(self._displayed_data),
+            max(self._FETCH_BATCH_SIZE, (self._active_row or 0) + 1),
         )
-        # TODO: Should call changePersistentIndexList()?
-        self.layoutChanged.emit()
-        self.dataChanged.emit(QModelIndex(), QModelIndex())
+        self.endResetModel()
 
 
 class HighscoresTable(QTableView):
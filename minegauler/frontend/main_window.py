@@ -12,6 +12,7 @@ Exports
 
 __all__ = ("MinegaulerGUI",)
 
+import html
 import logging
 import os
 import pathlib
@@ -46,6 +47,8 @@ from PyQt5.QtWidgets import (
 
 from .. import ROOT_DIR, shared
 from ..core import api
+from ..core.live import LiveStreamListener
+from ..shared import metrics
 from ..shared.highscores import (
     HighscoreSettingsStruct,
     HighscoreStruct,
@@ -61,7 +64,7 @@ from ..shared.types import (
     UIMode,
 )
 from ..shared.utils import GUIOptsStruct, format_timestamp
-from . import highscores, minefield, panel, simulate, state, utils
+from . import minefield, panel, state, utils
 from .utils import FILES_DIR, HIGHSCORES_DIR, read_highscore_file, save_highscore_file
 
 
@@ -215,6 +218,7 @@ class MinegaulerGUI(
 
         self._create_menu_action: QAction
         self._diff_menu_actions: Dict[Difficulty, QAction] = dict()
+        self._live_listener: Optional[LiveStreamListener] = None
         self._populate_menubars()
         self._menubar.setFixedHeight(self._menubar.sizeHint().height())
         self._panel_widget = panel.PanelWidget(self, self._state)
@@ -291,6 +295,8 @@ class MinegaulerGUI(
         self._state.highscores_state.current_highscore = None
         self._panel_widget.update_game_state(game_state)
         if game_state.finished():
+            # Make sure the final board is displayed before anything else.
+            self._mf_widget.flush_all_cell_images()
             self._handle_finished_game()
 
     def update_mines_remaining(self, mines_remaining: int) -> None:
@@ -528,6 +534,11 @@ class MinegaulerGUI(
                 action.setChecked(True)
             action.triggered.connect(get_change_per_cell_func(i))
 
+        # Live streaming
+        live_act = QAction("Stream to spectators", self, checkable=True)
+        self._opts_menu.addAction(live_act)
+        live_act.triggered.connect(self._set_live_streaming)
+
         # ----------
         # Help menu
         # ----------
@@ -549,6 +560,19 @@ class MinegaulerGUI(
 
         self._help_menu.addSeparator()
 
+        record_latency_act = QAction("Record latency", self, checkable=True)
+        record_latency_act.setChecked(metrics.is_enabled())
+        record_latency_act.triggered.connect(
+            lambda checked: metrics.enable() if checked else metrics.disable()
+        )
+        self._help_menu.addAction(record_latency_act)
+
+        latency_act = QAction("Latency stats", self)
+        latency_act.triggered.connect(self._open_latency_stats_popup)
+        self._help_menu.addAction(latency_act)
+
+        self._help_menu.addSeparator()
+
         about_act = QAction("About", self)
         self._help_menu.addAction(about_act)
         about_act.triggered.connect(
@@ -577,6 +601,25 @@ class MinegaulerGUI(
     def _set_name(self, name: str) -> None:
         self._state.name = name
         self._state.highscores_state.name_hint = name
+        if self._live_listener:
+            self._live_listener.player = name
+
+    def _set_live_streaming(self, enable: bool) -> None:
+        """Start or stop streaming games to the server for spectators."""
+        if enable and not self._live_listener:
+            info = self._ctrlr.get_game_info()
+            elapsed = info.started_info.elapsed if info.started_info else 0
+            self._live_listener = LiveStreamListener(
+                self._ctrlr.board, player=self._state.name, elapsed=elapsed
+            )
+            self._live_listener.set_mines(info.mines)
+            self._live_listener.update_game_state(info.game_state)
+            self._ctrlr.register_listener(self._live_listener)
+            self._live_listener.start()
+        elif not enable and self._live_listener:
+            self._ctrlr.unregister_listener(self._live_listener)
+            self._live_listener.stop()
+            self._live_listener = None
 
     def _handle_finished_game(self) -> None:
         """Called once when a game ends."""
@@ -608,24 +651,30 @@ class MinegaulerGUI(
                 shared.highscores.insert_highscore(highscore)
             except Exception:
                 logger.exception("Error inserting highscore")
+            else:
+                from . import highscores
+
+                highscores.cache_new_highscore(highscore)
+            replay_file = self._mf_widget.finish_replay()
+            if replay_file:
+                try:
+                    save_highscore_file(highscore, replay_file)
+                except OSError:
+                    logger.exception("Error saving highscore to file")
+                try:
+                    os.remove(replay_file)
+                except OSError:
+                    logger.warning("Unable to delete replay log %s", replay_file)
             self._state.highscores_state.current_highscore = highscore
-            # Check whether to pop up the highscores window.
-            # TODO: This is too slow...
+            # Check whether to pop up the highscores window, using the stored
+            #  personal bests.
             try:
-                new_best = shared.highscores.is_highscore_new_best(
-                    highscore, shared.highscores.get_highscores(settings=highscore)
-                )
+                new_best = shared.highscores.is_highscore_new_best(highscore)
             except Exception:
                 logger.exception("Error getting highscores")
             else:
                 if new_best:
                     self.open_highscores_window(highscore, new_best)
-                    # try:
-                    #     save_highscore_file(
-                    #         highscore, self._mf_widget.get_mouse_events(),
-                    #     )
-                    # except IOError:
-                    #     logger.exception("Error saving highscore to file")
 
     def _open_save_board_modal(self) -> None:
         if not (
@@ -698,6 +747,17 @@ class MinegaulerGUI(
         win.show()
         self._open_subwindows[title] = win
 
+    def _open_latency_stats_popup(self) -> None:
+        """Show the recorded latency metrics, also dumping them to the log."""
+        report = metrics.format_report()
+        logger.info("Latency metrics:\n%s", report)
+        _msg_popup(
+            self,
+            QMessageBox.Information,
+            "Latency stats",
+            f"<pre>{html.escape(report)}</pre>",
+        )
+
     def _open_retrieve_highscores_modal(self):
         """Open a window to select a highscores file to read in."""
         accepted = False
@@ -753,6 +813,9 @@ class MinegaulerGUI(
         try:
             logger.info("Fetching highscores from %s", file)
             added = retrieve_highscores(file)
+            from . import highscores
+
+            highscores.clear_highscores_cache()
             _msg_popup(
                 self,
                 QMessageBox.Information,
@@ -782,9 +845,11 @@ class MinegaulerGUI(
 
         hs_file = pathlib.Path(hs_file)
         try:
-            hs, cell_updates = read_highscore_file(hs_file)
-            x_size, y_size, _ = hs.difficulty.get_board_values()
-            win = simulate.SimulationMinefieldWidget(self, x_size, y_size, cell_updates)
+            # Only load the simulation window when it's first needed.
+            from . import simulate
+
+            _, game_replay = read_highscore_file(hs_file)
+            win = simulate.SimulationMinefieldWidget(self, game_replay)
         except Exception as e:
             logger.exception("Error reading highscore file")
             _msg_popup(
@@ -827,6 +892,9 @@ class MinegaulerGUI(
         if sort_by:
             self._state.highscores_state.sort_by = sort_by
         self._state.highscores_state.name_hint = self._state.name
+        # Only load the highscores window when it's first needed.
+        from . import highscores
+
         win = highscores.HighscoresWindow(self, settings, self._state.highscores_state)
         win.show()
         self._open_subwindows["highscores"] = win
@@ -13,18 +13,31 @@ Exports
 __all__ = ("MinefieldWidget",)
 
 import functools
+import itertools
 import logging
+import os
+import pathlib
+import tempfile
 import time
-from typing import Callable, Dict, Iterable, List, Mapping, Optional, Set
-
-from PyQt5.QtCore import QSize, Qt, pyqtSignal
-from PyQt5.QtGui import QImage, QMouseEvent, QPainter, QPixmap
-from PyQt5.QtWidgets import QGraphicsScene, QGraphicsView, QSizePolicy, QWidget
-
+from typing import Callable, Dict, Iterable, List, Mapping, Optional, Set, Tuple
+
+from PyQt5.QtCore import QSize, Qt, QTimer, pyqtSignal
+from PyQt5.QtGui import QImage, QMouseEvent, QPainter, QPaintEvent, QPixmap
+from PyQt5.QtWidgets import (
+    QGraphicsPixmapItem,
+    QGraphicsScene,
+    QGraphicsView,
+    QSizePolicy,
+    QWidget,
+)
+
+from .._version import __version__
 from ..core import Board, api
+from ..shared import metrics
+from ..shared.replay import ReplayWriter
 from ..shared.types import CellContents, CellImageType, Coord_T
 from .state import State
-from .utils import IMG_DIR, CellUpdate_T, MouseMove
+from .utils import CACHE_DIR, IMG_DIR, MouseMove
 
 
 logger = logging.getLogger(__name__)
@@ -32,6 +45,53 @@ logger = logging.getLogger(__name__)
 _SUNKEN_CELL = CellContents.Num(0)
 _RAISED_CELL = CellContents.Unclicked
 
+# Interval between flushes of queued cell images, in milliseconds (~60fps).
+_FRAME_INTERVAL_MS = 16
+# Maximum number of cell images to set per flush, to avoid blocking the event
+#  loop for too long when a large number of cells change at once.
+_MAX_IMAGES_PER_FLUSH = 5000
+
+# Specification of the cell images of each type, in the order they appear in
+#  the image atlas: (cell contents, image subdir, bg fname, fg fname, fg propn).
+_CellImageSpec_T = Tuple[CellContents, str, str, Optional[str], float]
+_CELL_IMAGE_SPECS: Dict[CellImageType, List[_CellImageSpec_T]] = {
+    CellImageType.BUTTONS: [
+        (_RAISED_CELL, "buttons", "btn_up.png", None, 1.0),
+        (_SUNKEN_CELL, "buttons", "btn_down.png", None, 1.0),
+    ],
+    CellImageType.NUMBERS: [
+        (CellContents.Num(i), "numbers", "btn_down.png", "num%d.png" % i, 7 / 8)
+        for i in range(1, 19)
+    ],
+    CellImageType.MARKERS: [
+        spec
+        for i in range(1, 4)
+        for spec in [
+            (CellContents.Flag(i), "markers", "btn_up.png", "flag%d.png" % i, 5 / 8),
+            (
+                CellContents.WrongFlag(i),
+                "markers",
+                "btn_up.png",
+                "cross%d.png" % i,
+                5 / 8,
+            ),
+            (CellContents.Mine(i), "markers", "btn_down.png", "mine%d.png" % i, 7 / 8),
+            (
+                CellContents.HitMine(i),
+                "markers",
+                "btn_down_hit.png",
+                "mine%d.png" % i,
+                7 / 8,
+            ),
+        ]
+    ],
+}
+
+# Process-wide cache of cell images, keyed by (image type, style, size).
+_cell_images_cache: Dict[
+    Tuple[CellImageType, str, int], Dict[CellContents, QPixmap]
+] = {}
+
 
 def _update_cell_images(
     cell_images: Dict[CellContents, QPixmap],
@@ -53,31 +113,86 @@ def _update_cell_images(
     # Currently only allows setting button styles.
     btn_style = styles[CellImageType.BUTTONS]
     if required & CellImageType.BUTTONS:
-        cell_images[_RAISED_CELL] = _make_pixmap(
-            "buttons", btn_style, "btn_up.png", size
-        )
-        cell_images[_SUNKEN_CELL] = _make_pixmap(
-            "buttons", btn_style, "btn_down.png", size
-        )
+        cell_images.update(_get_cell_images(CellImageType.BUTTONS, btn_style, size))
     if required & (CellImageType.BUTTONS | CellImageType.NUMBERS):
-        for i in range(1, 19):
-            cell_images[CellContents.Num(i)] = _make_pixmap(
-                "numbers", btn_style, "btn_down.png", size, "num%d.png" % i, 7 / 8
-            )
+        cell_images.update(_get_cell_images(CellImageType.NUMBERS, btn_style, size))
     if required & (CellImageType.BUTTONS | CellImageType.MARKERS):
-        for i in range(1, 4):
-            cell_images[CellContents.Flag(i)] = _make_pixmap(
-                "markers", btn_style, "btn_up.png", size, "flag%d.png" % i, 5 / 8
-            )
-            cell_images[CellContents.WrongFlag(i)] = _make_pixmap(
-                "markers", btn_style, "btn_up.png", size, "cross%d.png" % i, 5 / 8
-            )
-            cell_images[CellContents.Mine(i)] = _make_pixmap(
-                "markers", btn_style, "btn_down.png", size, "mine%d.png" % i, 7 / 8
-            )
-            cell_images[CellContents.HitMine(i)] = _make_pixmap(
-                "markers", btn_style, "btn_down_hit.png", size, "mine%d.png" % i, 7 / 8
-            )
+        cell_images.update(_get_cell_images(CellImageType.MARKERS, btn_style, size))
+
+
+def _get_cell_images(
+    img_type: CellImageType, style: str, size: int
+) -> Dict[CellContents, QPixmap]:
+    """
+    Get the cell images of a single type, using the process-wide cache.
+
+    All the images of the type are composited into a single atlas image, which
+    is saved in the cache directory so that it can be loaded in one go on the
+    next run, rather than loading and scaling each of the image files.
+
+    :param img_type:
+        The type of images to get.
+    :param style:
+        The button style to use.
+    :param size:
+        The size in pixels of the (square) images.
+    :return:
+        A mapping of cell contents to the corresponding image.
+    """
+    key = (img_type, style, size)
+    if key not in _cell_images_cache:
+        specs = _CELL_IMAGE_SPECS[img_type]
+        cache_path = CACHE_DIR / "cell_images_{}_{}_{}_{}.png".format(
+            __version__, img_type.name.lower(), style, size
+        )
+        atlas = QPixmap(str(cache_path))
+        if atlas.isNull() or atlas.size() != QSize(len(specs) * size, size):
+            atlas = _make_atlas(specs, style, size)
+            try:
+                CACHE_DIR.mkdir(exist_ok=True)
+            except OSError:
+                pass
+            if not atlas.save(str(cache_path)):
+                logger.debug("Unable to write image cache at %s", cache_path)
+        _cell_images_cache[key] = {
+            spec[0]: atlas.copy(i * size, 0, size, size)
+            for i, spec in enumerate(specs)
+        }
+    return _cell_images_cache[key]
+
+
+def _make_atlas(specs: List[_CellImageSpec_T], style: str, size: int) -> QPixmap:
+    """
+    Create an atlas of cell images, placed side by side in a single row.
+
+    :param specs:
+        The specification of each of the images to create.
+    :param style:
+        The button style to use.
+    :param size:
+        The size in pixels of the (square) images.
+    :return:
+        The atlas image.
+    """
+    atlas = QPixmap(len(specs) * size, size)
+    atlas.fill(Qt.transparent)
+    painter = QPainter(atlas)
+    for i, (_, img_subdir, bg_fname, fg_fname, propn) in enumerate(specs):
+        pixmap = _make_pixmap(img_subdir, style, bg_fname, size, fg_fname, propn)
+        painter.drawPixmap(i * size, 0, pixmap)
+    painter.end()
+    return atlas
+
+
+@functools.lru_cache(maxsize=None)
+def _get_img_path(subdir: str, fname: str, style: str) -> str:
+    """Get the path to an image, falling back to the standard style."""
+    base_path = IMG_DIR / subdir
+    full_path = base_path / style / fname
+    if not full_path.exists():
+        logger.warning(f"Missing image file at {full_path}, using standard style")
+        full_path = base_path / "standard" / fname
+    return str(full_path)
 
 
 def _make_pixmap(
@@ -88,21 +203,13 @@ def _make_pixmap(
     fg_fname: Optional[str] = None,
     propn: float = 1.0,
 ) -> QPixmap:
-    def get_path(subdir, fname, style) -> str:
-        base_path = IMG_DIR / subdir
-        full_path = base_path / style / fname
-        if not full_path.exists():
-            logger.warning(f"Missing image file at {full_path}, using standard style")
-            full_path = base_path / "standard" / fname
-        return str(full_path)
-
-    bg_path = get_path("buttons", bg_fname, style)
+    bg_path = _get_img_path("buttons", bg_fname, style)
     if fg_fname:
         image = QImage(bg_path).scaled(
             size, size, transformMode=Qt.SmoothTransformation
         )
         fg_size = int(propn * size)
-        fg_path = get_path(img_subdir, fg_fname, "Standard")
+        fg_path = _get_img_path(img_subdir, fg_fname, "Standard")
         overlay = QPixmap(fg_path).scaled(
             fg_size, fg_size, transformMode=Qt.SmoothTransformation
         )
@@ -143,6 +250,26 @@ def _filter_left_and_right(mouse_event_func: Callable):
     return wrapper
 
 
+def _track_click_time(mouse_event_func: Callable):
+    """
+    Decorator for mouse event methods to note when handling of the event
+    started, if metrics are enabled, to time clicks through to the resulting
+    cell updates being painted.
+    """
+
+    @functools.wraps(mouse_event_func)
+    def wrapper(self, event: QMouseEvent):
+        if not metrics.is_enabled():
+            return mouse_event_func(self, event)
+        self._click_time = time.perf_counter()
+        try:
+            return mouse_event_func(self, event)
+        finally:
+            self._click_time = None
+
+    return wrapper
+
+
 class MinefieldWidget(QGraphicsView):
     """
     The minefield widget.
@@ -163,6 +290,17 @@ class MinefieldWidget(QGraphicsView):
         _update_cell_images(self._cell_images, self.btn_size, self._state.styles)
 
         self._scene = QGraphicsScene()
+        # A single persistent scene item for each cell, created on first use.
+        self._cell_items: Dict[Coord_T, QGraphicsPixmapItem] = {}
+        # The state each cell item is currently displaying.
+        self._displayed_cells: Dict[Coord_T, CellContents] = {}
+        # Cell images waiting to be set, merged per cell and flushed at most
+        #  once per frame.
+        self._pending_cells: Dict[Coord_T, CellContents] = {}
+        self._flush_timer = QTimer(self)
+        self._flush_timer.setSingleShot(True)
+        self._flush_timer.setInterval(_FRAME_INTERVAL_MS)
+        self._flush_timer.timeout.connect(self.flush_cell_images)
         self.setScene(self._scene)
         self.setStyleSheet("border: 0px")
         self.setSizePolicy(QSizePolicy.Maximum, QSizePolicy.Maximum)
@@ -180,9 +318,18 @@ class MinefieldWidget(QGraphicsView):
 
         # Mouse tracking info, for simulating a played game.
         self._mouse_tracking: List[MouseMove] = []
-        self._mouse_events: List[CellUpdate_T] = []
+        # Replay log of the cell updates, created on the first update.
+        # The replay log of the current game, written as the game is played to
+        #  a file unique to this widget.
+        self._replay: Optional[ReplayWriter] = None
+        self._replay_path: Optional[pathlib.Path] = None
         self._first_click_time: Optional[int] = None
 
+        # When the mouse event currently being handled started, and when the
+        #  click that caused the cell updates waiting to be painted started.
+        self._click_time: Optional[float] = None
+        self._paint_click_time: Optional[float] = None
+
         self.reset()
 
     @property
@@ -216,6 +363,7 @@ class MinefieldWidget(QGraphicsView):
         return QSize(self.x_size * self.btn_size, self.y_size * self.btn_size)
 
     @_filter_left_and_right
+    @_track_click_time
     def mousePressEvent(self, event: QMouseEvent):
         """Handle mouse press events."""
         coord = self._coord_from_event(event)
@@ -256,6 +404,7 @@ class MinefieldWidget(QGraphicsView):
             assert coord is not None
             self.right_button_down(coord)
 
+    @_track_click_time
     @_filter_left_and_right
     def mouseDoubleClickEvent(self, event: QMouseEvent):
         """Handle double clicks."""
@@ -271,6 +420,7 @@ class MinefieldWidget(QGraphicsView):
         else:
             return self.mousePressEvent(event)
 
+    @_track_click_time
     @_filter_left_and_right
     def mouseMoveEvent(self, event: QMouseEvent):
         """Handle mouse move events."""
@@ -299,6 +449,7 @@ class MinefieldWidget(QGraphicsView):
             if event.buttons() & Qt.RightButton:
                 self.right_button_move(coord)
 
+    @_track_click_time
     @_filter_left_and_right
     def mouseReleaseEvent(self, event: QMouseEvent):
         """Handle mouse release events."""
@@ -470,9 +621,7 @@ class MinefieldWidget(QGraphicsView):
             return
         sink_cells = {c for c in coords if self._board[c] is CellContents.Unclicked}
         if sink_cells:
-            self._mouse_events.append(
-                (self._elapsed, {c: _SUNKEN_CELL for c in sink_cells})
-            )
+            self._record_event({c: _SUNKEN_CELL for c in sink_cells})
             self.at_risk_signal.emit()
             for c in sink_cells:
                 self._set_cell_image(c, _SUNKEN_CELL)
@@ -486,17 +635,40 @@ class MinefieldWidget(QGraphicsView):
             c for c in self._sunken_cells if self._board[c] is CellContents.Unclicked
         }
         if raise_cells:
-            self._mouse_events.append(
-                (self._elapsed, {c: _RAISED_CELL for c in raise_cells})
-            )
+            self._record_event({c: _RAISED_CELL for c in raise_cells})
             for c in raise_cells:
                 self._set_cell_image(c, _RAISED_CELL)
         self._sunken_cells.clear()
 
+    def _record_event(self, cell_updates: Mapping[Coord_T, CellContents]) -> None:
+        """
+        Record cell updates in the replay log, starting the log if required.
+
+        No new log is started once the game has finished.
+        """
+        if self._replay is None:
+            if self._state.game_status.finished():
+                return
+            try:
+                CACHE_DIR.mkdir(exist_ok=True)
+                fd, path = tempfile.mkstemp(
+                    prefix="game-", suffix=".mgr", dir=CACHE_DIR
+                )
+                os.close(fd)
+                self._replay_path = pathlib.Path(path)
+                self._replay = ReplayWriter(path, self.x_size, self.y_size)
+            except OSError:
+                logger.exception("Unable to create replay log")
+                return
+        self._replay.add_event(self._elapsed, cell_updates)
+
     def _set_cell_image(self, coord: Coord_T, state: CellContents) -> None:
         """
         Set the image of a cell.
 
+        The update is queued, replacing any pending update for the same cell,
+        and applied on the next flush.
+
         Arguments:
         coord ((x, y) tuple in grid range)
             The coordinate of the cell.
@@ -506,9 +678,55 @@ class MinefieldWidget(QGraphicsView):
         if state not in self._cell_images:
             logger.error("Missing cell image for state: %s", state)
             return
-        x, y = coord
-        b = self._scene.addPixmap(self._cell_images[state])
-        b.setPos(x * self.btn_size, y * self.btn_size)
+        self._pending_cells[coord] = state
+        if not self._flush_timer.isActive():
+            self._flush_timer.start()
+
+    def paintEvent(self, event: QPaintEvent):
+        super().paintEvent(event)
+        if self._paint_click_time is not None and not self._pending_cells:
+            metrics.record(
+                "frontend.click_to_paint", time.perf_counter() - self._paint_click_time
+            )
+            self._paint_click_time = None
+
+    @metrics.timed("frontend.flush_cell_images")
+    def flush_cell_images(self) -> None:
+        """
+        Apply queued cell images to the scene.
+
+        At most _MAX_IMAGES_PER_FLUSH images are set, with another flush
+        scheduled for the next frame if any remain.
+        """
+        self._flush_timer.stop()
+        pending = self._pending_cells
+        for coord in list(itertools.islice(pending, _MAX_IMAGES_PER_FLUSH)):
+            state = pending.pop(coord)
+            if self._displayed_cells.get(coord) is state:
+                continue
+            self._displayed_cells[coord] = state
+            item = self._cell_items.get(coord)
+            if item is None:
+                x, y = coord
+                item = self._scene.addPixmap(self._cell_images[state])
+                item.setPos(x * self.btn_size, y * self.btn_size)
+                self._cell_items[coord] = item
+            else:
+                item.setPixmap(self._cell_images[state])
+        if pending:
+            self._flush_timer.start()
+
+    def flush_all_cell_images(self) -> None:
+        """Apply all queued cell images to the scene immediately."""
+        while self._pending_cells:
+            self.flush_cell_images()
+
+    def _clear_cell_items(self) -> None:
+        """Remove all cell items from the scene, e.g. when cells move."""
+        self._scene.clear()
+        self._cell_items.clear()
+        self._displayed_cells.clear()
+        self._pending_cells.clear()
 
     def _update_size(self) -> None:
         self.setMaximumSize(self.sizeHint())
@@ -526,9 +744,10 @@ class MinefieldWidget(QGraphicsView):
         self._both_mouse_buttons_pressed = False
         self._await_release_all_buttons = True
         self._mouse_tracking = []
-        self._mouse_events = []
+        self._discard_replay()
         self._first_click_time = None
 
+    @metrics.timed("frontend.update_cells")
     def update_cells(self, cell_updates: Mapping[Coord_T, CellContents]) -> None:
         """
         Called to indicate some cells have changed state.
@@ -536,13 +755,16 @@ class MinefieldWidget(QGraphicsView):
         :param cell_updates:
             A mapping of cell coordinates to their new state.
         """
-        self._mouse_events.append((self._elapsed, cell_updates))
+        if self._click_time is not None and self._paint_click_time is None:
+            self._paint_click_time = self._click_time
+        self._record_event(cell_updates)
         for c, state in cell_updates.items():
             self._set_cell_image(c, state)
 
     def reshape(self, x_size: int, y_size: int) -> None:
         logger.info("Resizing minefield to %sx%s", x_size, y_size)
         self._update_size()
+        self._clear_cell_items()
         for c in [(i, j) for i in range(self.x_size) for j in range(self.y_size)]:
             self._set_cell_image(c, CellContents.Unclicked)
 
@@ -552,6 +774,8 @@ class MinefieldWidget(QGraphicsView):
         _update_cell_images(
             self._cell_images, self.btn_size, self._state.styles, img_type
         )
+        # The displayed images are out of date.
+        self._displayed_cells.clear()
         for coord in self._board.all_coords:
             self._set_cell_image(coord, self._board[coord])
 
@@ -559,9 +783,34 @@ class MinefieldWidget(QGraphicsView):
         """Update the size of the cells."""
         assert size == self._state.btn_size
         _update_cell_images(self._cell_images, self.btn_size, self._state.styles)
+        self._clear_cell_items()
         for coord in self._board.all_coords:
             self._set_cell_image(coord, self._board[coord])
         self._update_size()
 
-    def get_mouse_events(self) -> List[CellUpdate_T]:
-        return self._mouse_events
+    def finish_replay(self) -> Optional[pathlib.Path]:
+        """
+        Finish the replay log of the current game.
+
+        :return:
+            The path of the replay log, or None if there is no log. The caller
+            is responsible for deleting the file.
+        """
+        if not self._replay:
+            return None
+        self._replay.close()
+        self._replay = None
+        path, self._replay_path = self._replay_path, None
+        return path
+
+    def _discard_replay(self) -> None:
+        """Close and delete the replay log of the current game, if any."""
+        if self._replay:
+            self._replay.close()
+            self._replay = None
+        if self._replay_path:
+            try:
+                os.remove(self._replay_path)
+            except OSError:
+                logger.warning("Unable to delete replay log %s", self._replay_path)
+            self._replay_path = None
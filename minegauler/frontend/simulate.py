@@ -13,40 +13,51 @@ Exports
 __all__ = ("SimulationMinefieldWidget",)
 
 import logging
-from typing import Dict, List, Mapping, Optional
+import time
+from typing import Dict, Mapping, Optional
 
-from PyQt5.QtCore import QTimer
+from PyQt5.QtCore import Qt, QTimer
 from PyQt5.QtGui import QMouseEvent, QPixmap
 from PyQt5.QtWidgets import (
+    QComboBox,
     QDialog,
     QFrame,
+    QGraphicsPixmapItem,
     QGraphicsScene,
     QGraphicsView,
+    QHBoxLayout,
+    QLabel,
+    QPushButton,
     QSizePolicy,
+    QSlider,
     QVBoxLayout,
     QWidget,
 )
 
+from ..shared.replay import Replay
 from ..shared.types import CellContents, CellImageType, Coord_T
-from .minefield import _update_cell_images
-from .utils import CellUpdate_T
+from .minefield import _FRAME_INTERVAL_MS, _update_cell_images
 
 
 logger = logging.getLogger(__name__)
 
 
 class SimulationMinefieldWidget(QDialog):
-    def __init__(
-        self,
-        parent: Optional[QWidget],
-        x_size: int,
-        y_size: int,
-        cell_updates: List[CellUpdate_T],
-    ):
+    """
+    A dialog for replaying a game, with controls to play/pause, change the
+    playback speed and scrub to any point in the game.
+    """
+
+    _SPEEDS = [0.25, 0.5, 1, 2, 4, 8]
+
+    def __init__(self, parent: Optional[QWidget], replay: Replay):
         super().__init__(parent)
-        self._x_size = x_size
-        self._y_size = y_size
-        self._remaining_cell_updates = cell_updates
+        self._replay = replay
+        # The position in the replay being displayed, in seconds.
+        self._time: float = 0
+        self._speed: float = 1
+        # The wall-clock time of the last playback tick.
+        self._last_tick: Optional[float] = None
 
         self._cell_images: Dict[CellContents, QPixmap] = {}
         _update_cell_images(
@@ -54,22 +65,25 @@ class SimulationMinefieldWidget(QDialog):
         )
 
         self._scene = QGraphicsScene()
+        self._cell_items: Dict[Coord_T, QGraphicsPixmapItem] = {}
+        self._timer = QTimer(self)
+        self._timer.setInterval(_FRAME_INTERVAL_MS)
+        self._timer.timeout.connect(self._do_next_update)
         self.setModal(True)
         self.setWindowTitle("Highscore replay")
         self._setup_ui()
 
+        self._replay.seek_event(0)
         for c in [(x, y) for x in range(self.x_size) for y in range(self.y_size)]:
             self._set_cell_image(c, CellContents.Unclicked)
 
-        self._animation_started = False
-
     @property
     def x_size(self) -> int:
-        return self._x_size
+        return self._replay.x_size
 
     @property
     def y_size(self) -> int:
-        return self._y_size
+        return self._replay.y_size
 
     @property
     def btn_size(self) -> int:
@@ -89,27 +103,79 @@ class SimulationMinefieldWidget(QDialog):
         view.setScene(self._scene)
         sub_layout.addWidget(view)
 
+        controls_layout = QHBoxLayout()
+        base_layout.addLayout(controls_layout)
+        self._play_button = QPushButton("Play", self)
+        self._play_button.clicked.connect(self._toggle_playing)
+        controls_layout.addWidget(self._play_button)
+        speed_combo = QComboBox(self)
+        for speed in self._SPEEDS:
+            speed_combo.addItem(f"{speed}x", speed)
+        speed_combo.setCurrentIndex(self._SPEEDS.index(1))
+        speed_combo.currentIndexChanged.connect(
+            lambda i: self._set_speed(self._SPEEDS[i])
+        )
+        controls_layout.addWidget(speed_combo)
+        self._slider = QSlider(Qt.Horizontal, self)
+        self._slider.setRange(0, int(self._replay.duration * 1000))
+        self._slider.valueChanged.connect(lambda ms: self._seek(ms / 1000))
+        controls_layout.addWidget(self._slider)
+        self._time_label = QLabel(self)
+        controls_layout.addWidget(self._time_label)
+        self._update_time_label()
+
     # --------------------------------------------------------------------------
     # Qt method overrides
     # --------------------------------------------------------------------------
     def mousePressEvent(self, event: QMouseEvent):
         """Handle mouse press events."""
-        if not self._animation_started:
-            self._animation_started = True
-            self._do_next_update()
+        self._toggle_playing()
+
+    def closeEvent(self, event):
+        self._timer.stop()
+        super().closeEvent(event)
 
     # --------------------------------------------------------------------------
     # Other methods
     # --------------------------------------------------------------------------
+    def _toggle_playing(self) -> None:
+        """Start or pause playback, restarting if at the end."""
+        if self._timer.isActive():
+            self._timer.stop()
+            self._play_button.setText("Play")
+        else:
+            if self._time >= self._replay.duration:
+                self._seek(0)
+            self._last_tick = time.monotonic()
+            self._timer.start()
+            self._play_button.setText("Pause")
+
+    def _set_speed(self, speed: float) -> None:
+        self._speed = speed
+
     def _do_next_update(self):
-        """Perform the next set of cell updates."""
-        evt = self._remaining_cell_updates.pop(0)
-        self._update_cells({tuple(c): CellContents.from_str(x) for c, x in evt[1]})
-        if self._remaining_cell_updates:
-            QTimer.singleShot(
-                1000 * (self._remaining_cell_updates[0][0] - evt[0]),
-                self._do_next_update,
-            )
+        """Advance playback by the wall-clock time since the last tick."""
+        now = time.monotonic()
+        self._time += (now - self._last_tick) * self._speed
+        self._last_tick = now
+        if self._time >= self._replay.duration:
+            self._time = self._replay.duration
+            self._timer.stop()
+            self._play_button.setText("Play")
+        self._seek(self._time)
+        # Move the slider without triggering another seek.
+        self._slider.blockSignals(True)
+        self._slider.setValue(int(self._time * 1000))
+        self._slider.blockSignals(False)
+
+    def _seek(self, elapsed: float) -> None:
+        """Display the board at the given time in the replay."""
+        self._time = elapsed
+        self._update_cells(self._replay.seek(elapsed))
+        self._update_time_label()
+
+    def _update_time_label(self) -> None:
+        self._time_label.setText(f"{self._time:.2f}s / {self._replay.duration:.2f}s")
 
     def _set_cell_image(self, coord: Coord_T, state: CellContents) -> None:
         """
@@ -124,9 +190,14 @@ class SimulationMinefieldWidget(QDialog):
         if state not in self._cell_images:
             logger.error("Missing cell image for state: %s", state)
             return
-        x, y = coord
-        b = self._scene.addPixmap(self._cell_images[state])
-        b.setPos(x * self.btn_size, y * self.btn_size)
+        item = self._cell_items.get(coord)
+        if item is None:
+            x, y = coord
+            item = self._scene.addPixmap(self._cell_images[state])
+            item.setPos(x * self.btn_size, y * self.btn_size)
+            self._cell_items[coord] = item
+        else:
+            item.setPixmap(self._cell_images[state])
 
     def _update_cells(self, cell_updates: Mapping[Coord_T, CellContents]) -> None:
         """
@@ -17,6 +17,9 @@ Exports
 .. function:: read_highscore_file
     Read data from a highscore file.
 
+.. data:: CACHE_DIR
+    The directory containing cached files, which may be safely deleted.
+
 .. data:: FILES_DIR
     The directory containing files.
 
@@ -29,6 +32,7 @@ Exports
 """
 
 __all__ = (
+    "CACHE_DIR",
     "FILES_DIR",
     "HIGHSCORES_DIR",
     "IMG_DIR",
@@ -42,13 +46,14 @@ import gzip
 import json
 import logging
 import pathlib
+import shutil
 from collections import namedtuple
-from typing import Iterable, List, Mapping, Tuple
+from typing import Mapping, Tuple
 
 import attr
 
 from .. import ROOT_DIR
-from ..shared import HighscoreStruct
+from ..shared import HighscoreStruct, replay
 from ..shared.types import CellContents, Coord_T, PathLike
 from ..shared.utils import format_timestamp
 
@@ -58,6 +63,9 @@ logger = logging.getLogger(__name__)
 IMG_DIR: pathlib.Path = ROOT_DIR / "images"
 FILES_DIR: pathlib.Path = ROOT_DIR / "files"
 HIGHSCORES_DIR: pathlib.Path = ROOT_DIR / "highscores"
+CACHE_DIR: pathlib.Path = ROOT_DIR / ".cache"
+
+_GZIP_MAGIC = b"\x1f\x8b"
 
 
 CellUpdate_T = Tuple[float, Mapping[Coord_T, CellContents]]
@@ -72,15 +80,15 @@ class MouseMove(namedtuple("_MouseMove", ["elapsed", "position"])):
 
 
 def save_highscore_file(
-    highscore: HighscoreStruct, cell_updates: Iterable[CellUpdate_T]
+    highscore: HighscoreStruct, replay_file: PathLike
 ) -> pathlib.Path:
     """
-    Save a highscore to file.
+    Save a highscore to file, along with a replay of the game.
 
     :param highscore:
         The highscore to save.
-    :param cell_updates:
-        The cell updates that were made during the game.
+    :param replay_file:
+        The replay log written during the game, which is copied.
     :return:
         The path the file is saved at.
     """
@@ -91,28 +99,39 @@ def save_highscore_file(
         highscore,
         format_timestamp(highscore.timestamp).replace(" ", "_").replace(":", "-"),
     )
-    data = {
-        "highscore": attr.asdict(highscore),
-        "cell_updates": [
-            (t, [(c, str(x)) for c, x in updates.items()])
-            for t, updates in cell_updates
-        ],
-    }
     HIGHSCORES_DIR.mkdir(exist_ok=True)
-    with gzip.open(HIGHSCORES_DIR / fname, "wt") as f:
-        json.dump(data, f)
-    return HIGHSCORES_DIR / fname
+    path = HIGHSCORES_DIR / fname
+    shutil.copyfile(replay_file, path)
+    replay.append_metadata(path, {"highscore": attr.asdict(highscore)})
+    return path
 
 
-def read_highscore_file(path: PathLike,) -> Tuple[HighscoreStruct, List[CellUpdate_T]]:
+def read_highscore_file(path: PathLike) -> Tuple[HighscoreStruct, replay.Replay]:
     """
     Read data from a highscore file.
 
+    Files in the old format of gzipped JSON are also supported.
+
     :param path:
         Path to the file.
     :return:
-        The highscore struct and a list of cell updates.
+        The highscore struct and the replay of the game.
     """
-    with gzip.open(path, "rt") as f:
-        data = json.load(f)
-    return HighscoreStruct(**data["highscore"]), data["cell_updates"]
+    with open(path, "rb") as f:
+        data = f.read()
+    if data[:2] != _GZIP_MAGIC:
+        game_replay = replay.Replay(data)
+        return HighscoreStruct(**game_replay.metadata["highscore"]), game_replay
+
+    data = json.loads(gzip.decompress(data))
+    highscore = HighscoreStruct(**data["highscore"])
+    x_size, y_size, _ = highscore.difficulty.get_board_values()
+    game_replay = replay.Replay.from_cell_updates(
+        x_size,
+        y_size,
+        [
+            (t, {tuple(c): CellContents.from_str(x) for c, x in updates})
+            for t, updates in data["cell_updates"]
+        ],
+    )
+    return highscore, game_replay
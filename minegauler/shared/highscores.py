@@ -11,34 +11,45 @@ __all__ = (
     "HighscoresDatabases",
     "filter_and_sort",
     "get_highscores",
+    "get_leaderboard",
     "insert_highscore",
     "retrieve_highscores",
+    "start_remote_uploader",
 )
 
 import abc
+import collections
+import contextlib
 import enum
 import logging
 import os
 import pathlib
 import sqlite3
 import threading
+import time
 from textwrap import dedent
-from typing import Dict, Iterable, List, Optional, Tuple
+from typing import TYPE_CHECKING, Any, Callable, Dict, Iterable, List, Optional, Tuple
 
 import attr
-import mysql.connector
-import mysql.connector.cursor
-import requests
 
 from .. import ROOT_DIR
-from . import utils
+from . import metrics, utils
 from .types import Difficulty, PathLike
 from .utils import StructConstructorMixin
 
 
+# The MySQL client and requests are only needed for the remote DB and posting
+#  highscores, so are imported on first use to keep startup fast.
+if TYPE_CHECKING:  # pragma: no cover
+    import mysql.connector
+    import mysql.connector.cursor
+    import requests
+
+
 logger = logging.getLogger(__name__)
 
 _REMOTE_POST_URL = "http://minegauler.lewisgaul.co.uk/api/v1/highscore"
+_REMOTE_BULK_POST_URL = "http://minegauler.lewisgaul.co.uk/api/v1/highscores/bulk"
 
 
 @attr.attrs(auto_attribs=True, frozen=True)
@@ -103,6 +114,88 @@ class AbstractHighscoresDB(abc.ABC):
         logger.debug("%s: Getting highscores", type(self).__name__)
         return NotImplemented
 
+    @abc.abstractmethod
+    def get_highscores_page(
+        self,
+        *,
+        difficulty: Optional[Difficulty] = None,
+        per_cell: Optional[int] = None,
+        drag_select: Optional[bool] = None,
+        name: Optional[str] = None,
+        after: Optional[Tuple[float, int]] = None,
+        limit: int,
+    ) -> List[Tuple[int, HighscoreStruct]]:
+        """
+        Fetch a page of highscores using the given filters, ordered by time.
+
+        :param after:
+            The (elapsed, id) key of the last highscore on the previous page, or
+            None to get the first page.
+        :param limit:
+            The maximum number of highscores to return.
+        :return:
+            A list of highscore IDs and the corresponding highscores. The last
+            entry gives the key to pass as 'after' to get the next page.
+        """
+        logger.debug("%s: Getting page of highscores", type(self).__name__)
+        return NotImplemented
+
+    @abc.abstractmethod
+    def get_latest_highscore_id(self) -> Optional[int]:
+        """Get the ID of the last highscore inserted, or None if there are none."""
+        return NotImplemented
+
+    @abc.abstractmethod
+    def get_leaderboard(
+        self,
+        *,
+        difficulty: Optional[Difficulty] = None,
+        per_cell: Optional[int] = None,
+        drag_select: Optional[bool] = None,
+        sort_by: str = "time",
+        flagging: Optional[str] = None,
+        limit: Optional[int] = None,
+        offset: int = 0,
+    ) -> List[HighscoreStruct]:
+        """
+        Fetch the best highscore for each player, ranked.
+
+        :param difficulty:
+            Optionally specify difficulty to filter by.
+        :param per_cell:
+            Optionally specify per_cell to filter by.
+        :param drag_select:
+            Optionally specify drag_select to filter by.
+        :param sort_by:
+            What to rank by, one of 'time' or '3bv/s'.
+        :param flagging:
+            Optionally filter by flagging ('F') or non-flagging ('NF').
+        :param limit:
+            Optionally limit the number of highscores returned.
+        :param offset:
+            The number of top highscores to skip.
+        """
+        logger.debug("%s: Getting leaderboard", type(self).__name__)
+        return NotImplemented
+
+    @abc.abstractmethod
+    def get_personal_best(
+        self, settings: HighscoreSettingsStruct, name: str
+    ) -> Optional[Tuple[float, float]]:
+        """
+        Look up a player's best time and 3bv/s for a settings group.
+
+        :param settings:
+            The settings group to look up.
+        :param name:
+            The name of the player (case insensitive).
+        :return:
+            The best time and best 3bv/s, or None if the player has no
+            highscores for the settings group.
+        """
+        logger.debug("%s: Getting personal best for %s", type(self).__name__, name)
+        return NotImplemented
+
     @abc.abstractmethod
     def count_highscores(self) -> int:
         """Count the number of rows in the highscores table."""
@@ -145,6 +238,17 @@ class _SQLMixin:
     """A mixin for SQL-like highscores databases."""
 
     _TABLE_NAME = "highscores"
+    _PB_TABLE_NAME = "personal_bests"
+    _PB_SELECT_SQL = (
+        f"SELECT name_lower, difficulty, per_cell, drag_select, "
+        f"MIN(elapsed), MAX(bbbvps) FROM {_TABLE_NAME} "
+        f"GROUP BY name_lower, difficulty, per_cell, drag_select"
+    )
+    # Command to insert or update a personal best, given the name, settings,
+    #  time and 3bv/s of a new highscore.
+    _UPSERT_PB_SQL: str
+    # Placeholder used for bound parameters in SQL commands.
+    _PARAM_FMT = "%s"
     _CREATE_TABLE_SQL = dedent(
         f"""\
         CREATE TABLE IF NOT EXISTS {_TABLE_NAME} (
@@ -160,6 +264,65 @@ class _SQLMixin:
             flagging REAL NOT NULL
         )"""
     )
+    # The commands to migrate the DB to each version, starting from the table
+    #  being created at version 0.
+    _MIGRATIONS: Dict[int, List[str]] = {
+        1: [
+            # Lower-case name for case-insensitive lookups that can use an index.
+            f"ALTER TABLE {_TABLE_NAME} "
+            f"ADD COLUMN name_lower VARCHAR(20) NOT NULL DEFAULT ''",
+            f"UPDATE {_TABLE_NAME} SET name_lower = LOWER(name)",
+            f"CREATE INDEX idx_{_TABLE_NAME}_settings_elapsed "
+            f"ON {_TABLE_NAME} (difficulty, per_cell, drag_select, elapsed)",
+            f"CREATE INDEX idx_{_TABLE_NAME}_settings_bbbvps "
+            f"ON {_TABLE_NAME} (difficulty, per_cell, drag_select, bbbvps)",
+            f"CREATE INDEX idx_{_TABLE_NAME}_name_lower "
+            f"ON {_TABLE_NAME} (name_lower)",
+        ],
+        2: [
+            # Each player's best time and 3bv/s per settings group, kept up to
+            #  date on insert.
+            dedent(
+                f"""\
+                CREATE TABLE {_PB_TABLE_NAME} (
+                    name_lower VARCHAR(20) NOT NULL,
+                    difficulty VARCHAR(1) NOT NULL,
+                    per_cell INTEGER NOT NULL,
+                    drag_select INTEGER NOT NULL,
+                    elapsed REAL NOT NULL,
+                    bbbvps REAL NOT NULL,
+                    PRIMARY KEY (name_lower, difficulty, per_cell, drag_select)
+                )"""
+            ),
+            f"INSERT INTO {_PB_TABLE_NAME} {_PB_SELECT_SQL}",
+        ],
+    }
+    _DB_VERSION = max(_MIGRATIONS)
+
+    def get_db_version(self) -> int:
+        """Get the database version number."""
+        raise NotImplementedError
+
+    def _set_db_version(self, version: int) -> None:
+        """Set the database version number."""
+        raise NotImplementedError
+
+    def migrate(self) -> None:
+        """Migrate the database to the latest version."""
+        version = self.get_db_version()
+        if version > self._DB_VERSION:
+            logger.warning(
+                "%s: DB version %d is newer than supported version %d",
+                type(self).__name__,
+                version,
+                self._DB_VERSION,
+            )
+        for version in range(version + 1, self._DB_VERSION + 1):
+            logger.info("%s: Migrating DB to version %d", type(self).__name__, version)
+            for cmd in self._MIGRATIONS[version]:
+                self.execute(cmd)
+            self._set_db_version(version)
+            self.conn.commit()
 
     def _get_select_highscores_sql(
         self,
@@ -168,30 +331,198 @@ class _SQLMixin:
         per_cell: Optional[int] = None,
         drag_select: Optional[bool] = None,
         name: Optional[str] = None,
-    ) -> str:
-        """Get the SQL command to get/select highscores from a DB."""
+        after: Optional[Tuple[float, int]] = None,
+        limit: Optional[int] = None,
+        with_id: bool = False,
+    ) -> Tuple[str, Tuple]:
+        """
+        Get the SQL command to get/select highscores from a DB.
+
+        :param after:
+            Optionally only select highscores ordered after the given
+            (elapsed, id) key.
+        :param limit:
+            Optionally limit the number of highscores selected.
+        :param with_id:
+            Whether to select the highscore ID before the other fields.
+        :return:
+            The SQL command and the parameters to bind to it.
+        """
+        fmt = self._PARAM_FMT
         conditions = []
+        params = []
         if difficulty is not None:
-            conditions.append(f"difficulty='{difficulty.value}'")
+            conditions.append(f"difficulty={fmt}")
+            params.append(difficulty.value)
         if per_cell is not None:
-            conditions.append(f"per_cell={per_cell}")
+            conditions.append(f"per_cell={fmt}")
+            params.append(per_cell)
         if drag_select is not None:
-            conditions.append(f"drag_select={drag_select:d}")
+            conditions.append(f"drag_select={fmt}")
+            params.append(int(drag_select))
         if name is not None:
-            conditions.append(f"LOWER(name)='{name.lower()}'")
-        return "SELECT {fields} FROM {table} {where} ORDER BY elapsed ASC".format(
-            fields=", ".join(_highscore_fields),
-            table=self._TABLE_NAME,
-            where="WHERE " + " AND ".join(conditions) if conditions else "",
+            conditions.append(f"name_lower=LOWER({fmt})")
+            params.append(name)
+        if after is not None:
+            conditions.append(f"(elapsed>{fmt} OR (elapsed={fmt} AND id>{fmt}))")
+            params.extend([after[0], after[0], after[1]])
+        fields = ", ".join((["id"] if with_id else []) + list(_highscore_fields))
+        where = "WHERE " + " AND ".join(conditions) if conditions else ""
+        sql = (
+            f"SELECT {fields} FROM {self._TABLE_NAME} {where} "
+            f"ORDER BY elapsed ASC, id ASC"
+        )
+        if limit is not None:
+            sql += f" LIMIT {fmt}"
+            params.append(limit)
+        return sql, tuple(params)
+
+    def _get_leaderboard_sql(
+        self,
+        *,
+        difficulty: Optional[Difficulty] = None,
+        per_cell: Optional[int] = None,
+        drag_select: Optional[bool] = None,
+        sort_by: str = "time",
+        flagging: Optional[str] = None,
+        limit: Optional[int] = None,
+        offset: int = 0,
+    ) -> Tuple[str, Tuple]:
+        """
+        Get the SQL command to select the best highscore for each player.
+
+        The ordering matches filter_and_sort(), with ties broken by 3bv.
+
+        :return:
+            The SQL command and the parameters to bind to it.
+        """
+        fmt = self._PARAM_FMT
+        if sort_by == "time":
+            order = "elapsed ASC, bbbv DESC"
+        elif sort_by == "3bv/s":
+            order = "bbbvps DESC, bbbv ASC, elapsed ASC"
+        else:
+            raise ValueError(f"Unrecognised sort key {sort_by!r}")
+        conditions = []
+        params = []
+        if difficulty is not None:
+            conditions.append(f"difficulty={fmt}")
+            params.append(difficulty.value)
+        if per_cell is not None:
+            conditions.append(f"per_cell={fmt}")
+            params.append(per_cell)
+        if drag_select is not None:
+            conditions.append(f"drag_select={fmt}")
+            params.append(int(drag_select))
+        if flagging == "F":
+            conditions.append(f"flagging>{fmt}")
+            params.append(utils.FLAGGING_THRESHOLD)
+        elif flagging == "NF":
+            conditions.append(f"flagging<={fmt}")
+            params.append(utils.FLAGGING_THRESHOLD)
+        fields = ", ".join(_highscore_fields)
+        where = "WHERE " + " AND ".join(conditions) if conditions else ""
+        sql = (
+            f"SELECT {fields} FROM ("
+            f"SELECT {fields}, ROW_NUMBER() OVER "
+            f"(PARTITION BY name_lower ORDER BY {order}) AS player_rank "
+            f"FROM {self._TABLE_NAME} {where}"
+            f") AS ranked WHERE player_rank=1 ORDER BY {order} "
+            f"LIMIT {fmt} OFFSET {fmt}"
         )
+        # An explicit limit is required in order to give an offset.
+        params.extend([limit if limit is not None else 2 ** 63 - 1, offset])
+        return sql, tuple(params)
 
-    def _get_insert_highscore_sql(self, fmt="%s") -> str:
-        """Get the SQL command to insert a highscore into a DB."""
-        return "INSERT INTO {table} ({fields}) VALUES ({fmt_})".format(
+    def _get_insert_highscore_sql(self) -> str:
+        """
+        Get the SQL command to insert a highscore into a DB.
+
+        The parameters should be the highscore fields in order, followed by the
+        name again to be stored in lower case.
+        """
+        fmt = self._PARAM_FMT
+        return "INSERT INTO {table} ({fields}, name_lower) VALUES ({fmt_})".format(
             table=self._TABLE_NAME,
             fields=", ".join(_highscore_fields),
-            fmt_=", ".join(fmt for _ in _highscore_fields),
+            fmt_=", ".join([fmt for _ in _highscore_fields] + [f"LOWER({fmt})"]),
+        )
+
+    @staticmethod
+    def _get_insert_highscore_params(highscore: HighscoreStruct) -> Tuple:
+        """Get the parameters for the SQL command to insert a highscore."""
+        return (*attr.astuple(highscore), highscore.name)
+
+    @staticmethod
+    def _get_upsert_pb_params(highscore: HighscoreStruct) -> Tuple:
+        """Get the parameters for the SQL command to update a personal best."""
+        return (
+            highscore.name,
+            highscore.difficulty.value,
+            highscore.per_cell,
+            int(highscore.drag_select),
+            highscore.elapsed,
+            highscore.bbbvps,
+        )
+
+    def _get_select_pb_sql(
+        self, settings: HighscoreSettingsStruct, name: str
+    ) -> Tuple[str, Tuple]:
+        """Get the SQL command to look up a personal best."""
+        fmt = self._PARAM_FMT
+        sql = (
+            f"SELECT elapsed, bbbvps FROM {self._PB_TABLE_NAME} "
+            f"WHERE name_lower=LOWER({fmt}) AND difficulty={fmt} "
+            f"AND per_cell={fmt} AND drag_select={fmt}"
+        )
+        params = (
+            name,
+            settings.difficulty.value,
+            settings.per_cell,
+            int(settings.drag_select),
+        )
+        return sql, params
+
+    def get_personal_best(
+        self, settings: HighscoreSettingsStruct, name: str
+    ) -> Optional[Tuple[float, float]]:
+        super().get_personal_best(settings, name)
+        rows = self.execute(*self._get_select_pb_sql(settings, name)).fetchall()
+        return tuple(rows[0]) if rows else None
+
+    def get_highscores_page(
+        self,
+        *,
+        difficulty: Optional[Difficulty] = None,
+        per_cell: Optional[int] = None,
+        drag_select: Optional[bool] = None,
+        name: Optional[str] = None,
+        after: Optional[Tuple[float, int]] = None,
+        limit: int,
+    ) -> List[Tuple[int, HighscoreStruct]]:
+        super().get_highscores_page(
+            difficulty=difficulty,
+            per_cell=per_cell,
+            drag_select=drag_select,
+            name=name,
+            after=after,
+            limit=limit,
         )
+        sql, params = self._get_select_highscores_sql(
+            difficulty=difficulty,
+            per_cell=per_cell,
+            drag_select=drag_select,
+            name=name,
+            after=after,
+            limit=limit,
+            with_id=True,
+        )
+        rows = self.execute(sql, params).fetchall()
+        return [(r[0], HighscoreStruct(*r[1:])) for r in rows]
+
+    def get_latest_highscore_id(self) -> Optional[int]:
+        rows = self.execute(f"SELECT MAX(id) FROM {self._TABLE_NAME}").fetchall()
+        return rows[0][0]
 
     def _get_highscores_count_sql(self) -> str:
         """Get the SQL command to count the rows of the highscores table."""
@@ -201,6 +532,52 @@ class _SQLMixin:
 class LocalHighscoresDB(_SQLMixin, AbstractHighscoresDB):
     """Database of local highscores."""
 
+    _PARAM_FMT = "?"
+    _PB_CONFLICT_SQL = (
+        f"ON CONFLICT (name_lower, difficulty, per_cell, drag_select) DO UPDATE SET "
+        f"elapsed=MIN(elapsed, excluded.elapsed), "
+        f"bbbvps=MAX(bbbvps, excluded.bbbvps)"
+    )
+    _UPSERT_PB_SQL = (
+        f"INSERT INTO {_SQLMixin._PB_TABLE_NAME} "
+        f"VALUES (LOWER(?), ?, ?, ?, ?, ?) " + _PB_CONFLICT_SQL
+    )
+    _OUTBOX_TABLE_NAME = "remote_outbox"
+    # The local DB additionally keeps highscores waiting to be posted to the
+    #  remote server, so that they survive the app being closed or the server
+    #  being unreachable.
+    _MIGRATIONS = {
+        **_SQLMixin._MIGRATIONS,
+        3: [
+            dedent(
+                f"""\
+                CREATE TABLE {_OUTBOX_TABLE_NAME} (
+                    id INTEGER PRIMARY KEY,
+                    difficulty VARCHAR(1) NOT NULL,
+                    per_cell INTEGER NOT NULL,
+                    drag_select INTEGER NOT NULL,
+                    name VARCHAR(20) NOT NULL,
+                    timestamp INTEGER NOT NULL,
+                    elapsed REAL NOT NULL,
+                    bbbv INTEGER NOT NULL,
+                    bbbvps REAL NOT NULL,
+                    flagging REAL NOT NULL
+                )"""
+            ),
+        ],
+        4: [
+            # Remove any duplicates so that merging from another DB can rely on
+            #  a unique index to skip highscores already present.
+            f"DELETE FROM {_SQLMixin._TABLE_NAME} WHERE id NOT IN ("
+            f"SELECT MIN(id) FROM {_SQLMixin._TABLE_NAME} "
+            f"GROUP BY name, timestamp, difficulty, per_cell, drag_select, elapsed)",
+            f"CREATE UNIQUE INDEX idx_{_SQLMixin._TABLE_NAME}_natural_key "
+            f"ON {_SQLMixin._TABLE_NAME} "
+            f"(name, timestamp, difficulty, per_cell, drag_select, elapsed)",
+        ],
+    }
+    _DB_VERSION = max(_MIGRATIONS)
+
     def __init__(self, path: pathlib.Path = ROOT_DIR / "data" / "highscores.db"):
         self._path = path
         if os.path.exists(path):
@@ -211,6 +588,9 @@ class LocalHighscoresDB(_SQLMixin, AbstractHighscoresDB):
 
             self.execute(self._CREATE_TABLE_SQL)
             self.execute("PRAGMA user_version = 0")
+        # Allow reading while another connection is writing.
+        self.execute("PRAGMA journal_mode = WAL")
+        self.migrate()
 
     @property
     def conn(self) -> sqlite3.Connection:
@@ -232,6 +612,10 @@ class LocalHighscoresDB(_SQLMixin, AbstractHighscoresDB):
         cursor = self.execute("PRAGMA user_version")
         return self.extract_single_elem(cursor)
 
+    def _set_db_version(self, version: int) -> None:
+        # PRAGMA does not support bound parameters.
+        self.execute(f"PRAGMA user_version = {version:d}")
+
     def get_highscores(
         self,
         *,
@@ -245,7 +629,7 @@ class LocalHighscoresDB(_SQLMixin, AbstractHighscoresDB):
         )
         self._conn.row_factory = self._highscore_row_factory
         cursor = self.execute(
-            self._get_select_highscores_sql(
+            *self._get_select_highscores_sql(
                 difficulty=difficulty,
                 per_cell=per_cell,
                 drag_select=drag_select,
@@ -255,41 +639,157 @@ class LocalHighscoresDB(_SQLMixin, AbstractHighscoresDB):
         self._conn.row_factory = None
         return cursor.fetchall()
 
+    def get_leaderboard(
+        self,
+        *,
+        difficulty: Optional[Difficulty] = None,
+        per_cell: Optional[int] = None,
+        drag_select: Optional[bool] = None,
+        sort_by: str = "time",
+        flagging: Optional[str] = None,
+        limit: Optional[int] = None,
+        offset: int = 0,
+    ) -> List[HighscoreStruct]:
+        super().get_leaderboard(
+            difficulty=difficulty,
+            per_cell=per_cell,
+            drag_select=drag_select,
+            sort_by=sort_by,
+            flagging=flagging,
+            limit=limit,
+            offset=offset,
+        )
+        self._conn.row_factory = self._highscore_row_factory
+        cursor = self.execute(
+            *self._get_leaderboard_sql(
+                difficulty=difficulty,
+                per_cell=per_cell,
+                drag_select=drag_select,
+                sort_by=sort_by,
+                flagging=flagging,
+                limit=limit,
+                offset=offset,
+            )
+        )
+        self._conn.row_factory = None
+        return cursor.fetchall()
+
     def count_highscores(self) -> int:
         """Count the number of rows in the highscores table."""
         super().count_highscores()
         return next(self.execute(self._get_highscores_count_sql()))[0]
 
     def merge_highscores(self, path: PathLike) -> int:
-        """Merge in highscores from a given other SQLite DB."""
+        """
+        Merge in highscores from a given other SQLite DB.
+
+        Highscores already present are skipped. The merge is done in a single
+        transaction, so either all or none of the highscores are added.
+
+        :return:
+            The number of highscores added.
+        """
         if pathlib.Path(path) == self._path:
             raise ValueError("Cannot merge database into itself")
 
         hs_table = self._TABLE_NAME
-        tmp_table = "mergedTable"
         attach_db = "toMergeDB"
 
-        first_count = self.count_highscores()
-        self.execute(f"ATTACH DATABASE '{path!s}' AS {attach_db}")
+        # Attaching can't be done inside a transaction.
+        self.execute(f"ATTACH DATABASE ? AS {attach_db}", (str(path),))
+        try:
+            with self._conn:
+                # Only use columns that are present in older DB versions.
+                fields = ", ".join(_highscore_fields)
+                added = self.execute(
+                    f"INSERT OR IGNORE INTO {hs_table} ({fields}, name_lower) "
+                    f"SELECT {fields}, LOWER(name) FROM {attach_db}.{hs_table}"
+                ).rowcount
+                # 'WHERE true' avoids the upsert being parsed as a join clause.
+                self.execute(
+                    f"INSERT INTO {self._PB_TABLE_NAME} "
+                    f"SELECT LOWER(name), difficulty, per_cell, drag_select, "
+                    f"MIN(elapsed), MAX(bbbvps) FROM {attach_db}.{hs_table} "
+                    f"WHERE true "
+                    f"GROUP BY LOWER(name), difficulty, per_cell, drag_select "
+                    + self._PB_CONFLICT_SQL
+                )
+        finally:
+            self.execute(f"DETACH DATABASE {attach_db}")
+        return added
 
-        self.execute(
-            f"CREATE TABLE IF NOT EXISTS {tmp_table} AS "
-            f"SELECT * FROM {hs_table} UNION SELECT * FROM {attach_db}.{hs_table}"
-        )
-        # TODO: This is not completely atomic, can we do better?
-        self.execute(f"DROP TABLE IF EXISTS {hs_table}")
-        self.execute(f"ALTER TABLE {tmp_table} RENAME TO {hs_table}")
-        self.execute(f"DETACH DATABASE {attach_db}")
-        self.conn.commit()
-        return self.count_highscores() - first_count
+    def insert_highscores(self, highscores: Iterable[HighscoreStruct]) -> int:
+        """
+        Insert highscores into the database in a single transaction, skipping any
+        already present.
 
-    def insert_highscore(self, highscore: HighscoreStruct) -> None:
+        :param highscores:
+            The highscores to insert.
+        :return:
+            The number of highscores added.
+        """
+        highscores = list(highscores)
+        with self._conn:
+            added = self._conn.executemany(
+                self._get_insert_highscore_sql().replace("INSERT", "INSERT OR IGNORE"),
+                [self._get_insert_highscore_params(h) for h in highscores],
+            ).rowcount
+            self._conn.executemany(
+                self._UPSERT_PB_SQL, [self._get_upsert_pb_params(h) for h in highscores]
+            )
+        return added
+
+    def insert_highscore(
+        self, highscore: HighscoreStruct, *, upload: bool = False
+    ) -> None:
+        """
+        Insert a single highscore into the database.
+
+        :param highscore:
+            The highscore to insert.
+        :param upload:
+            Whether to also add the highscore to the outbox of highscores to be
+            posted to the remote server, see `get_outbox()`.
+        """
         super().insert_highscore(highscore)
-        self.execute(
-            self._get_insert_highscore_sql(fmt="?"),
-            attr.astuple(highscore),
-            commit=True,
+        with self._conn:
+            self.execute(
+                self._get_insert_highscore_sql(),
+                self._get_insert_highscore_params(highscore),
+            )
+            self.execute(self._UPSERT_PB_SQL, self._get_upsert_pb_params(highscore))
+            if upload:
+                fields = ", ".join(_highscore_fields)
+                self.execute(
+                    f"INSERT INTO {self._OUTBOX_TABLE_NAME} ({fields}) "
+                    f"VALUES ({', '.join('?' * len(_highscore_fields))})",
+                    attr.astuple(highscore),
+                )
+
+    def get_outbox(self, limit: int) -> List[Tuple[int, HighscoreStruct]]:
+        """
+        Get the oldest highscores waiting to be posted to the remote server.
+
+        :param limit:
+            The maximum number of highscores to get.
+        :return:
+            A list of outbox IDs and the corresponding highscores, in the order
+            they were added.
+        """
+        fields = ", ".join(_highscore_fields)
+        cursor = self.execute(
+            f"SELECT id, {fields} FROM {self._OUTBOX_TABLE_NAME} ORDER BY id LIMIT ?",
+            (limit,),
+        )
+        return [(row[0], HighscoreStruct(*row[1:])) for row in cursor.fetchall()]
+
+    def remove_from_outbox(self, ids: Iterable[int]) -> None:
+        """Remove highscores from the outbox once posted to the remote server."""
+        self._conn.executemany(
+            f"DELETE FROM {self._OUTBOX_TABLE_NAME} WHERE id = ?",
+            [(i,) for i in ids],
         )
+        self._conn.commit()
 
     def execute(
         self, cmd: str, params: Tuple = (), *, commit=False, **cursor_args
@@ -297,42 +797,318 @@ class LocalHighscoresDB(_SQLMixin, AbstractHighscoresDB):
         return super().execute(cmd, params, commit=commit, **cursor_args)
 
 
+class _ConnectionPool:
+    """
+    A bounded, thread-safe pool of database connections.
+
+    Connections are created lazily, up to the maximum pool size. Checking out
+    a connection blocks while the pool is exhausted, and idle connections are
+    checked for liveness before being handed out, being transparently replaced
+    if they have gone stale.
+    """
+
+    def __init__(
+        self,
+        connect: Callable[[], Any],
+        is_alive: Callable[[Any], bool],
+        *,
+        max_size: int,
+        timeout: float,
+    ):
+        """
+        :param connect:
+            Function to create a new connection.
+        :param is_alive:
+            Function to check whether a connection is still usable.
+        :param max_size:
+            The maximum number of connections to have open at once.
+        :param timeout:
+            The maximum time in seconds to wait for a connection to be released
+            when the pool is exhausted.
+        """
+        self._connect = connect
+        self._is_alive = is_alive
+        self.max_size = max_size
+        self.timeout = timeout
+        self._idle: List[Any] = []
+        self._nr_open = 0
+        self._cond = threading.Condition()
+        self._counters = collections.Counter()
+
+    def stats(self) -> Dict[str, int]:
+        """
+        Get metrics for the pool.
+
+        :return:
+            A dictionary of counters ('checkouts', 'waits', 'timeouts',
+            'created', 'stale', 'reconnects', 'discarded') along with the
+            current number of 'open', 'idle' and 'in_use' connections.
+        """
+        with self._cond:
+            return dict(
+                self._counters,
+                max_size=self.max_size,
+                open=self._nr_open,
+                idle=len(self._idle),
+                in_use=self._nr_open - len(self._idle),
+            )
+
+    def configure(self, *, max_size: int, timeout: float) -> None:
+        """
+        Reconfigure the pool. Shrinking takes effect as connections are released.
+        """
+        with self._cond:
+            self.max_size = max_size
+            self.timeout = timeout
+            self._cond.notify_all()
+
+    def acquire(self) -> Any:
+        """
+        Check out a connection from the pool.
+
+        :raise DBConnectionError:
+            If timed out waiting for a connection or unable to connect.
+        """
+        deadline = time.monotonic() + self.timeout
+        with self._cond:
+            self._counters["checkouts"] += 1
+            if not self._idle and self._nr_open >= self.max_size:
+                self._counters["waits"] += 1
+                logger.debug("DB connection pool exhausted, waiting: %s", self.stats())
+            while not self._idle and self._nr_open >= self.max_size:
+                remaining = deadline - time.monotonic()
+                if remaining <= 0:
+                    self._counters["timeouts"] += 1
+                    raise DBConnectionError("Timed out waiting for a DB connection")
+                self._cond.wait(remaining)
+            if self._idle:
+                conn = self._idle.pop()
+            else:
+                # Reserve the slot before connecting outside of the lock.
+                conn = None
+                self._nr_open += 1
+
+        if conn is not None and not self._is_alive(conn):
+            logger.info("Replacing stale DB connection")
+            with self._cond:
+                self._counters["stale"] += 1
+            self._close(conn)
+            conn = None
+        if conn is None:
+            conn = self._new_connection()
+        return conn
+
+    def release(self, conn: Any, *, discard: bool = False) -> None:
+        """
+        Return a connection to the pool.
+
+        :param conn:
+            The connection previously checked out with `acquire()`.
+        :param discard:
+            Whether to close the connection rather than keep it for reuse.
+        """
+        with self._cond:
+            if self._nr_open > self.max_size:
+                discard = True
+            if discard:
+                self._counters["discarded"] += 1
+                self._nr_open -= 1
+            else:
+                self._idle.append(conn)
+            self._cond.notify()
+        if discard:
+            self._close(conn)
+
+    def reconnect(self, conn: Any) -> Any:
+        """
+        Replace a checked out connection with a new one.
+
+        :param conn:
+            The connection to replace, which is closed.
+        :return:
+            The new connection, checked out in place of the old one.
+        :raise DBConnectionError:
+            If unable to connect, in which case the old connection is no longer
+            considered checked out.
+        """
+        with self._cond:
+            self._counters["reconnects"] += 1
+        self._close(conn)
+        return self._new_connection()
+
+    def _new_connection(self) -> Any:
+        """Create a connection for a slot already reserved in the pool."""
+        try:
+            conn = self._connect()
+        except BaseException:
+            with self._cond:
+                self._nr_open -= 1
+                self._cond.notify()
+            raise
+        with self._cond:
+            self._counters["created"] += 1
+        return conn
+
+    @staticmethod
+    def _close(conn: Any) -> None:
+        try:
+            conn.close()
+        except Exception:
+            logger.debug("Error closing DB connection", exc_info=True)
+
+
 class RemoteHighscoresDB(_SQLMixin, AbstractHighscoresDB):
-    """Remote highscores database."""
+    """
+    Remote highscores database.
+
+    Connections are taken from a pool shared between instances, with a
+    connection checked out for the duration of each operation. The pool can be
+    configured with `configure_pool()`.
+    """
 
     _USER = "admin"
     _HOST = "minegauler-highscores.cb4tvkuqujyi.eu-west-2.rds.amazonaws.com"
     _DB_NAME = "minegauler"
 
-    _cached_conn: Optional[mysql.connector.MySQLConnection] = None
+    _UPSERT_PB_SQL = (
+        f"INSERT INTO {_SQLMixin._PB_TABLE_NAME} "
+        f"VALUES (LOWER(%s), %s, %s, %s, %s, %s) "
+        f"ON DUPLICATE KEY UPDATE "
+        f"elapsed=LEAST(elapsed, VALUES(elapsed)), "
+        f"bbbvps=GREATEST(bbbvps, VALUES(bbbvps))"
+    )
+
+    _POOL_SIZE = 5
+    _POOL_TIMEOUT = 10
+
+    _pool: Optional[_ConnectionPool] = None
+    _pool_lock = threading.Lock()
 
     def __init__(self):
+        self._conn: Optional["mysql.connector.MySQLConnection"] = None
+        # Whether commands have been run since the last commit, in which case
+        # it's not safe to retry a failed command on a new connection.
+        self._in_transaction = False
+
+    @property
+    def conn(self) -> "mysql.connector.MySQLConnection":
+        return self._conn
+
+    @classmethod
+    def configure_pool(
+        cls, *, max_size: Optional[int] = None, timeout: Optional[float] = None
+    ) -> None:
+        """
+        Configure the connection pool shared between instances.
+
+        :param max_size:
+            The maximum number of connections to have open at once.
+        :param timeout:
+            The maximum time in seconds to wait for a free connection.
+        """
+        with cls._pool_lock:
+            if max_size is not None:
+                if max_size < 1:
+                    raise ValueError("Pool size must be at least 1")
+                cls._POOL_SIZE = max_size
+            if timeout is not None:
+                cls._POOL_TIMEOUT = timeout
+            if cls._pool:
+                cls._pool.configure(
+                    max_size=cls._POOL_SIZE, timeout=cls._POOL_TIMEOUT
+                )
+
+    @classmethod
+    def pool_stats(cls) -> Dict[str, int]:
+        """Get metrics for the connection pool, see `_ConnectionPool.stats()`."""
+        return cls._get_pool().stats()
+
+    @classmethod
+    def _get_pool(cls) -> _ConnectionPool:
+        with cls._pool_lock:
+            if not cls._pool:
+                cls._pool = _ConnectionPool(
+                    cls._connect,
+                    lambda conn: conn.is_connected(),
+                    max_size=cls._POOL_SIZE,
+                    timeout=cls._POOL_TIMEOUT,
+                )
+            return cls._pool
+
+    @classmethod
+    def _connect(cls) -> "mysql.connector.MySQLConnection":
         """
         :raise DBConnectionError:
             If connecting to the DB fails for any reason.
         """
-        if not self._cached_conn:
-            logger.info("Initialising connection to remote highscores DB")
-            try:
-                self._cached_conn = mysql.connector.connect(
-                    user=self._USER,
-                    password=self._PASSWORD,
-                    host=self._HOST,
-                    database=self._DB_NAME,
-                )
-            except mysql.connector.Error as e:
-                raise DBConnectionError(
-                    "Unable to connect to remote highscores database"
-                ) from e
-        self._conn = self._cached_conn
+        import mysql.connector
 
-    @property
-    def conn(self) -> mysql.connector.MySQLConnection:
-        return self._conn
+        logger.info("Initialising connection to remote highscores DB")
+        try:
+            return mysql.connector.connect(
+                user=cls._USER,
+                password=os.environ.get("SQL_DB_PASSWORD"),
+                host=cls._HOST,
+                database=cls._DB_NAME,
+            )
+        except mysql.connector.Error as e:
+            raise DBConnectionError(
+                "Unable to connect to remote highscores database"
+            ) from e
 
-    @property
-    def _PASSWORD(self):
-        return os.environ.get("SQL_DB_PASSWORD")
+    @contextlib.contextmanager
+    def _connection(self):
+        """
+        Check out a connection for the duration of the context, unless one is
+        already checked out by this instance.
+
+        :raise DBConnectionError:
+            If unable to get a connection.
+        """
+        import mysql.connector
+
+        if self._conn is not None:
+            yield
+            return
+        pool = self._get_pool()
+        self._conn = pool.acquire()
+        self._in_transaction = False
+        try:
+            yield
+        finally:
+            conn, self._conn = self._conn, None
+            if conn is not None:
+                # End any open transaction so that the next user of the
+                # connection doesn't see stale reads or uncommitted changes.
+                try:
+                    conn.rollback()
+                except mysql.connector.Error:
+                    pool.release(conn, discard=True)
+                else:
+                    pool.release(conn)
+
+    def get_db_version(self) -> int:
+        """
+        Get the database version number.
+
+        MySQL has no equivalent of SQLite's 'user_version', so the version is
+        determined from the presence of the columns/tables added by migrations.
+        """
+        with self._connection():
+            cursor = self.execute("SHOW TABLES LIKE %s", (self._PB_TABLE_NAME,))
+            if cursor.fetchall():
+                return 2
+            cursor = self.execute(
+                f"SHOW COLUMNS FROM {self._TABLE_NAME} LIKE %s", ("name_lower",)
+            )
+            return 1 if cursor.fetchall() else 0
+
+    def _set_db_version(self, version: int) -> None:
+        pass
+
+    def migrate(self) -> None:
+        with self._connection():
+            super().migrate()
 
     def get_highscores(
         self,
@@ -345,35 +1121,110 @@ class RemoteHighscoresDB(_SQLMixin, AbstractHighscoresDB):
         super().get_highscores(
             difficulty=difficulty, per_cell=per_cell, drag_select=drag_select, name=name
         )
-        cursor = self.execute(
-            self._get_select_highscores_sql(
-                difficulty=difficulty,
-                per_cell=per_cell,
-                drag_select=drag_select,
-                name=name,
-            ),
-            dictionary=True,
+        sql, params = self._get_select_highscores_sql(
+            difficulty=difficulty,
+            per_cell=per_cell,
+            drag_select=drag_select,
+            name=name,
         )
-        return [HighscoreStruct(**r) for r in cursor.fetchall()]
+        with self._connection():
+            cursor = self.execute(sql, params, dictionary=True)
+            return [HighscoreStruct(**r) for r in cursor.fetchall()]
+
+    def get_leaderboard(
+        self,
+        *,
+        difficulty: Optional[Difficulty] = None,
+        per_cell: Optional[int] = None,
+        drag_select: Optional[bool] = None,
+        sort_by: str = "time",
+        flagging: Optional[str] = None,
+        limit: Optional[int] = None,
+        offset: int = 0,
+    ) -> List[HighscoreStruct]:
+        super().get_leaderboard(
+            difficulty=difficulty,
+            per_cell=per_cell,
+            drag_select=drag_select,
+            sort_by=sort_by,
+            flagging=flagging,
+            limit=limit,
+            offset=offset,
+        )
+        sql, params = self._get_leaderboard_sql(
+            difficulty=difficulty,
+            per_cell=per_cell,
+            drag_select=drag_select,
+            sort_by=sort_by,
+            flagging=flagging,
+            limit=limit,
+            offset=offset,
+        )
+        with self._connection():
+            cursor = self.execute(sql, params, dictionary=True)
+            return [HighscoreStruct(**r) for r in cursor.fetchall()]
 
     def count_highscores(self) -> int:
         """Count the number of rows in the highscores table."""
         super().count_highscores()
-        return next(self.execute(self._get_highscores_count_sql()))[0]
+        with self._connection():
+            return self.execute(self._get_highscores_count_sql()).fetchall()[0][0]
+
+    def get_personal_best(
+        self, settings: HighscoreSettingsStruct, name: str
+    ) -> Optional[Tuple[float, float]]:
+        with self._connection():
+            return super().get_personal_best(settings, name)
+
+    def get_highscores_page(self, **kwargs) -> List[Tuple[int, HighscoreStruct]]:
+        with self._connection():
+            return super().get_highscores_page(**kwargs)
+
+    def get_latest_highscore_id(self) -> Optional[int]:
+        with self._connection():
+            return super().get_latest_highscore_id()
 
     def insert_highscore(self, highscore: HighscoreStruct) -> None:
         super().insert_highscore(highscore)
-        self.execute(
-            self._get_insert_highscore_sql(), attr.astuple(highscore), commit=True
-        )
+        # Both commands are committed together.
+        with self._connection():
+            self.execute(
+                self._get_insert_highscore_sql(),
+                self._get_insert_highscore_params(highscore),
+            )
+            self.execute(
+                self._UPSERT_PB_SQL, self._get_upsert_pb_params(highscore), commit=True
+            )
 
     def execute(
         self, cmd: str, params: Tuple = (), *, commit=False, **cursor_args
-    ) -> mysql.connector.cursor.MySQLCursor:
+    ) -> "mysql.connector.cursor.MySQLCursor":
+        import mysql.connector
+
+        if self._conn is None:
+            # Results must be fetched before the connection is released.
+            cursor_args.setdefault("buffered", True)
+            with self._connection():
+                return self.execute(cmd, params, commit=commit, **cursor_args)
         try:
-            return super().execute(cmd, params, commit=commit, **cursor_args)
+            try:
+                cursor = super().execute(cmd, params, commit=commit, **cursor_args)
+            except (
+                mysql.connector.InterfaceError,
+                mysql.connector.OperationalError,
+            ) as e:
+                if self._in_transaction:
+                    raise
+                # Nothing uncommitted would be lost, so retry once on a fresh
+                # connection in case this one had been dropped by the server.
+                logger.warning("Retrying DB command on a new connection: %s", e)
+                conn, self._conn = self._conn, None
+                self._conn = self._get_pool().reconnect(conn)
+                cursor = super().execute(cmd, params, commit=commit, **cursor_args)
         except mysql.connector.Error as e:
             raise DBConnectionError("Error occurred trying to execute command") from e
+        self._in_transaction = not commit
+        return cursor
 
 
 class HighscoresDatabases(enum.Enum):
@@ -386,6 +1237,23 @@ class HighscoresDatabases(enum.Enum):
         return self.value()
 
 
+def _metrics_group(
+    database: HighscoresDatabases,
+    difficulty: Optional[Difficulty],
+    per_cell: Optional[int],
+    drag_select: Optional[bool],
+) -> Optional[str]:
+    """Get the group to record query latency under, only if metrics are enabled."""
+    if not metrics.is_enabled():
+        return None
+    values = [
+        difficulty.value if difficulty else "*",
+        "*" if per_cell is None else str(per_cell),
+        "*" if drag_select is None else str(int(drag_select)),
+    ]
+    return f"{database.name.lower()}:" + "/".join(values)
+
+
 def get_highscores(
     database=HighscoresDatabases.LOCAL,
     *,
@@ -415,22 +1283,111 @@ def get_highscores(
         difficulty = settings.difficulty
         per_cell = settings.per_cell
         drag_select = settings.drag_select
-    return database.get_db_instance().get_highscores(
-        difficulty=difficulty, per_cell=per_cell, drag_select=drag_select, name=name
-    )
+    with metrics.timer(
+        "highscores.get_highscores",
+        group=_metrics_group(database, difficulty, per_cell, drag_select),
+    ):
+        return database.get_db_instance().get_highscores(
+            difficulty=difficulty, per_cell=per_cell, drag_select=drag_select, name=name
+        )
+
+
+def get_leaderboard(
+    database=HighscoresDatabases.LOCAL,
+    *,
+    settings: Optional[HighscoreSettingsStruct] = None,
+    difficulty: Optional[Difficulty] = None,
+    per_cell: Optional[int] = None,
+    drag_select: Optional[bool] = None,
+    sort_by: str = "time",
+    filters: Dict[str, Optional[str]] = {},
+    limit: Optional[int] = None,
+    offset: int = 0,
+) -> List[HighscoreStruct]:
+    """
+    Fetch ranked highscores from a database.
+
+    This gives the same result as filter_and_sort() on the highscores matching
+    the settings, with the ranking done by the database. Without a name filter
+    only the best highscore for each player is included.
+
+    :param database:
+        The database type to fetch from.
+    :param settings:
+        Optionally specify settings to filter by.
+    :param difficulty:
+        Optionally specify difficulty to filter by. Ignored if settings given.
+    :param per_cell:
+        Optionally specify per_cell to filter by. Ignored if settings given.
+    :param drag_select:
+        Optionally specify drag_select to filter by. Ignored if settings given.
+    :param sort_by:
+        What to rank by, one of 'time' or '3bv/s'.
+    :param filters:
+        What filters to apply, supporting 'name' and 'flagging'.
+    :param limit:
+        Optionally limit the number of highscores returned.
+    :param offset:
+        The number of top highscores to skip.
+    """
+    if settings is not None:
+        difficulty = settings.difficulty
+        per_cell = settings.per_cell
+        drag_select = settings.drag_select
+    filters = {k: f for k, f in filters.items() if f}
+    with metrics.timer(
+        "highscores.get_leaderboard",
+        group=_metrics_group(database, difficulty, per_cell, drag_select),
+    ):
+        db = database.get_db_instance()
+        if "name" in filters:
+            # All of a single player's highscores, which is a small number to sort.
+            ret = filter_and_sort(
+                db.get_highscores(
+                    difficulty=difficulty,
+                    per_cell=per_cell,
+                    drag_select=drag_select,
+                    name=filters["name"],
+                ),
+                sort_by,
+                filters,
+            )
+            return ret[offset : offset + limit if limit is not None else None]
+        return db.get_leaderboard(
+            difficulty=difficulty,
+            per_cell=per_cell,
+            drag_select=drag_select,
+            sort_by=sort_by,
+            flagging=filters.get("flagging"),
+            limit=limit,
+            offset=offset,
+        )
 
 
 def insert_highscore(highscore: HighscoreStruct) -> None:
-    """Insert a highscore into DBs."""
-    LocalHighscoresDB().insert_highscore(highscore)
+    """
+    Insert a highscore into the local DB, queueing it to be posted to the remote
+    server in the background.
+    """
+    with metrics.timer("highscores.insert_highscore"):
+        LocalHighscoresDB().insert_highscore(highscore, upload=True)
+    start_remote_uploader().notify()
 
-    def _post_catch_exc():
-        try:
-            _post_highscore_to_remote(highscore)
-        except Exception:
-            logger.exception("Failed to insert highscore into remote DB")
 
-    threading.Thread(target=_post_catch_exc).start()
+def start_remote_uploader() -> "_RemoteUploader":
+    """
+    Start the background uploader of highscores to the remote server, if not
+    already started.
+
+    Any highscores left in the outbox from a previous run are posted straight
+    away.
+    """
+    global _uploader
+    with _uploader_lock:
+        if _uploader is None:
+            _uploader = _RemoteUploader(LocalHighscoresDB().path)
+            _uploader.start()
+        return _uploader
 
 
 def retrieve_highscores(path: PathLike) -> int:
@@ -479,21 +1436,22 @@ def filter_and_sort(
         ret.sort(key=lambda h: (h.bbbvps, -h.bbbv), reverse=True)
     if "name" not in filters:
         # If no name filter, only include best highscore for each name.
-        names = []
-        i = 0
-        while i < len(ret):
-            hs = ret[i]
-            name = hs["name"].lower()
-            if name in names:
-                ret.pop(i)
-            else:
-                names.append(name)
-                i += 1
+        names = set()
+        best = []
+        for hs in ret:
+            name = hs.name.lower()
+            if name not in names:
+                names.add(name)
+                best.append(hs)
+        ret = best
     return ret
 
 
 def is_highscore_new_best(
-    highscore: HighscoreStruct, all_highscores: Iterable[HighscoreStruct]
+    highscore: HighscoreStruct,
+    all_highscores: Optional[Iterable[HighscoreStruct]] = None,
+    *,
+    database=HighscoresDatabases.LOCAL,
 ) -> Optional[str]:
     """
     Test to see if a new top highscore has been set.
@@ -501,12 +1459,24 @@ def is_highscore_new_best(
     :param highscore:
         The highscore to check.
     :param all_highscores:
-        The list of highscores to check against. May or may not include the
-        highscore being checked.
+        Optionally give the list of highscores to check against. May or may not
+        include the highscore being checked. If not given, the player's
+        personal best is looked up in the database, which is much faster.
+    :param database:
+        The database to look up the personal best in, if no highscores given.
     :return:
         If a new highscore was set, return which category it was set in. If not,
         return None.
     """
+    if all_highscores is None:
+        best = database.get_db_instance().get_personal_best(highscore, highscore.name)
+        if best is None or highscore.elapsed <= best[0]:
+            return "time"
+        elif highscore.bbbvps >= best[1]:
+            return "3bv/s"
+        else:
+            return None
+
     all_highscores = list(all_highscores)
     top_time = filter_and_sort(all_highscores, "time", {"name": highscore.name})
     top_3bvps = filter_and_sort(all_highscores, "3bv/s", {"name": highscore.name})
@@ -518,7 +1488,148 @@ def is_highscore_new_best(
         return None
 
 
-def _post_highscore_to_remote(highscore: HighscoreStruct):
-    """Send a highscore to the remote server to be added to the remote DB."""
-    logger.info("Posting highscore to remote")
-    requests.post(_REMOTE_POST_URL, json=attr.asdict(highscore), timeout=5)
+class _RemoteUploader:
+    """
+    Posts highscores from the local DB's outbox to the remote server.
+
+    A single background thread sends pending highscores in batches over a
+    persistent HTTP session, backing off while the server is unreachable.
+    Highscores are only removed from the outbox once the server has processed
+    them, or rejected them as invalid. If the server doesn't support bulk
+    posts, or rejects a batch as a whole, they are posted individually.
+    """
+
+    BATCH_SIZE = 50
+    MIN_BACKOFF = 5
+    MAX_BACKOFF = 600
+
+    # Statuses for which a highscore is invalid, and is dropped since retrying
+    #  won't help. Any others, e.g. 408 or 429, are retried.
+    _REJECTED_STATUSES = {400, 422}
+    # Statuses for which a bulk post is retried as individual posts.
+    _FALLBACK_STATUSES = _REJECTED_STATUSES | {404, 405}
+
+    def __init__(self, db_path: pathlib.Path):
+        self._db_path = db_path
+        self._wakeup = threading.Event()
+        self._thread = threading.Thread(
+            target=self._run, name="highscores-uploader", daemon=True
+        )
+
+    def start(self) -> None:
+        self._thread.start()
+
+    def notify(self) -> None:
+        """Notify the uploader that there are new highscores in the outbox."""
+        self._wakeup.set()
+
+    def _run(self) -> None:
+        # SQLite connections can't be shared between threads.
+        import requests
+
+        db = LocalHighscoresDB(self._db_path)
+        session = requests.Session()
+        backoff = 0
+        while True:
+            try:
+                done = self.upload_batch(db, session)
+            except Exception as e:
+                backoff = min(max(2 * backoff, self.MIN_BACKOFF), self.MAX_BACKOFF)
+                logger.warning(
+                    "Failed to post highscores to remote, retrying in %ds: %s",
+                    backoff,
+                    e,
+                )
+                time.sleep(backoff)
+                continue
+            backoff = 0
+            if done:
+                self._wakeup.wait()
+                self._wakeup.clear()
+
+    def upload_batch(
+        self, db: LocalHighscoresDB, session: "requests.Session"
+    ) -> bool:
+        """
+        Post a batch of highscores from the outbox to the remote server.
+
+        :param db:
+            The local DB containing the outbox.
+        :param session:
+            The HTTP session to post with.
+        :return:
+            Whether the outbox has been emptied.
+        :raise requests.RequestException:
+            If posting failed and should be retried.
+        """
+        pending = db.get_outbox(self.BATCH_SIZE)
+        if not pending:
+            return True
+        logger.info("Posting %d highscores to remote", len(pending))
+        response = session.post(
+            _REMOTE_BULK_POST_URL,
+            json=[attr.asdict(h) for _, h in pending],
+            timeout=10,
+        )
+        if response.status_code in self._FALLBACK_STATUSES:
+            # Either the bulk endpoint isn't supported, or some of the batch
+            #  was rejected by an older server that rejects the whole batch.
+            logger.warning(
+                "Remote failed bulk post with status %d, posting individually",
+                response.status_code,
+            )
+            return self._upload_individually(db, session, pending)
+        if response.status_code == 200:
+            processed = len(pending)
+            self._log_rejected(response, pending)
+        else:
+            # The server reports how many it got through before failing.
+            try:
+                processed = int(response.json()["processed"])
+            except Exception:
+                processed = 0
+        db.remove_from_outbox(i for i, _ in pending[:processed])
+        response.raise_for_status()
+        return len(pending) < self.BATCH_SIZE
+
+    @staticmethod
+    def _log_rejected(
+        response: "requests.Response", pending: List[Tuple[int, HighscoreStruct]]
+    ) -> None:
+        """Log any highscores in a batch that the server skipped as invalid."""
+        try:
+            rejected = response.json().get("rejected", [])
+        except Exception:
+            return
+        for idx in rejected:
+            logger.error("Remote rejected highscore, dropping: %s", pending[idx][1])
+
+    def _upload_individually(
+        self,
+        db: LocalHighscoresDB,
+        session: "requests.Session",
+        pending: List[Tuple[int, HighscoreStruct]],
+    ) -> bool:
+        """
+        Post highscores one at a time, removing each from the outbox once it
+        has been processed or rejected as invalid.
+
+        :raise requests.RequestException:
+            If posting failed and should be retried.
+        """
+        for i, h in pending:
+            response = session.post(_REMOTE_POST_URL, json=attr.asdict(h), timeout=10)
+            if response.status_code in self._REJECTED_STATUSES:
+                logger.error(
+                    "Remote rejected highscore with status %d, dropping: %s",
+                    response.status_code,
+                    h,
+                )
+            else:
+                response.raise_for_status()
+            db.remove_from_outbox([i])
+        return len(pending) < self.BATCH_SIZE
+
+
+_uploader: Optional[_RemoteUploader] = None
+_uploader_lock = threading.Lock()
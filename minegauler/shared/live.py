@@ -0,0 +1,246 @@
+# October 2020, Lewis Gaul
+
+"""
+Compact streaming of a game being played, for live spectating.
+
+A live stream is sent as a sequence of batches, each holding the cell updates
+made during one frame. A batch consists of replay log records (see the replay
+module), so encoding is shared with replay logs:
+ - Keyframe batches start with a replay log header giving the board size,
+   followed by a metadata record with the state of the game (if known), and a
+   keyframe record with the contents of every cell. These are sent at the
+   start of each game and periodically after that, so that spectators can
+   join at any point.
+ - Any further records are event records, or metadata records for changes to
+   the state of the game.
+
+The concatenation of a keyframe batch and the batches that follow it is a
+valid replay log.
+
+Exports
+-------
+.. class:: LiveEncoder
+    Encode the cell updates of a game into batches.
+
+.. class:: LiveDecoder
+    Decode batches to follow a game being played.
+
+.. function:: is_keyframe
+    Check whether a batch is a keyframe batch.
+
+"""
+
+__all__ = ("LiveDecoder", "LiveEncoder", "is_keyframe")
+
+import array
+import logging
+from typing import Any, Dict, List, Mapping, Optional
+
+from . import replay
+from .types import CellContents, Coord_T
+
+
+logger = logging.getLogger(__name__)
+
+_UNCLICKED_CODE = replay._UNCLICKED_CODE
+
+
+def is_keyframe(batch: bytes) -> bool:
+    """Check whether a batch is a keyframe batch, starting a replay log."""
+    return batch[: len(replay.MAGIC)] == replay.MAGIC
+
+
+class LiveEncoder:
+    """
+    Encode the cell updates of a game being played into batches.
+
+    Updates are buffered until the next call to flush(), which is expected to
+    be made once per frame, so that the cost of sending a batch is shared by
+    all the updates made in that frame.
+    """
+
+    def __init__(self, x_size: int, y_size: int, *, keyframe_interval: int = 64):
+        """
+        :param x_size:
+            The number of columns in the board.
+        :param y_size:
+            The number of rows in the board.
+        :param keyframe_interval:
+            The number of batches between keyframes.
+        """
+        self._keyframe_interval = keyframe_interval
+        self.metadata: Dict[str, Any] = dict()
+        self.new_game(x_size, y_size)
+
+    def new_game(self, x_size: int, y_size: int) -> None:
+        """
+        Start a new game, discarding any buffered updates.
+
+        :param x_size:
+            The number of columns in the board.
+        :param y_size:
+            The number of rows in the board.
+        """
+        self.x_size: int = x_size
+        self.y_size: int = y_size
+        self._board = array.array("l", [_UNCLICKED_CODE]) * (x_size * y_size)
+        self._last_ms = 0
+        self._pending = bytearray()
+        self._batches_since_keyframe = 0
+        self._keyframe_due = True
+
+    def request_keyframe(self) -> None:
+        """Make the next batch a keyframe, e.g. if a batch failed to send."""
+        self._keyframe_due = True
+        self._pending = bytearray()
+
+    def add_event(
+        self, elapsed: float, updates: Mapping[Coord_T, CellContents]
+    ) -> None:
+        """
+        Add the cells updated by an event to the next batch.
+
+        :param elapsed:
+            The elapsed game time of the event, in seconds.
+        :param updates:
+            The cells updated by the event.
+        """
+        ms = max(self._last_ms, int(round(elapsed * 1000)))
+        cells = replay._updates_to_cells(updates, self.x_size)
+        if not self._keyframe_due:
+            # Otherwise the change is sent as part of the keyframe.
+            replay._write_event(self._pending, ms - self._last_ms, cells)
+        for idx, code in cells:
+            self._board[idx] = code
+        self._last_ms = ms
+
+    def add_metadata(self, metadata: Dict[str, Any]) -> None:
+        """
+        Add changes to the game state to the next batch, which are also
+        included in all keyframes.
+
+        :param metadata:
+            The changed fields, which must be JSON-serialisable.
+        """
+        self.metadata.update(metadata)
+        if not self._keyframe_due:
+            self._pending += replay._encode_metadata(metadata)
+
+    def flush(self) -> Optional[bytes]:
+        """
+        Get a batch of everything added since the last flush.
+
+        :return:
+            The batch, or None if there is nothing to send.
+        """
+        if not self._pending and not self._keyframe_due:
+            return None
+        if self._batches_since_keyframe + 1 >= self._keyframe_interval:
+            self._keyframe_due = True
+        if self._keyframe_due:
+            buf = bytearray(
+                replay._HEADER.pack(
+                    replay.MAGIC, replay.VERSION, self.x_size, self.y_size
+                )
+            )
+            if self.metadata:
+                buf += replay._encode_metadata(self.metadata)
+            replay._write_keyframe(buf, self._last_ms, self._board)
+            self._batches_since_keyframe = 0
+            self._keyframe_due = False
+        else:
+            buf = self._pending
+            self._batches_since_keyframe += 1
+        self._pending = bytearray()
+        return bytes(buf)
+
+
+class LiveDecoder:
+    """
+    Decode batches to follow a game being played.
+
+    Batches are ignored until the first keyframe.
+    """
+
+    def __init__(self):
+        self.x_size: Optional[int] = None
+        self.y_size: Optional[int] = None
+        self.metadata: Dict[str, Any] = dict()
+        self._board = array.array("l")
+        self._ms = 0
+
+    @property
+    def started(self) -> bool:
+        """Whether a keyframe has been received."""
+        return self.x_size is not None
+
+    @property
+    def elapsed(self) -> float:
+        """The time of the last event, in seconds."""
+        return self._ms / 1000
+
+    def get_board(self) -> List[CellContents]:
+        """Get the contents of each cell."""
+        return [replay.decode_cell(c) for c in self._board]
+
+    def feed(self, batch: bytes) -> Dict[Coord_T, CellContents]:
+        """
+        Apply a batch.
+
+        :param batch:
+            The batch received.
+        :return:
+            The cells that were updated. After a keyframe batch this is all of
+            the cells.
+        :raise ValueError:
+            If the batch is invalid.
+        """
+        try:
+            changed = self._apply(batch)
+        except (IndexError, ValueError) as e:
+            if is_keyframe(batch):
+                # Wait for the next keyframe rather than show a corrupt board.
+                self.x_size = self.y_size = None
+            if isinstance(e, IndexError):
+                raise ValueError("Live batch is truncated") from None
+            raise
+        x_size = self.x_size
+        return {
+            (i % x_size, i // x_size): replay.decode_cell(c)
+            for i, c in changed.items()
+        }
+
+    def _apply(self, batch: bytes) -> Dict[int, int]:
+        offset = 0
+        if is_keyframe(batch):
+            if len(batch) < replay._HEADER.size:
+                raise IndexError
+            _, version, x_size, y_size = replay._HEADER.unpack_from(batch)
+            if version != replay.VERSION:
+                raise ValueError(f"Unsupported live stream version {version}")
+            self.x_size, self.y_size = x_size, y_size
+            self.metadata = dict()
+            self._board = array.array("l")
+            offset = replay._HEADER.size
+        elif not self.started:
+            logger.debug("Ignoring live batch before the first keyframe")
+            return dict()
+
+        nr_cells = self.x_size * self.y_size
+        changed = dict()
+        while offset < len(batch):
+            tag, value, offset = replay._read_record(batch, offset, nr_cells)
+            if tag == replay._EVENT_TAG:
+                delta, idxs, codes = value
+                self._ms += delta
+                for idx, code in zip(idxs, codes):
+                    self._board[idx] = code
+                    changed[idx] = code
+            elif tag == replay._KEYFRAME_TAG:
+                self._ms, self._board = value
+                changed = dict(enumerate(self._board))
+            else:
+                self.metadata.update(value)
+        if len(self._board) != nr_cells:
+            raise ValueError("Live keyframe batch has no keyframe")
+        return changed
@@ -0,0 +1,315 @@
+# October 2020, Lewis Gaul
+
+"""
+Low-overhead latency metrics for hot paths.
+
+Timings are recorded into histograms with logarithmically spaced buckets, from
+which percentiles can be estimated without storing every sample. Each metric
+has a name and an optional group, e.g. the highscore settings a query was for.
+
+Recording is disabled by default, in which case the hooks only check a global
+flag. It can be enabled with enable(), or by setting the MINEGAULER_METRICS
+environment variable.
+
+Exports
+-------
+.. class:: Histogram
+    A histogram of latencies.
+
+.. class:: timer
+    Context manager to time a block of code.
+
+.. function:: enable
+    Enable recording of metrics.
+
+.. function:: disable
+    Disable recording of metrics.
+
+.. function:: is_enabled
+    Check whether metrics are being recorded.
+
+.. function:: record
+    Record a latency.
+
+.. function:: timed
+    Decorator to time calls to a function.
+
+.. function:: get_histograms
+    Get a copy of the recorded histograms.
+
+.. function:: reset
+    Clear all recorded metrics.
+
+.. function:: format_report
+    Get a human-readable report of the recorded metrics.
+
+.. function:: format_prometheus
+    Get the recorded metrics in the Prometheus text format.
+
+"""
+
+__all__ = (
+    "Histogram",
+    "disable",
+    "enable",
+    "format_prometheus",
+    "format_report",
+    "get_histograms",
+    "is_enabled",
+    "record",
+    "reset",
+    "timed",
+    "timer",
+)
+
+import functools
+import logging
+import math
+import os
+import threading
+import time
+from typing import Callable, Dict, Iterable, List, Optional, Tuple
+
+
+logger = logging.getLogger(__name__)
+
+# Buckets grow by a factor of 2^(1/4), giving percentiles to within ~10%, and
+#  cover from 1 microsecond to over an hour.
+_BUCKET_BASE = 2 ** 0.25
+_MIN_LATENCY = 1e-6
+_NR_BUCKETS = 128
+
+_Key_T = Tuple[str, Optional[str]]
+
+_enabled: bool = bool(os.environ.get("MINEGAULER_METRICS"))
+_lock = threading.Lock()
+_histograms: Dict[_Key_T, "Histogram"] = dict()
+
+
+class Histogram:
+    """A histogram of latencies, in seconds."""
+
+    def __init__(self):
+        self.count: int = 0
+        self.total: float = 0
+        self.min: float = math.inf
+        self.max: float = 0
+        self.buckets: List[int] = [0] * _NR_BUCKETS
+
+    def __repr__(self):
+        return f"<Histogram count={self.count}>"
+
+    @staticmethod
+    def _bucket_idx(value: float) -> int:
+        if value <= _MIN_LATENCY:
+            return 0
+        idx = int(math.log(value / _MIN_LATENCY, _BUCKET_BASE)) + 1
+        return min(idx, _NR_BUCKETS - 1)
+
+    @staticmethod
+    def _bucket_upper_bound(idx: int) -> float:
+        return _MIN_LATENCY * _BUCKET_BASE ** idx
+
+    @property
+    def mean(self) -> float:
+        return self.total / self.count if self.count else math.nan
+
+    def add(self, value: float) -> None:
+        """Add a sample to the histogram."""
+        self.count += 1
+        self.total += value
+        self.min = min(self.min, value)
+        self.max = max(self.max, value)
+        self.buckets[self._bucket_idx(value)] += 1
+
+    def percentile(self, pct: float) -> float:
+        """
+        Estimate a percentile of the samples.
+
+        :param pct:
+            The percentile to get, between 0 and 100.
+        :return:
+            The estimated value, limited to the range of the samples, or NaN if
+            there are no samples.
+        """
+        if not self.count:
+            return math.nan
+        if pct <= 0:
+            return self.min
+        if pct >= 100:
+            return self.max
+        target = pct / 100 * self.count
+        cumulative = 0
+        for idx, n in enumerate(self.buckets):
+            cumulative += n
+            if n and cumulative >= target:
+                # Use the geometric midpoint of the bucket.
+                value = self._bucket_upper_bound(idx) / _BUCKET_BASE ** 0.5
+                return min(max(value, self.min), self.max)
+        return self.max
+
+    def copy(self) -> "Histogram":
+        new = Histogram()
+        new.count, new.total = self.count, self.total
+        new.min, new.max = self.min, self.max
+        new.buckets = list(self.buckets)
+        return new
+
+
+def enable() -> None:
+    """Enable recording of metrics."""
+    global _enabled
+    logger.info("Enabling latency metrics")
+    _enabled = True
+
+
+def disable() -> None:
+    """Disable recording of metrics, keeping those already recorded."""
+    global _enabled
+    logger.info("Disabling latency metrics")
+    _enabled = False
+
+
+def is_enabled() -> bool:
+    """Check whether metrics are being recorded."""
+    return _enabled
+
+
+def record(name: str, seconds: float, *, group: Optional[str] = None) -> None:
+    """
+    Record a latency, if metrics are enabled.
+
+    :param name:
+        The name of the metric, e.g. the function being timed.
+    :param seconds:
+        The latency to record.
+    :param group:
+        Optionally specify a group within the metric.
+    """
+    if not _enabled:
+        return
+    key = (name, group)
+    with _lock:
+        hist = _histograms.get(key)
+        if hist is None:
+            hist = _histograms[key] = Histogram()
+        hist.add(seconds)
+
+
+class timer:
+    """
+    Context manager to time a block of code, if metrics are enabled.
+
+    Example:
+    >>> with timer("highscores.get_highscores", group="B"):
+    ...     pass
+    """
+
+    __slots__ = ("name", "group", "_start")
+
+    def __init__(self, name: str, *, group: Optional[str] = None):
+        self.name = name
+        self.group = group
+        self._start: Optional[float] = None
+
+    def __enter__(self) -> "timer":
+        if _enabled:
+            self._start = time.perf_counter()
+        return self
+
+    def __exit__(self, *exc_info) -> None:
+        if self._start is not None:
+            record(self.name, time.perf_counter() - self._start, group=self.group)
+
+
+def timed(name: str) -> Callable[[Callable], Callable]:
+    """
+    Decorator to time calls to a function, if metrics are enabled.
+
+    :param name:
+        The name of the metric.
+    """
+
+    def decorator(func: Callable) -> Callable:
+        @functools.wraps(func)
+        def wrapper(*args, **kwargs):
+            if not _enabled:
+                return func(*args, **kwargs)
+            start = time.perf_counter()
+            try:
+                return func(*args, **kwargs)
+            finally:
+                record(name, time.perf_counter() - start)
+
+        return wrapper
+
+    return decorator
+
+
+def get_histograms() -> Dict[_Key_T, Histogram]:
+    """
+    Get a copy of the recorded histograms.
+
+    :return:
+        The histograms, keyed by (name, group).
+    """
+    with _lock:
+        return {k: h.copy() for k, h in _histograms.items()}
+
+
+def reset() -> None:
+    """Clear all recorded metrics."""
+    with _lock:
+        _histograms.clear()
+
+
+def _sorted_items(
+    histograms: Dict[_Key_T, Histogram]
+) -> Iterable[Tuple[_Key_T, Histogram]]:
+    return sorted(histograms.items(), key=lambda kv: (kv[0][0], kv[0][1] or ""))
+
+
+def format_report() -> str:
+    """Get a human-readable report of the recorded metrics, in milliseconds."""
+    histograms = get_histograms()
+    if not histograms:
+        return "No latency metrics recorded"
+    lines = [
+        f"{'Metric':<48} {'Count':>7} {'Mean':>9} {'p50':>9} {'p99':>9} {'Max':>9}"
+    ]
+    for (name, group), hist in _sorted_items(histograms):
+        label = f"{name} [{group}]" if group else name
+        lines.append(
+            f"{label:<48} {hist.count:>7} {hist.mean * 1000:>9.3f} "
+            f"{hist.percentile(50) * 1000:>9.3f} {hist.percentile(99) * 1000:>9.3f} "
+            f"{hist.max * 1000:>9.3f}"
+        )
+    return "\n".join(lines)
+
+
+def _escape_label(value: str) -> str:
+    """Escape a Prometheus label value."""
+    return value.replace("\\", "\\\\").replace('"', '\\"').replace("\n", "\\n")
+
+
+def format_prometheus() -> str:
+    """
+    Get the recorded metrics in the Prometheus text format, as summaries in
+    seconds with the name and group as labels.
+    """
+    metric = "minegauler_latency_seconds"
+    lines = [
+        f"# HELP {metric} Latency of instrumented operations.",
+        f"# TYPE {metric} summary",
+    ]
+    for (name, group), hist in _sorted_items(get_histograms()):
+        labels = f'name="{_escape_label(name)}"'
+        if group:
+            labels += f',group="{_escape_label(group)}"'
+        for q in [0.5, 0.9, 0.99]:
+            lines.append(
+                f'{metric}{{{labels},quantile="{q}"}} {hist.percentile(q * 100):.6g}'
+            )
+        lines.append(f"{metric}_sum{{{labels}}} {hist.total:.6g}")
+        lines.append(f"{metric}_count{{{labels}}} {hist.count}")
+    return "\n".join(lines) + "\n"
@@ -0,0 +1,497 @@
+# October 2020, Lewis Gaul
+
+"""
+Compact replay logs of the cell updates made during a game.
+
+A replay log is a binary file that is written as the game is played. All
+integers are little-endian, with variable-length integers (varints) using 7
+bits per byte, least significant group first. The file starts with a header:
+ - The 4-byte magic string b"\\x89MGR".
+ - The format version (u8), followed by 3 padding bytes.
+ - The x_size and y_size of the board (u32 each).
+
+This is followed by a sequence of records, each starting with a tag byte:
+ - Event: the time since the previous event in milliseconds (varint), the
+   number of cells updated (varint), then for each cell in increasing order
+   the difference from the previous cell's flat index (varint) and the code
+   for its new contents (varint).
+ - Keyframe: the time of the preceding event in milliseconds (varint), then
+   the contents of every cell as runs of (run length, code) varint pairs.
+   Keyframes are written periodically, giving the board state after the
+   preceding event.
+ - Metadata: the length (varint) of a UTF-8 JSON object that follows.
+
+Cell contents are encoded using their CellCode, i.e. the number shifted left
+by 3 bits, combined with the index of the cell contents type in
+CellContents.items.
+
+A truncated final record is ignored when reading, so the log of a game that
+was interrupted can still be replayed.
+
+Exports
+-------
+.. class:: ReplayWriter
+    Write a replay log as a game is played.
+
+.. class:: Replay
+    A replay log that has been read, supporting seeking.
+
+.. function:: append_metadata
+    Append metadata to a replay log file.
+
+.. function:: encode_cell
+    Get the integer code for some cell contents.
+
+.. function:: decode_cell
+    Get the cell contents for an integer code.
+
+"""
+
+__all__ = ("Replay", "ReplayWriter", "append_metadata", "decode_cell", "encode_cell")
+
+import array
+import bisect
+import io
+import json
+import logging
+import struct
+from typing import (
+    Any,
+    BinaryIO,
+    Dict,
+    List,
+    Mapping,
+    Optional,
+    Sequence,
+    Tuple,
+    Union,
+)
+
+from .types import CellCode, CellContents, Coord_T, PathLike
+
+
+logger = logging.getLogger(__name__)
+
+MAGIC = b"\x89MGR"
+VERSION = 1
+
+_HEADER = struct.Struct("<4sBxxxII")
+
+_EVENT_TAG = 1
+_KEYFRAME_TAG = 2
+_METADATA_TAG = 3
+
+_UNCLICKED_CODE = CellCode.UNCLICKED
+
+
+def encode_cell(contents: CellContents) -> int:
+    """Get the integer code for some cell contents."""
+    return contents.code
+
+
+def decode_cell(code: int) -> CellContents:
+    """Get the cell contents for an integer code."""
+    return CellContents.from_code(code)
+
+
+def _write_varint(buf: bytearray, value: int) -> None:
+    while value >= 0x80:
+        buf.append(value & 0x7F | 0x80)
+        value >>= 7
+    buf.append(value)
+
+
+def _read_varint(data: bytes, offset: int) -> Tuple[int, int]:
+    """
+    Read a varint.
+
+    :return:
+        The value and the offset after it.
+    :raise IndexError:
+        If the data ends before the varint.
+    """
+    value = 0
+    shift = 0
+    while True:
+        byte = data[offset]
+        offset += 1
+        value |= (byte & 0x7F) << shift
+        if byte < 0x80:
+            return value, offset
+        shift += 7
+
+
+def _updates_to_cells(
+    updates: Mapping[Coord_T, CellContents], x_size: int
+) -> List[Tuple[int, int]]:
+    """Get cell updates as (flat index, code) pairs, in increasing index order."""
+    return sorted((y * x_size + x, encode_cell(c)) for (x, y), c in updates.items())
+
+
+def _write_event(buf: bytearray, delta_ms: int, cells: List[Tuple[int, int]]) -> None:
+    buf.append(_EVENT_TAG)
+    _write_varint(buf, delta_ms)
+    _write_varint(buf, len(cells))
+    prev_idx = 0
+    for idx, code in cells:
+        _write_varint(buf, idx - prev_idx)
+        _write_varint(buf, code)
+        prev_idx = idx
+
+
+def _write_keyframe(buf: bytearray, ms: int, board: Sequence[int]) -> None:
+    buf.append(_KEYFRAME_TAG)
+    _write_varint(buf, ms)
+    start = 0
+    for i in range(1, len(board) + 1):
+        if i == len(board) or board[i] != board[start]:
+            _write_varint(buf, i - start)
+            _write_varint(buf, board[start])
+            start = i
+
+
+def _read_record(data: bytes, offset: int, nr_cells: int) -> Tuple[int, Any, int]:
+    """
+    Read a record.
+
+    :param data:
+        The data to read from.
+    :param offset:
+        The offset of the record's tag byte.
+    :param nr_cells:
+        The number of cells in the board.
+    :return:
+        The record's tag, its value and the offset after it. The value is a
+        tuple of the time delta, cell indices and codes for an event, a tuple of
+        the time and the board for a keyframe, or the metadata dictionary.
+    :raise IndexError:
+        If the data ends before the record.
+    :raise ValueError:
+        If the record is invalid.
+    """
+    tag = data[offset]
+    offset += 1
+    if tag == _EVENT_TAG:
+        delta, offset = _read_varint(data, offset)
+        count, offset = _read_varint(data, offset)
+        idxs = []
+        codes = []
+        idx = 0
+        for _ in range(count):
+            idx_delta, offset = _read_varint(data, offset)
+            code, offset = _read_varint(data, offset)
+            idx += idx_delta
+            idxs.append(idx)
+            codes.append(code)
+        if idxs and idxs[-1] >= nr_cells:
+            raise ValueError("Cell index out of range in replay log")
+        return tag, (delta, tuple(idxs), tuple(codes)), offset
+    elif tag == _KEYFRAME_TAG:
+        ms, offset = _read_varint(data, offset)
+        board = array.array("l")
+        while len(board) < nr_cells:
+            run, offset = _read_varint(data, offset)
+            code, offset = _read_varint(data, offset)
+            board.extend([code] * run)
+        if len(board) != nr_cells:
+            raise ValueError("Invalid keyframe in replay log")
+        return tag, (ms, board), offset
+    elif tag == _METADATA_TAG:
+        length, offset = _read_varint(data, offset)
+        if offset + length > len(data):
+            raise IndexError
+        metadata = json.loads(data[offset : offset + length])
+        return tag, metadata, offset + length
+    else:
+        raise ValueError(f"Unknown record type {tag} in replay log")
+
+
+class ReplayWriter:
+    """
+    Write a replay log as a game is played, streaming it to a file.
+
+    The board state is also tracked, so that keyframes can be written.
+    """
+
+    def __init__(
+        self,
+        file: Union[PathLike, BinaryIO],
+        x_size: int,
+        y_size: int,
+        *,
+        keyframe_interval: int = 64,
+    ):
+        """
+        :param file:
+            The path of the file to write to, or a binary file object.
+        :param x_size:
+            The number of columns in the board.
+        :param y_size:
+            The number of rows in the board.
+        :param keyframe_interval:
+            The number of events between keyframes.
+        """
+        if isinstance(file, (str, bytes)) or hasattr(file, "__fspath__"):
+            self._file: BinaryIO = open(file, "wb")
+            self._owns_file = True
+        else:
+            self._file = file
+            self._owns_file = False
+        self.x_size: int = x_size
+        self.y_size: int = y_size
+        self._keyframe_interval = keyframe_interval
+        self._board = array.array("l", [_UNCLICKED_CODE]) * (x_size * y_size)
+        self._last_ms = 0
+        self._events_since_keyframe = 0
+        self._file.write(_HEADER.pack(MAGIC, VERSION, x_size, y_size))
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *args):
+        self.close()
+
+    def add_event(self, elapsed: float, updates: Mapping[Coord_T, CellContents]):
+        """
+        Add an event to the log.
+
+        :param elapsed:
+            The elapsed game time of the event, in seconds. Events should be
+            added in order, with any earlier time treated as the same as the
+            previous event.
+        :param updates:
+            The cells updated by the event.
+        """
+        ms = max(self._last_ms, int(round(elapsed * 1000)))
+        cells = _updates_to_cells(updates, self.x_size)
+        buf = bytearray()
+        _write_event(buf, ms - self._last_ms, cells)
+        for idx, code in cells:
+            self._board[idx] = code
+        self._file.write(buf)
+        self._last_ms = ms
+        self._events_since_keyframe += 1
+        if self._events_since_keyframe >= self._keyframe_interval:
+            self._write_keyframe()
+
+    def _write_keyframe(self) -> None:
+        """Write a keyframe of the current board, and flush to disk."""
+        buf = bytearray()
+        _write_keyframe(buf, self._last_ms, self._board)
+        self._file.write(buf)
+        self._file.flush()
+        self._events_since_keyframe = 0
+
+    def add_metadata(self, metadata: Dict[str, Any]) -> None:
+        """Add metadata to the log, which must be JSON-serialisable."""
+        self._file.write(_encode_metadata(metadata))
+
+    def close(self) -> None:
+        """Finish writing the log, closing the file if opened by this object."""
+        if self._owns_file:
+            self._file.close()
+        else:
+            self._file.flush()
+
+
+def _encode_metadata(metadata: Dict[str, Any]) -> bytes:
+    data = json.dumps(metadata).encode()
+    buf = bytearray([_METADATA_TAG])
+    _write_varint(buf, len(data))
+    return bytes(buf) + data
+
+
+def append_metadata(path: PathLike, metadata: Dict[str, Any]) -> None:
+    """
+    Append metadata to a replay log file that has been written.
+
+    :param path:
+        The path to the file.
+    :param metadata:
+        The metadata, which must be JSON-serialisable.
+    """
+    with open(path, "ab") as f:
+        f.write(_encode_metadata(metadata))
+
+
+class Replay:
+    """
+    A replay log that has been read.
+
+    The current position in the replay is tracked, and can be moved to any
+    elapsed time with seek(). This starts from whichever is nearer out of the
+    current position and the closest preceding keyframe.
+    """
+
+    def __init__(self, data: bytes):
+        """
+        :param data:
+            The contents of the replay log.
+        :raise ValueError:
+            If the data is not a valid replay log.
+        """
+        if len(data) < _HEADER.size:
+            raise ValueError("Replay log is truncated")
+        magic, version, x_size, y_size = _HEADER.unpack_from(data)
+        if magic != MAGIC:
+            raise ValueError("Not a replay log")
+        if version != VERSION:
+            raise ValueError(f"Unsupported replay log version {version}")
+        self.x_size: int = x_size
+        self.y_size: int = y_size
+        self.metadata: Dict[str, Any] = dict()
+        # The time of each event, in milliseconds.
+        self._times = array.array("l")
+        # The cells updated by each event, as flat indices and codes.
+        self._events: List[Tuple[Tuple[int, ...], Tuple[int, ...]]] = []
+        # The number of events applied to give each keyframe's board.
+        self._keyframe_positions: List[int] = [0]
+        self._keyframe_boards: List[array.array] = [
+            array.array("l", [_UNCLICKED_CODE]) * (x_size * y_size)
+        ]
+        self._parse(data, _HEADER.size)
+
+        # The current position, as the number of events applied to the board.
+        self._position = 0
+        k = bisect.bisect_right(self._keyframe_positions, 0) - 1
+        self._board = array.array("l", self._keyframe_boards[k])
+
+    @classmethod
+    def load(cls, path: PathLike) -> "Replay":
+        """
+        Read a replay log from file.
+
+        :param path:
+            The path to the file.
+        :raise OSError:
+            If reading the file fails.
+        :raise ValueError:
+            If the file is not a valid replay log.
+        """
+        with open(path, "rb") as f:
+            return cls(f.read())
+
+    def _parse(self, data: bytes, offset: int) -> None:
+        nr_cells = self.x_size * self.y_size
+        ms = 0
+        while offset < len(data):
+            try:
+                tag, value, offset = _read_record(data, offset, nr_cells)
+            except IndexError:
+                logger.warning("Ignoring truncated record at end of replay log")
+                break
+            if tag == _EVENT_TAG:
+                delta, idxs, codes = value
+                ms += delta
+                self._times.append(ms)
+                self._events.append((idxs, codes))
+            elif tag == _KEYFRAME_TAG:
+                # A log may start from a keyframe, e.g. a live stream joined
+                #  part way through a game.
+                ms, board = value
+                self._keyframe_positions.append(len(self._events))
+                self._keyframe_boards.append(board)
+            else:
+                self.metadata.update(value)
+
+    @property
+    def nr_events(self) -> int:
+        return len(self._events)
+
+    @property
+    def duration(self) -> float:
+        """The time of the last event, in seconds."""
+        return self._times[-1] / 1000 if self._times else 0
+
+    @property
+    def position(self) -> int:
+        """The number of events that have been applied."""
+        return self._position
+
+    @property
+    def elapsed(self) -> float:
+        """The time of the last event applied, in seconds."""
+        return self._times[self._position - 1] / 1000 if self._position else 0
+
+    def get_board(self) -> List[CellContents]:
+        """Get the contents of each cell at the current position."""
+        return [decode_cell(c) for c in self._board]
+
+    def seek(self, elapsed: float) -> Dict[Coord_T, CellContents]:
+        """
+        Move to the given time, applying all events up to and including it.
+
+        :param elapsed:
+            The elapsed game time to move to, in seconds.
+        :return:
+            The cells whose contents differ from the previous position.
+        """
+        target = bisect.bisect_right(self._times, int(round(elapsed * 1000)))
+        return self.seek_event(target)
+
+    def seek_event(self, position: int) -> Dict[Coord_T, CellContents]:
+        """
+        Move to just after the given number of events have been applied.
+
+        :param position:
+            The number of events to have applied, between 0 and nr_events.
+        :return:
+            The cells that need updating from the previous position, which may
+            include cells that were changed and then changed back.
+        """
+        position = max(0, min(position, len(self._events)))
+        k = bisect.bisect_right(self._keyframe_positions, position) - 1
+        keyframe_pos = self._keyframe_positions[k]
+        changed = dict()
+        if self._position <= position and keyframe_pos <= self._position:
+            # Playing forward from the current position is no further than
+            #  from the nearest keyframe.
+            for idxs, codes in self._events[self._position : position]:
+                for idx, code in zip(idxs, codes):
+                    if self._board[idx] != code:
+                        self._board[idx] = code
+                        changed[idx] = code
+        else:
+            old_board = self._board
+            board = array.array("l", self._keyframe_boards[k])
+            for idxs, codes in self._events[keyframe_pos:position]:
+                for idx, code in zip(idxs, codes):
+                    board[idx] = code
+            changed = {
+                i: code
+                for i, (code, old) in enumerate(zip(board, old_board))
+                if code != old
+            }
+            self._board = board
+        self._position = position
+        x_size = self.x_size
+        return {(i % x_size, i // x_size): decode_cell(c) for i, c in changed.items()}
+
+    @classmethod
+    def from_cell_updates(
+        cls,
+        x_size: int,
+        y_size: int,
+        cell_updates: List[Tuple[float, Mapping[Coord_T, CellContents]]],
+        *,
+        metadata: Optional[Dict[str, Any]] = None,
+    ) -> "Replay":
+        """
+        Create a replay from a list of (elapsed, updates) events.
+
+        :param x_size:
+            The number of columns in the board.
+        :param y_size:
+            The number of rows in the board.
+        :param cell_updates:
+            The events, as the elapsed time in seconds with the cells updated.
+        :param metadata:
+            Optional metadata to include.
+        """
+        buf = io.BytesIO()
+        with ReplayWriter(buf, x_size, y_size) as writer:
+            for elapsed, updates in cell_updates:
+                writer.add_event(elapsed, updates)
+            if metadata:
+                writer.add_metadata(metadata)
+        return cls(buf.getvalue())
@@ -5,6 +5,9 @@ Types used throughout the project.
 
 Exports
 -------
+.. class:: CellCode
+    Integer codes for cell contents.
+
 .. class:: CellContents
     An ADT-like class providing cell contents types.
 
@@ -35,6 +38,7 @@ Exports
 """
 
 __all__ = (
+    "CellCode",
     "CellContents",
     "CellContents_T",
     "CellImageType",
@@ -49,7 +53,7 @@ __all__ = (
 import enum
 import functools
 import os
-from typing import Tuple, Type, Union
+from typing import Dict, Tuple, Type, Union
 
 
 PathLike = Union[str, bytes, os.PathLike]
@@ -62,17 +66,60 @@ CellContents_T = Union[Type["CellContents"], "CellContents"]
 # ------------------------------------------------------------------------------
 
 
+class CellCode:
+    """
+    Integer codes for cell contents, used to store boards compactly and to
+    check cells cheaply on the hot path.
+
+    The kind of contents is held in the low KIND_BITS bits of a code, with the
+    number (of mines, flags etc.) above them, so the unclicked code is zero.
+    The mine-type kinds come last, so a code is for a mine type if its kind is
+    at least MINE.
+    """
+
+    KIND_BITS = 3
+    KIND_MASK = (1 << KIND_BITS) - 1
+
+    # Kinds of cell contents, matching the order of 'CellContents.items'.
+    UNCLICKED = 0
+    NUM = 1
+    MINE = 2
+    HIT_MINE = 3
+    FLAG = 4
+    WRONG_FLAG = 5
+
+    # The code of a revealed cell with no neighbouring mines.
+    BLANK = NUM
+
+    @staticmethod
+    def make(kind: int, num: int = 0) -> int:
+        """Get the code for a kind of cell contents with a number."""
+        return num << CellCode.KIND_BITS | kind
+
+    @staticmethod
+    def kind(code: int) -> int:
+        """Get the kind of cell contents a code is for."""
+        return code & CellCode.KIND_MASK
+
+    @staticmethod
+    def num(code: int) -> int:
+        """Get the number in a code, which is zero for unclicked cells."""
+        return code >> CellCode.KIND_BITS
+
+
 class _NumericCellContentsMixin:
     """
     A mixin for numeric cell contents types, allowing adding and subtracting integers.
     """
 
     char: str
+    kind: int
 
     def __init__(self, num):
         if not isinstance(num, int):
             raise TypeError("Number should be an integer")
         self.num = num
+        self.code = num << CellCode.KIND_BITS | self.kind
 
     def __repr__(self):
         return self.char + str(self.num)
@@ -94,6 +141,9 @@ class CellContents:
     """Abstract base class for contents of a minesweeper board cell."""
 
     char: str
+    # The kind of contents and integer code, see CellCode.
+    kind: int
+    code: int
 
     Unclicked = NotImplemented
     Num = NotImplemented
@@ -124,6 +174,10 @@ class CellContents:
     def from_str(string: str) -> "CellContents":
         return NotImplemented  # Implemented below, after subclasses
 
+    @staticmethod
+    def from_code(code: int) -> "CellContents":
+        return NotImplemented  # Implemented below, after subclasses
+
     def is_type(self, item: CellContents_T) -> bool:
         if item in [self.Unclicked]:
             return self is item
@@ -140,12 +194,15 @@ class _CellUnclicked(CellContents):
     """Unclicked cell on a minesweeper board."""
 
     char = "#"
+    kind = CellCode.UNCLICKED
+    code = CellCode.make(CellCode.UNCLICKED)
 
 
 class _CellNum(_NumericCellContentsMixin, CellContents):
     """Number shown in a cell on a minesweeper board."""
 
     char = ""
+    kind = CellCode.NUM
 
     def __init__(self, num):
         super().__init__(num)
@@ -177,24 +234,28 @@ class _CellMine(_CellMineType):
     """Number of mines in a cell shown on a minesweeper board."""
 
     char = "M"
+    kind = CellCode.MINE
 
 
 class _CellHitMine(_CellMineType):
     """Number of hit mines in a cell shown on a minesweeper board."""
 
     char = "!"
+    kind = CellCode.HIT_MINE
 
 
 class _CellFlag(_CellMineType):
     """Number of flags in a cell shown on a minesweeper board."""
 
     char = "F"
+    kind = CellCode.FLAG
 
 
 class _CellWrongFlag(_CellFlag):
     """Number of incorrect flags in a cell shown on a minesweeper board."""
 
     char = "X"
+    kind = CellCode.WRONG_FLAG
 
 
 # Make the base class act like an ADT, serving as the only external API.
@@ -242,8 +303,38 @@ def _from_str(string: str) -> CellContents:
         raise ValueError(f"Unknown cell contents representation {string!r}")
 
 
+# Cache of the cell contents for each code, filled on first use of a code.
+_contents_by_code: Dict[int, CellContents] = {
+    CellContents.Unclicked.code: CellContents.Unclicked
+}
+
+
+def _from_code(code: int) -> CellContents:
+    """
+    Get the cell contents for an integer code, see CellCode.
+
+    :param code:
+        The code to convert.
+    :return:
+        The cell contents.
+    :raise ValueError:
+        If the code is invalid.
+    """
+    try:
+        return _contents_by_code[code]
+    except KeyError:
+        pass
+    kind = code & CellCode.KIND_MASK
+    if code < 0 or kind == CellCode.UNCLICKED or kind >= len(CellContents.items):
+        raise ValueError(f"Invalid cell contents code {code}")
+    contents = CellContents.items[kind](code >> CellCode.KIND_BITS)
+    _contents_by_code[code] = contents
+    return contents
+
+
 CellContents.from_char = _from_char
 CellContents.from_str = _from_str
+CellContents.from_code = _from_code
 
 
 # ------------------------------------------------------------------------------
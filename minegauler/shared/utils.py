@@ -14,8 +14,11 @@ Exports
 .. class:: GameOptsStruct
     A structure class containing persisted game options.
 
+.. class:: NeighbourTable
+    Precomputed flat indices of the neighbours of each cell in a grid shape.
+
 .. class:: Grid
-    Representation of a 2D array.
+    Representation of a 2D array, stored in a flat buffer.
 
 .. class:: StructConstructorMixin
     A mixin for structure classes.
@@ -23,6 +26,9 @@ Exports
 .. function:: format_timestamp
     Format a timestamp.
 
+.. function:: get_nbr_table
+    Get the shared neighbour table for a grid shape.
+
 .. function:: is_flagging_threshold
     Check whether flagging threshold is met.
 
@@ -32,24 +38,42 @@ Exports
 .. function:: write_settings_to_file
     Persist settings to file.
 
+.. data:: FLAGGING_THRESHOLD
+    The proportion of mines flagged above which a game counts as 'flagging'.
+
 """
 
 __all__ = (
+    "FLAGGING_THRESHOLD",
     "AllOptsStruct",
     "GUIOptsStruct",
     "GameOptsStruct",
     "Grid",
+    "NeighbourTable",
     "StructConstructorMixin",
     "format_timestamp",
+    "get_nbr_table",
     "is_flagging_threshold",
     "read_settings_from_file",
     "write_settings_to_file",
 )
 
+import array
+import functools
 import json
 import logging
 import time
-from typing import Any, Dict, Iterable, List
+from typing import (
+    Any,
+    Dict,
+    Iterable,
+    Iterator,
+    List,
+    MutableSequence,
+    Optional,
+    Sequence,
+    Tuple,
+)
 
 import attr
 
@@ -59,19 +83,112 @@ from .types import CellImageType, Coord_T
 
 logger = logging.getLogger(__name__)
 
+FLAGGING_THRESHOLD = 0.1
+
 
-class Grid(list):
+class NeighbourTable:
     """
-    Grid representation using a list of lists (2D array).
+    Precomputed neighbours of every cell for a grid shape, as flat indices.
+
+    The table is stored in CSR (compressed sparse row) form: the neighbours of
+    the cell with index i are indices[offsets[i]:offsets[i+1]]. Each cell's
+    own index is stored first in its row, so that the neighbours including the
+    origin cell are available as the same slice.
+
+    Instances should be obtained with get_nbr_table(), which shares a single
+    table between all grids of the same shape.
 
     Attributes:
     x_size (int > 0)
         The number of columns.
     y_size (int > 0)
         The number of rows.
-    all_coords ([(int, int), ...])
-        List of all coordinates in the grid.
+    offsets (array.array)
+        The start offset of each cell's row in the indices array, with a final
+        entry marking the end of the last row.
+    indices (array.array)
+        The flat indices of the cells, grouped by row.
+    """
+
+    def __init__(self, x_size: int, y_size: int):
+        self.x_size: int = x_size
+        self.y_size: int = y_size
+        offsets = array.array("l", [0])
+        indices = array.array("l")
+        for y in range(y_size):
+            rows = range(max(0, y - 1), min(y_size, y + 2))
+            for x in range(x_size):
+                cols = range(max(0, x - 1), min(x_size, x + 2))
+                origin = y * x_size + x
+                indices.append(origin)
+                indices.extend(
+                    j * x_size + i for j in rows for i in cols if i != x or j != y
+                )
+                offsets.append(len(indices))
+        self.offsets: array.array = offsets
+        self.indices: array.array = indices
+        self._view = memoryview(indices)
+
+    def __repr__(self):
+        return f"<{self.x_size}x{self.y_size} neighbour table>"
+
+    def nbrs(self, idx: int) -> Sequence[int]:
+        """Get a view of the neighbours of a cell, excluding the cell itself."""
+        return self._view[self.offsets[idx] + 1 : self.offsets[idx + 1]]
+
+    def nbrs_incl_origin(self, idx: int) -> Sequence[int]:
+        """Get a view of the neighbours of a cell, including the cell itself."""
+        return self._view[self.offsets[idx] : self.offsets[idx + 1]]
+
+
+@functools.lru_cache(maxsize=8)
+def get_nbr_table(x_size: int, y_size: int) -> NeighbourTable:
     """
+    Get the neighbour table for a grid shape.
+
+    Tables are built on first use and then shared process-wide, so repeated
+    games on a board of the same size do not rebuild them.
+
+    :param x_size:
+        The number of columns.
+    :param y_size:
+        The number of rows.
+    :return:
+        The shared neighbour table.
+    """
+    return NeighbourTable(x_size, y_size)
+
+
+@functools.lru_cache(maxsize=16)
+def _get_all_coords(x_size: int, y_size: int) -> Tuple[Coord_T, ...]:
+    """Get all coordinates of a grid shape, shared between grids of that shape."""
+    return tuple((x, y) for x in range(x_size) for y in range(y_size))
+
+
+class Grid:
+    """
+    Grid representation using a single flat buffer (2D array).
+
+    Cells are stored in row-major order, such that the cell at coordinate
+    (x, y) has the flat index (or cell ID) y * x_size + x. The buffer is a list
+    by default, allowing any objects to be stored, but subclasses may set
+    _TYPECODE to use a compact 'array.array' instead.
+
+    Attributes:
+    x_size (int > 0)
+        The number of columns.
+    y_size (int > 0)
+        The number of rows.
+    cells (list | array.array)
+        The flat buffer of cell values, indexed by cell ID.
+    all_coords ((int, int), ...)
+        All coordinates in the grid, shared between grids of the same shape.
+    nbr_table (NeighbourTable)
+        The neighbour table for the grid shape, see get_nbr_table().
+    """
+
+    # Typecode for an 'array.array' buffer, or None to use a list.
+    _TYPECODE: Optional[str] = None
 
     def __init__(self, x_size: int, y_size: int, *, fill: Any = 0):
         """
@@ -83,15 +200,9 @@ class Grid(list):
         fill=0 (object)
             What to fill the grid with.
         """
-        super().__init__()
-        for j in range(y_size):
-            row = x_size * [fill]
-            self.append(row)
         self.x_size: int = x_size
         self.y_size: int = y_size
-        self.all_coords: List[Coord_T] = [
-            (x, y) for x in range(x_size) for y in range(y_size)
-        ]
+        self.cells: MutableSequence = self._make_buffer(fill)
 
     def __repr__(self):
         return f"<{self.x_size}x{self.y_size} grid>"
@@ -115,7 +226,7 @@ class Grid(list):
 
         # Use max length of object representation if no cell size given.
         if cell_size is None:
-            cell_size = max([len(repr(obj)) for row in self for obj in row])
+            cell_size = max([len(repr(obj)) for obj in self.cells])
 
         cell = "{:>%d}" % cell_size
         ret = ""
@@ -134,20 +245,48 @@ class Grid(list):
 
         return ret
 
+    def __iter__(self) -> Iterator[List[Any]]:
+        """Iterate over the rows of the grid."""
+        x_size = self.x_size
+        for j in range(self.y_size):
+            yield list(self.cells[j * x_size : (j + 1) * x_size])
+
+    def __eq__(self, other):
+        if not isinstance(other, Grid):
+            return NotImplemented
+        return (
+            self.x_size == other.x_size
+            and self.y_size == other.y_size
+            and list(self.cells) == list(other.cells)
+        )
+
     def __getitem__(self, key):
         if type(key) is tuple and len(key) == 2:
             x, y = key
-            return super().__getitem__(y)[x]
+            if 0 <= x < self.x_size and 0 <= y < self.y_size:
+                return self.cells[y * self.x_size + x]
+            raise IndexError(f"Coordinate {key} is outside of the grid")
         else:
             raise TypeError("Grid keys should be tuple coordinates of the form (0, 1)")
 
     def __setitem__(self, key, value):
         if type(key) is tuple and len(key) == 2:
             x, y = key
-            super().__getitem__(y)[x] = value
+            if 0 <= x < self.x_size and 0 <= y < self.y_size:
+                self.cells[y * self.x_size + x] = value
+            else:
+                raise IndexError(f"Coordinate {key} is outside of the grid")
         else:
             raise TypeError("Grid keys should be tuple coordinates of the form (0, 1)")
 
+    @property
+    def all_coords(self) -> Sequence[Coord_T]:
+        return _get_all_coords(self.x_size, self.y_size)
+
+    @property
+    def nbr_table(self) -> NeighbourTable:
+        return get_nbr_table(self.x_size, self.y_size)
+
     @classmethod
     def from_2d_array(cls, array):
         """
@@ -163,11 +302,38 @@ class Grid(list):
         x_size = len(array[0])
         y_size = len(array)
         grid = cls(x_size, y_size)
-        for coord in grid.all_coords:
-            x, y = coord
-            grid[coord] = array[y][x]
+        grid.cells[:] = grid._make_buffer(items=[obj for row in array for obj in row])
         return grid
 
+    def _make_buffer(self, fill: Any = 0, *, items: Iterable = None) -> MutableSequence:
+        """
+        Create a flat buffer the size of the grid.
+
+        Arguments:
+        fill=0 (object)
+            What to fill the buffer with, if items are not given.
+        items=None (iterable | None)
+            Optionally give the items to fill the buffer with.
+        """
+        if self._TYPECODE is None:
+            if items is None:
+                return [fill] * (self.x_size * self.y_size)
+            return list(items)
+        else:
+            if items is None:
+                return array.array(self._TYPECODE, [fill]) * (self.x_size * self.y_size)
+            return array.array(self._TYPECODE, items)
+
+    def coord_to_idx(self, coord: Coord_T) -> int:
+        """Convert a coordinate to a flat cell index."""
+        x, y = coord
+        return y * self.x_size + x
+
+    def idx_to_coord(self, idx: int) -> Coord_T:
+        """Convert a flat cell index to a coordinate."""
+        y, x = divmod(idx, self.x_size)
+        return x, y
+
     def fill(self, item):
         """
         Fill the grid with a given object.
@@ -176,9 +342,7 @@ class Grid(list):
         item (object)
             The item to fill the grid with.
         """
-        for row in self:
-            for i in range(len(row)):
-                row[i] = item
+        self.cells[:] = self._make_buffer(item)
 
     def get_nbrs(self, coord: Coord_T, *, include_origin=False) -> Iterable[Coord_T]:
         """
@@ -193,19 +357,43 @@ class Grid(list):
         Return: [(int, int), ...]
             List of coordinates within the boundaries of the grid.
         """
-        x, y = coord
-        nbrs = []
-        for i in range(max(0, x - 1), min(self.x_size, x + 2)):
-            for j in range(max(0, y - 1), min(self.y_size, y + 2)):
-                nbrs.append((i, j))
-        if not include_origin:
-            nbrs.remove(coord)
-        return nbrs
+        x_size = self.x_size
+        return [
+            (i % x_size, i // x_size)
+            for i in self.get_nbr_idxs(
+                self.coord_to_idx(coord), include_origin=include_origin
+            )
+        ]
 
-    def copy(self):
-        ret = Grid(self.x_size, self.y_size)
-        for coord in self.all_coords:
-            ret[coord] = self[coord]
+    def get_nbr_idxs(self, idx: int, *, include_origin=False) -> Sequence[int]:
+        """
+        Get the flat indices of neighbouring cells.
+
+        Arguments:
+        idx (int, within grid boundaries)
+            The flat index of the cell to check.
+        include_origin=False (bool)
+            Whether to include the original cell index in the result.
+
+        Return: sequence of int
+            A view of the flat indices, from the shared neighbour table.
+        """
+        if include_origin:
+            return self.nbr_table.nbrs_incl_origin(idx)
+        else:
+            return self.nbr_table.nbrs(idx)
+
+    def copy(self) -> "Grid":
+        """
+        Create a copy of the grid contents.
+
+        The returned grid is a plain Grid instance, regardless of the type of
+        the grid being copied.
+        """
+        ret = Grid.__new__(Grid)
+        ret.x_size = self.x_size
+        ret.y_size = self.y_size
+        ret.cells = list(self.cells)
         return ret
 
     def is_coord_in_grid(self, coord: Coord_T) -> bool:
@@ -300,7 +488,7 @@ class AllOptsStruct(GameOptsStruct, GUIOptsStruct):
 
 def is_flagging_threshold(proportion: float) -> bool:
     """Does the given proportion correspond to a board solved with 'flagging'?"""
-    return proportion > 0.1
+    return proportion > FLAGGING_THRESHOLD
 
 
 def read_settings_from_file():
@@ -5,16 +5,31 @@ January 2020, Lewis Gaul
 """
 
 import argparse
+import hashlib
+import json
 import logging
 import os
 import sys
+import time
+from typing import Any, Dict, Iterable
 
 import attr
-from flask import Flask, abort, jsonify, redirect, request
+from flask import (
+    Flask,
+    Response,
+    abort,
+    g,
+    jsonify,
+    redirect,
+    request,
+    url_for,
+)
+from werkzeug.http import http_date, is_resource_modified, quote_etag
 
 from minegauler.shared import highscores as hs
+from minegauler.shared import metrics
 from minegauler.shared.types import Difficulty
-from server import bot
+from server import bot, live
 from server.utils import is_highscore_new_best
 
 from . import get_new_highscore_hooks
@@ -24,12 +39,74 @@ logger = logging.getLogger(__name__)
 
 app = Flask(__name__)
 
+_HIGHSCORES_PAGE_SIZE = 100
+_HIGHSCORES_MAX_PAGE_SIZE = 1000
+
+# When the remote highscores were last changed by this process, initially the
+#  time the server started.
+_highscores_last_modified = time.time()
+
+
+# ------------------------------------------------------------------------------
+# Metrics
+# ------------------------------------------------------------------------------
+
+
+@app.before_request
+def _start_request_timer():
+    if metrics.is_enabled():
+        g.request_start = time.perf_counter()
+
+
+@app.after_request
+def _record_request_time(response: Response) -> Response:
+    """Record the latency of each route, up to the response being returned."""
+    start = g.pop("request_start", None)
+    if start is not None:
+        rule = request.url_rule.rule if request.url_rule else "<unmatched>"
+        metrics.record(
+            "server.route",
+            time.perf_counter() - start,
+            group=f"{request.method} {rule}",
+        )
+    return response
+
+
+@app.route("/metrics", methods=["GET"])
+def get_metrics():
+    """Provide latency metrics in the Prometheus text format."""
+    return Response(metrics.format_prometheus(), mimetype="text/plain")
+
 
 # ------------------------------------------------------------------------------
 # REST API
 # ------------------------------------------------------------------------------
 
 
+def _process_highscore(highscore: hs.HighscoreStruct) -> None:
+    """
+    Handle a highscore that has been set, adding it to the remote DB if it's a
+    new record.
+
+    :raise DBConnectionError:
+        If accessing the remote DB fails.
+    """
+    new_best = is_highscore_new_best(highscore)
+    if new_best is None:
+        logger.debug("Not a new best, ignoring the highscore")
+        return
+
+    global _highscores_last_modified
+    hs.RemoteHighscoresDB().insert_highscore(highscore)
+    _highscores_last_modified = time.time()
+
+    for func in get_new_highscore_hooks():
+        try:
+            func(highscore)
+        except BaseException:
+            logger.exception(f"Error in 'new highscore' hook {func.__name__}()")
+
+
 @app.route("/api/v1/highscore", methods=["POST"])
 def api_v1_highscore():
     """
@@ -43,30 +120,75 @@ def api_v1_highscore():
     highscore = hs.HighscoreStruct.from_dict(data)
     logger.debug("POST highscore: %s", highscore)
 
-    new_best = is_highscore_new_best(highscore)
-    if new_best is None:
-        logger.debug("Not a new best, ignoring the highscore")
-        return "", 200
-
     try:
-        hs.RemoteHighscoresDB().insert_highscore(highscore)
+        _process_highscore(highscore)
     except hs.DBConnectionError as e:
         logger.exception("Failed to insert highscore into remote DB")
         # TODO: I want to know if this is hit!
         return str(e), 503
 
-    for func in get_new_highscore_hooks():
+    return "", 200
+
+
+@app.route("/api/v1/highscores/bulk", methods=["POST"])
+def api_v1_highscores_bulk():
+    """
+    Notification of a batch of highscores being set, as a list.
+
+    The highscores are handled in order, as for '/api/v1/highscore'. Invalid
+    highscores are skipped, with their indices returned as 'rejected', so that
+    they don't stop the rest of the batch from being stored. If the remote DB
+    can't be accessed, the number of highscores handled is returned so that
+    the client only retries the remainder.
+    """
+    data = request.get_json()
+    if not isinstance(data, list):
+        abort(400)
+    logger.debug("POST %d highscores", len(data))
+
+    rejected = []
+    for i, item in enumerate(data):
         try:
-            func(highscore)
-        except BaseException:
-            logger.exception(f"Error in 'new highscore' hook {func.__name__}()")
+            highscore = hs.HighscoreStruct.from_dict(item)
+        except Exception:
+            logger.exception("Skipping invalid highscore in bulk POST: %r", item)
+            rejected.append(i)
+            continue
+        try:
+            _process_highscore(highscore)
+        except hs.DBConnectionError as e:
+            logger.exception("Failed to insert highscore into remote DB")
+            return (
+                jsonify({"processed": i, "rejected": rejected, "error": str(e)}),
+                503,
+            )
 
-    return "", 200
+    return jsonify({"processed": len(data), "rejected": rejected}), 200
+
+
+def _stream_json_list(items: Iterable[Any]) -> Iterable[str]:
+    """Serialise a list to JSON one item at a time."""
+    yield "["
+    for i, item in enumerate(items):
+        yield ("," if i else "") + json.dumps(item)
+    yield "]"
 
 
 @app.route("/api/v1/highscores", methods=["GET"])
 def api_v1_highscores():
-    """Provide a REST API to get highscores from the DB."""
+    """
+    Provide a REST API to get highscores from the DB.
+
+    Highscores are returned a page at a time, ordered by time, with a 'Link'
+    header giving the URL of the next page if there may be more. The response
+    carries an ETag and Last-Modified time for conditional requests.
+
+    Query parameters:
+     - difficulty, per_cell, drag_select, name: Filters to apply
+     - fields: Comma-separated highscore fields to include, defaults to all
+     - limit: The page size, up to 1000 and defaulting to 100
+     - after: Where the page starts, as given in the 'Link' header
+    """
     logger.debug("GET highscores with args: %s", dict(request.args))
     difficulty = request.args.get("difficulty")
     if difficulty:
@@ -78,17 +200,72 @@ def api_v1_highscores():
     if drag_select:
         drag_select = bool(int(drag_select))
     name = request.args.get("name")
-    return jsonify(
-        [
-            attr.asdict(h)
-            for h in hs.get_highscores(
-                hs.HighscoresDatabases.REMOTE,
-                drag_select=drag_select,
-                per_cell=per_cell,
-                difficulty=difficulty,
-                name=name,
-            )
-        ]
+    all_fields = list(attr.fields_dict(hs.HighscoreStruct))
+    fields = request.args.get("fields")
+    if fields:
+        fields = fields.split(",")
+        if not set(fields) <= set(all_fields):
+            abort(400)
+    else:
+        fields = all_fields
+    try:
+        limit = int(request.args.get("limit", _HIGHSCORES_PAGE_SIZE))
+        if not 1 <= limit <= _HIGHSCORES_MAX_PAGE_SIZE:
+            raise ValueError(f"Invalid page size {limit}")
+        after = request.args.get("after")
+        if after:
+            after_elapsed, after_id = after.split(",")
+            after = (float(after_elapsed), int(after_id))
+    except ValueError:
+        abort(400)
+
+    db = hs.RemoteHighscoresDB()
+    try:
+        latest_id = db.get_latest_highscore_id()
+    except hs.DBConnectionError as e:
+        logger.exception("Failed to get highscores from remote DB")
+        return str(e), 503
+    # Highscores are only ever added, so the latest ID identifies the state of
+    #  the DB.
+    etag = "{}-{}".format(
+        latest_id, hashlib.sha1(request.query_string).hexdigest()[:16]
+    )
+    last_modified = http_date(_highscores_last_modified)
+    headers: Dict[str, str] = {
+        "ETag": quote_etag(etag),
+        "Last-Modified": last_modified,
+        "Cache-Control": "no-cache",
+    }
+    if not is_resource_modified(
+        request.environ, etag=etag, last_modified=last_modified
+    ):
+        return Response(status=304, headers=headers)
+
+    try:
+        page = db.get_highscores_page(
+            difficulty=difficulty,
+            per_cell=per_cell,
+            drag_select=drag_select,
+            name=name,
+            after=after,
+            limit=limit,
+        )
+    except hs.DBConnectionError as e:
+        logger.exception("Failed to get highscores from remote DB")
+        return str(e), 503
+    if len(page) == limit:
+        last_id, last_hs = page[-1]
+        next_url = url_for(
+            "api_v1_highscores",
+            **{**request.args.to_dict(), "after": f"{last_hs.elapsed!r},{last_id}"},
+        )
+        headers["Link"] = f'<{next_url}>; rel="next"'
+
+    items = ({f: getattr(h, f) for f in fields} for _, h in page)
+    return Response(
+        _stream_json_list(items),
+        mimetype="application/json",
+        headers=headers,
     )
 
 
@@ -107,13 +284,11 @@ def api_v1_highscores_ranks():
     return jsonify(
         [
             attr.asdict(h)
-            for h in hs.filter_and_sort(
-                hs.get_highscores(
-                    hs.HighscoresDatabases.REMOTE,
-                    drag_select=drag_select,
-                    per_cell=per_cell,
-                    difficulty=difficulty,
-                )
+            for h in hs.get_leaderboard(
+                hs.HighscoresDatabases.REMOTE,
+                drag_select=drag_select,
+                per_cell=per_cell,
+                difficulty=difficulty,
             )
         ]
     )
@@ -144,6 +319,18 @@ def _parse_args(argv):
     parser.add_argument("--port", "-p", type=int, help="Override the default port")
     parser.add_argument("--bot", action="store_true", help="Handle bot messages")
     parser.add_argument("--dev", action="store_true", help="Run in development mode")
+    parser.add_argument(
+        "--db-pool-size", type=int, help="Maximum number of DB connections to open"
+    )
+    parser.add_argument(
+        "--no-metrics", action="store_true", help="Don't record latency metrics"
+    )
+    parser.add_argument(
+        "--threads",
+        type=int,
+        default=16,
+        help="Number of request threads, with spectators limited to half of them",
+    )
     return parser.parse_args(argv)
 
 
@@ -160,9 +347,22 @@ def main(argv):
         format="%(asctime)s %(name)-12s %(levelname)-8s %(message)s",
     )
 
+    if not args.no_metrics:
+        metrics.enable()
+
+    # Leave at least half the request threads for routes other than spectating.
+    live.activate_live_streaming(app, max_spectators=args.threads // 2)
+
     if args.bot:
         bot.init_route_handling(app)
 
+    if args.db_pool_size:
+        hs.RemoteHighscoresDB.configure_pool(max_size=args.db_pool_size)
+    try:
+        hs.RemoteHighscoresDB().migrate()
+    except hs.DBConnectionError:
+        logger.exception("Failed to migrate remote highscores DB")
+
     logger.info("Starting up")
     if args.dev:
         os.environ["FLASK_ENV"] = "development"
@@ -170,7 +370,7 @@ def main(argv):
     else:
         from waitress import serve
 
-        serve(app, port=args.port if args.port else 80)
+        serve(app, port=args.port if args.port else 80, threads=args.threads)
 
 
 main(sys.argv[1:])
@@ -15,6 +15,7 @@ import flask
 
 from .. import add_new_highscore_hook
 from . import routes, utils
+from .leaderboard import snapshot
 
 
 logger = logging.getLogger(__name__)
@@ -39,4 +40,5 @@ def init_route_handling(app: flask.app.Flask):
 
     routes.activate_bot_msg_handling(app)
 
+    add_new_highscore_hook(snapshot.add_highscore)
     add_new_highscore_hook(routes.new_highscore_hook)
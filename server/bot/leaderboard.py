@@ -0,0 +1,128 @@
+"""
+leaderboard.py - In-memory snapshot of highscores for the bot
+
+October 2020, Lewis Gaul
+"""
+
+__all__ = ("HighscoresSnapshot", "snapshot")
+
+import collections
+import logging
+import threading
+from typing import Dict, Iterable, List, Optional
+
+from minegauler.shared import highscores as hs
+from minegauler.shared.types import Difficulty
+
+
+logger = logging.getLogger(__name__)
+
+
+class HighscoresSnapshot:
+    """
+    A snapshot of the remote highscores, held in memory.
+
+    The snapshot is loaded from the remote DB on first use and then kept up to
+    date by passing each highscore added to the DB to `add_highscore()`, which
+    is registered as a new highscore hook. This means bot commands can be
+    answered without querying the DB.
+    """
+
+    def __init__(self):
+        self._lock = threading.Lock()
+        # Each player's highscores, keyed by lower-case name and sorted by time.
+        self._by_name: Optional[Dict[str, List[hs.HighscoreStruct]]] = None
+
+    def _get_by_name(self) -> Dict[str, List[hs.HighscoreStruct]]:
+        """
+        Get the highscores by player, loading them from the DB if required.
+
+        Must be called with the lock held.
+
+        :raise DBConnectionError:
+            If loading from the DB fails.
+        """
+        if self._by_name is None:
+            logger.info("Loading highscores snapshot from remote DB")
+            by_name = collections.defaultdict(list)
+            # Ordered by time, which is preserved in each player's list.
+            for h in hs.get_highscores(hs.HighscoresDatabases.REMOTE):
+                by_name[h.name.lower()].append(h)
+            self._by_name = dict(by_name)
+        return self._by_name
+
+    def invalidate(self) -> None:
+        """Drop the snapshot, to be reloaded from the DB on next use."""
+        with self._lock:
+            self._by_name = None
+
+    def add_highscore(self, highscore: hs.HighscoreStruct) -> None:
+        """Add a highscore that has been inserted into the remote DB."""
+        with self._lock:
+            if self._by_name is None:
+                # Will be picked up when the snapshot is loaded.
+                return
+            player_highscores = self._by_name.setdefault(highscore.name.lower(), [])
+            player_highscores.append(highscore)
+            player_highscores.sort(key=lambda h: h.elapsed)
+
+    def get_highscores(
+        self,
+        name: str,
+        *,
+        difficulty: Optional[Difficulty] = None,
+        drag_select: Optional[bool] = None,
+        per_cell: Optional[int] = None,
+    ) -> List[hs.HighscoreStruct]:
+        """
+        Get a player's highscores, sorted by time.
+
+        :param name:
+            The name of the player (case insensitive).
+        :param difficulty:
+            Optionally specify difficulty to filter by.
+        :param drag_select:
+            Optionally specify drag_select to filter by.
+        :param per_cell:
+            Optionally specify per_cell to filter by.
+        :raise DBConnectionError:
+            If loading the snapshot from the DB fails.
+        """
+        with self._lock:
+            highscores = self._get_by_name().get(name.lower(), [])
+            return [
+                h
+                for h in highscores
+                if (difficulty is None or h.difficulty is difficulty)
+                and (drag_select is None or h.drag_select == drag_select)
+                and (per_cell is None or h.per_cell == per_cell)
+            ]
+
+    def get_best_times(
+        self,
+        names: Iterable[str],
+        *,
+        difficulty: Optional[Difficulty] = None,
+        drag_select: Optional[bool] = None,
+        per_cell: Optional[int] = None,
+    ) -> Dict[str, float]:
+        """
+        Get the best time for each of the given players.
+
+        :param names:
+            The names of the players (case insensitive).
+        :return:
+            The best time for each player that has a highscore matching the
+            filters, keyed by the name as given.
+        """
+        times = dict()
+        for name in names:
+            highscores = self.get_highscores(
+                name, difficulty=difficulty, drag_select=drag_select, per_cell=per_cell
+            )
+            if highscores:
+                times[name] = highscores[0].elapsed
+        return times
+
+
+snapshot = HighscoresSnapshot()
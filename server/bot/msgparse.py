@@ -12,10 +12,11 @@ import logging
 import sys
 from typing import Any, Callable, Dict, Iterable, List, Optional, Tuple, Union
 
-from minegauler.shared import highscores as hs
 from minegauler.shared.types import Difficulty
 
+from .. import live
 from . import formatter, utils
+from .leaderboard import snapshot
 
 
 logger = logging.getLogger(__name__)
@@ -438,9 +439,8 @@ def player(args, username: str, allow_markdown=False, **kwargs):
     if args.username == "me":
         args.username = username
 
-    highscores = hs.get_highscores(
-        hs.HighscoresDatabases.REMOTE,
-        name=utils.USER_NAMES[args.username],
+    highscores = snapshot.get_highscores(
+        utils.USER_NAMES[args.username],
         difficulty=args.difficulty,
         drag_select=args.drag_select,
         per_cell=args.per_cell,
@@ -653,10 +653,20 @@ def challenge(args, username: str, **kwargs):
     else:
         opts_str = ""
 
-    return "{} has challenged {} to a {}game of Minegauler{}".format(
+    msg = "{} has challenged {} to a {}game of Minegauler{}".format(
         username, users_str, diff_str, opts_str
     )
 
+    # Link to the games of any of the players who are streaming live.
+    watch_lines = []
+    for user in [username, *sorted(names)]:
+        url = live.get_live_game_url(utils.USER_NAMES.get(user, user))
+        if url:
+            watch_lines.append(f"Watch {user} live: {url}")
+    if watch_lines:
+        msg += "\n\n" + "\n".join(watch_lines)
+    return msg
+
 
 @helpstring("Set your nickname")
 @schema("set nickname <name>")
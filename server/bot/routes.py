@@ -62,13 +62,13 @@ def bot_message():
     room_type = msgparse.RoomType(data["roomType"])
 
     if send_welcome:
-        try:
-            utils.send_message(
-                person_id, msgparse.GENERAL_INFO, is_person_id=True, markdown=True
-            )
-        except requests.HTTPError:
-            logger.exception("Error sending bot welcome message")
-            _send_myself_error_msg("sending bot welcome message")
+        utils.send_message(
+            person_id,
+            msgparse.GENERAL_INFO,
+            is_person_id=True,
+            markdown=True,
+            description="bot welcome message",
+        )
 
     send_to_person_id = False
     send_to_id = room_id
@@ -83,33 +83,29 @@ def bot_message():
             send_to_person_id = True
             send_to_id = person_id
 
-    try:
-        utils.send_message(
-            send_to_id, resp_msg, is_person_id=send_to_person_id, markdown=True
-        )
-    except requests.HTTPError:
-        logger.exception("Error sending bot response message")
-        _send_myself_error_msg("sending bot response message")
+    # Sent in the background so that the webhook gets a quick response.
+    utils.send_message(
+        send_to_id,
+        resp_msg,
+        is_person_id=send_to_person_id,
+        markdown=True,
+        description="bot response message",
+    )
 
     return "", 200
 
 
 def new_highscore_hook(highscore: hs.HighscoreStruct) -> None:
     if highscore.name != "Siwel G":
-        try:
-            utils.send_myself_message(f"New highscore added:\n{highscore}")
-        except Exception:
-            logger.exception("Error sending webex message")
+        utils.send_myself_message(
+            f"New highscore added:\n{highscore}", description="new highscore message"
+        )
 
     if (
         highscore.name in utils.USER_NAMES.values()
         and is_highscore_new_best(highscore) == "time"
     ):
-        try:
-            utils.send_new_best_message(highscore)
-        except Exception:
-            logger.exception("Error sending webex message for new best")
-            _send_myself_error_msg("sending webex message for new best")
+        utils.send_new_best_message(highscore)
 
 
 def activate_bot_msg_handling(app: flask.app.Flask) -> None:
@@ -129,7 +125,6 @@ def activate_bot_msg_handling(app: flask.app.Flask) -> None:
 
 
 def _send_myself_error_msg(error: str) -> None:
-    try:
-        utils.send_myself_message(f"Error {error}, see server logs")
-    except requests.HTTPError:
-        logger.exception("Error sending myself bot message when handling error")
+    utils.send_myself_message(
+        f"Error {error}, see server logs", description="error message to myself"
+    )
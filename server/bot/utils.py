@@ -28,7 +28,10 @@ import collections
 import json
 import logging
 import pathlib
-from typing import Iterable, List, Optional, Tuple
+import queue
+import threading
+import time
+from typing import Dict, Iterable, List, Optional, Tuple
 
 import requests
 from requests_toolbelt import MultipartEncoder
@@ -36,6 +39,8 @@ from requests_toolbelt import MultipartEncoder
 from minegauler.shared import highscores as hs
 from minegauler.shared.types import Difficulty
 
+from .leaderboard import snapshot
+
 
 logger = logging.getLogger(__name__)
 
@@ -45,11 +50,23 @@ USER_NAMES_FILE = pathlib.Path(__file__).parent / "users.json"
 NO_TAG_USERS = {"_paula", "_felix", "_kunz", "esinghal"}
 
 BOT_NAME = "minegaulerbot"
-_BOT_ACCESS_TOKEN = ""
 _BOT_EMAIL = f"{BOT_NAME}@webex.bot"
 _WEBEX_GROUP_ROOM_ID = (
     "Y2lzY29zcGFyazovL3VzL1JPT00vNzYyNjI4NTAtMzg3Ni0xMWVhLTlhM2ItODMyNzMyZDlkZTg3"
 )
+_WEBEX_API_URL = "https://api.ciscospark.com/v1"
+_WEBEX_TIMEOUT = 10
+_PERSON_ID_TTL = 24 * 60 * 60
+
+# Keep-alive connection to the Webex API, shared between threads.
+_session = requests.Session()
+# Cache of person IDs with their expiry time, keyed by display name or email.
+_person_ids: Dict[str, Tuple[str, float]] = dict()
+_person_ids_lock = threading.Lock()
+# Outbound messages, sent by a background thread.
+_message_queue: "queue.Queue[Tuple[Tuple, Dict]]" = queue.Queue()
+_message_thread: Optional[threading.Thread] = None
+_message_thread_lock = threading.Lock()
 
 
 # ------------------------------------------------------------------------------
@@ -58,46 +75,63 @@ _WEBEX_GROUP_ROOM_ID = (
 
 
 def set_bot_access_token(token: str) -> None:
-    global _BOT_ACCESS_TOKEN
-    _BOT_ACCESS_TOKEN = token
+    _session.headers["Authorization"] = f"Bearer {token}"
 
 
 def get_message(msg_id: str) -> str:
-    response = requests.get(
-        f"https://api.ciscospark.com/v1/messages/{msg_id}",
-        headers={"Authorization": f"Bearer {_BOT_ACCESS_TOKEN}"},
+    response = _session.get(
+        f"{_WEBEX_API_URL}/messages/{msg_id}", timeout=_WEBEX_TIMEOUT
     )
     response.raise_for_status()
     return response.json()["text"]
 
 
 def send_message(
-    room_id: str, text: str, *, is_person_id=False, markdown=False
-) -> requests.Response:
-    logger.debug(
-        "Sending message to %s:\n%s", "person" if is_person_id else "room", text
-    )
-    id_field = "toPersonId" if is_person_id else "roomId"
-    text_field = "markdown" if markdown else "text"
-    multipart = MultipartEncoder({text_field: text, id_field: room_id})
-    response = requests.post(
-        "https://api.ciscospark.com/v1/messages",
-        data=multipart,
-        headers={
-            "Authorization": f"Bearer {_BOT_ACCESS_TOKEN}",
-            "Content-Type": multipart.content_type,
-        },
+    room_id: str,
+    text: str,
+    *,
+    is_person_id=False,
+    markdown=False,
+    description="bot message",
+) -> None:
+    """
+    Queue a message to be sent, returning without waiting for it to be sent.
+
+    Messages are sent in order by a background thread. If sending fails the
+    error is logged and reported in a message to myself.
+
+    :param room_id:
+        The ID of the room, or person if 'is_person_id' is set.
+    :param text:
+        The message text.
+    :param is_person_id:
+        Whether the ID is a person ID rather than a room ID.
+    :param markdown:
+        Whether the message is markdown.
+    :param description:
+        A description of the message for error reporting.
+    """
+    global _message_thread
+    with _message_thread_lock:
+        if _message_thread is None:
+            _message_thread = threading.Thread(
+                target=_send_queued_messages, name="bot-messages", daemon=True
+            )
+            _message_thread.start()
+    _message_queue.put(
+        (
+            (room_id, text),
+            dict(is_person_id=is_person_id, markdown=markdown, description=description),
+        )
     )
-    response.raise_for_status()
-    return response
 
 
-def send_myself_message(text: str) -> requests.Response:
-    return send_message(_get_my_id(), text, is_person_id=True)
+def send_myself_message(text: str, *, description="message to myself") -> None:
+    send_message(_MYSELF, text, is_person_id=True, description=description)
 
 
-def send_group_message(text: str) -> requests.Response:
-    return send_message(_WEBEX_GROUP_ROOM_ID, text)
+def send_group_message(text: str, *, description="group message") -> None:
+    send_message(_WEBEX_GROUP_ROOM_ID, text, description=description)
 
 
 def send_new_best_message(h: hs.HighscoreStruct) -> None:
@@ -106,7 +140,8 @@ def send_new_best_message(h: hs.HighscoreStruct) -> None:
     drag_select = "on" if h.drag_select else "off"
     send_group_message(
         f"New personal record of {h.elapsed:.2f} set by {h.name} on {diff}!\n"
-        f"Settings: drag-select={drag_select}, per-cell={h.per_cell}"
+        f"Settings: drag-select={drag_select}, per-cell={h.per_cell}",
+        description="new best message",
     )
 
 
@@ -141,19 +176,11 @@ def get_highscore_times(
         raise ValueError("No highscores for custom difficulty")
     if users is None:
         users = USER_NAMES.values()
-    lower_users = {u.lower(): u for u in users}
 
     if difficulty:
-        highscores = hs.filter_and_sort(
-            _get_highscores(
-                difficulty=difficulty, drag_select=drag_select, per_cell=per_cell,
-            )
+        times = snapshot.get_best_times(
+            users, difficulty=difficulty, drag_select=drag_select, per_cell=per_cell
         )
-        times = {
-            lower_users[h.name.lower()]: h.elapsed
-            for h in highscores
-            if h.name.lower() in lower_users
-        }
     else:
         times = {
             u: _get_combined_highscore(u, drag_select=drag_select, per_cell=per_cell)
@@ -195,7 +222,7 @@ PlayerInfo = collections.namedtuple(
 
 def get_player_info(username: str) -> PlayerInfo:
     name = USER_NAMES[username]
-    highscores = _get_highscores(name=name)
+    highscores = snapshot.get_highscores(name)
     combined_time = _get_combined_highscore(name)
     last_highscore = max(h.timestamp for h in highscores) if highscores else None
     hs_types = len(
@@ -213,35 +240,78 @@ def _strbool(b: bool) -> str:
     return "True" if b else "False"
 
 
-def _get_highscores(*args, **kwargs) -> Iterable[hs.HighscoreStruct]:
-    return hs.get_highscores(hs.HighscoresDatabases.REMOTE, *args, **kwargs)
-
-
 def _get_combined_highscore(
     name: str, *, per_cell: Optional[int] = None, drag_select: Optional[bool] = None
 ) -> float:
     total = 0
-    for diff in ["b", "i", "e"]:
-        all_highscores = _get_highscores(
-            name=name, drag_select=drag_select, per_cell=per_cell,
+    for diff in [Difficulty.BEGINNER, Difficulty.INTERMEDIATE, Difficulty.EXPERT]:
+        times = snapshot.get_best_times(
+            [name], difficulty=diff, drag_select=drag_select, per_cell=per_cell
         )
-        highscores = [h.elapsed for h in all_highscores if h.difficulty.lower() == diff]
-        total += min(highscores) if highscores else 1000
+        total += times.get(name, 1000)
     return total
 
 
+# Placeholder for my person ID, looked up when a message is sent.
+_MYSELF = object()
+
+
+def _send_queued_messages() -> None:
+    """Send messages from the queue, run in a background thread."""
+    while True:
+        args, kwargs = _message_queue.get()
+        description = kwargs.pop("description")
+        try:
+            _post_message(*args, **kwargs)
+        except Exception:
+            logger.exception("Error sending %s", description)
+            if args[0] is not _MYSELF:
+                send_myself_message(
+                    f"Error sending {description}, see server logs",
+                    description="error message to myself",
+                )
+
+
+def _post_message(
+    room_id: str, text: str, *, is_person_id=False, markdown=False
+) -> requests.Response:
+    if room_id is _MYSELF:
+        room_id = _get_my_id()
+    logger.debug(
+        "Sending message to %s:\n%s", "person" if is_person_id else "room", text
+    )
+    id_field = "toPersonId" if is_person_id else "roomId"
+    text_field = "markdown" if markdown else "text"
+    multipart = MultipartEncoder({text_field: text, id_field: room_id})
+    response = _session.post(
+        f"{_WEBEX_API_URL}/messages",
+        data=multipart,
+        headers={"Content-Type": multipart.content_type},
+        timeout=_WEBEX_TIMEOUT,
+    )
+    response.raise_for_status()
+    return response
+
+
 def _get_person_id(name_or_email: str) -> str:
+    """Look up a person's ID, caching the result."""
+    with _person_ids_lock:
+        cached = _person_ids.get(name_or_email)
+    if cached and cached[1] > time.monotonic():
+        return cached[0]
+
     if "@" in name_or_email:
         params = {"email": name_or_email}
     else:
         params = {"displayName": name_or_email}
-    response = requests.get(
-        f"https://api.ciscospark.com/v1/people",
-        params=params,
-        headers={"Authorization": f"Bearer {_BOT_ACCESS_TOKEN}"},
+    response = _session.get(
+        f"{_WEBEX_API_URL}/people", params=params, timeout=_WEBEX_TIMEOUT
     )
     response.raise_for_status()
-    return response.json()["items"][0]["id"]
+    person_id = response.json()["items"][0]["id"]
+    with _person_ids_lock:
+        _person_ids[name_or_email] = (person_id, time.monotonic() + _PERSON_ID_TTL)
+    return person_id
 
 
 def _get_my_id() -> str:
@@ -0,0 +1,313 @@
+"""
+live.py - Relaying of live games to spectators
+
+October 2020, Lewis Gaul
+"""
+
+__all__ = ("activate_live_streaming", "get_live_game_url")
+
+import base64
+import logging
+import re
+import secrets
+import threading
+import time
+from typing import Dict, Iterator, List, Optional, Tuple
+
+import flask
+from flask import Response, abort, jsonify, request
+
+from minegauler.shared.live import is_keyframe
+
+
+logger = logging.getLogger(__name__)
+
+LIVE_BASE_URL = "http://minegauler.lewisgaul.co.uk/api/v1/live"
+
+_GAME_ID_REGEX = re.compile(r"[\w-]{8,32}")
+_MAX_BATCH_SIZE = 64 * 1024
+_MAX_GAMES = 100
+# Games are ended if nothing is received from the player for this long.
+_GAME_TIMEOUT = 600
+# How often to send a comment to spectators of an idle game, which stops
+#  proxies closing the stream and detects spectators that have gone.
+_KEEPALIVE_INTERVAL = 15
+# Each spectator's stream holds a request thread, so streams are ended after
+#  this long, with the EventSource reconnecting after the given delay.
+_MAX_STREAM_DURATION = 300
+_RECONNECT_DELAY_MS = 1000
+
+
+def _sse_message(batch: bytes) -> bytes:
+    """Encode a batch as a server-sent event."""
+    return b"data: " + base64.b64encode(batch) + b"\n\n"
+
+
+class _LiveGame:
+    """
+    A game being played, to relay to spectators.
+
+    Each batch is encoded as a server-sent event once, when it is received,
+    with every spectator being sent the same bytes. Only the messages since
+    the latest keyframe are kept, which is where late joiners start from.
+    Spectators that fall behind the latest keyframe skip ahead to it, so
+    neither memory use nor the work per spectator grows with the game length.
+    """
+
+    def __init__(self, game_id: str, player: str):
+        # The game ID is only known to the player, who posts updates with it,
+        #  while spectators are given a separate stream ID.
+        self.game_id: str = game_id
+        self.stream_id: str = secrets.token_urlsafe(8)
+        self.player: str = player
+        self.last_update: float = time.monotonic()
+        self.ended: bool = False
+        self._cond = threading.Condition()
+        # The messages since and including the latest keyframe.
+        self._messages: List[bytes] = []
+        # The sequence number of the first of the messages.
+        self._first_seq = 0
+
+    def publish(self, batch: bytes) -> bool:
+        """
+        Publish a batch to spectators.
+
+        :return:
+            False if a keyframe is needed first.
+        """
+        msg = _sse_message(batch)
+        with self._cond:
+            self.last_update = time.monotonic()
+            if is_keyframe(batch):
+                self._first_seq += len(self._messages)
+                self._messages = [msg]
+            elif not self._messages:
+                return False
+            else:
+                self._messages.append(msg)
+            self._cond.notify_all()
+        return True
+
+    def end(self) -> None:
+        with self._cond:
+            self.ended = True
+            self._cond.notify_all()
+
+    def get_messages(self, seq: int, timeout: float) -> Tuple[List[bytes], int]:
+        """
+        Get the messages from a sequence number, waiting for new messages if
+        there are none.
+
+        :param seq:
+            The sequence number of the next message wanted, or 0 to start from
+            the latest keyframe.
+        :param timeout:
+            The maximum time to wait for new messages.
+        :return:
+            The messages and the sequence number following them.
+        """
+        with self._cond:
+            if seq >= self._first_seq + len(self._messages) and not self.ended:
+                self._cond.wait(timeout)
+            seq = max(seq, self._first_seq)
+            end = self._first_seq + len(self._messages)
+            return self._messages[seq - self._first_seq :], end
+
+
+_games_lock = threading.Lock()
+_games: Dict[str, _LiveGame] = dict()
+_games_by_stream: Dict[str, _LiveGame] = dict()
+
+# The maximum number of spectators across all games, which must be below the
+#  number of request threads to leave threads for other routes.
+_max_spectators = 8
+_nr_spectators = 0
+
+
+def _stream_url(game: _LiveGame) -> str:
+    return f"{LIVE_BASE_URL}/{game.stream_id}/stream"
+
+
+def _remove_expired_games() -> None:
+    now = time.monotonic()
+    with _games_lock:
+        expired = [g for g in _games.values() if now - g.last_update > _GAME_TIMEOUT]
+        for game in expired:
+            logger.debug("Live game %s timed out", game.game_id)
+            del _games[game.game_id]
+            del _games_by_stream[game.stream_id]
+    for game in expired:
+        game.end()
+
+
+def get_live_game_url(player: str) -> Optional[str]:
+    """
+    Get the URL to watch a player's live game.
+
+    Player names aren't verified, so this may give another game streamed
+    under the same name.
+
+    :param player:
+        The name of the player.
+    :return:
+        The URL of the stream of their most recently updated game, or None if
+        they aren't streaming a game.
+    """
+    _remove_expired_games()
+    with _games_lock:
+        games = [g for g in _games.values() if g.player == player]
+    if not games:
+        return None
+    game = max(games, key=lambda g: g.last_update)
+    return _stream_url(game)
+
+
+# ------------------------------------------------------------------------------
+# REST API
+# ------------------------------------------------------------------------------
+
+
+def api_v1_live_games():
+    """Get the games being streamed."""
+    _remove_expired_games()
+    with _games_lock:
+        games = list(_games.values())
+    return jsonify(
+        [
+            {"player": g.player, "stream_id": g.stream_id, "url": _stream_url(g)}
+            for g in games
+        ]
+    )
+
+
+def api_v1_live_game_update(game_id: str):
+    """
+    Receive a batch of updates for a live game, sent as the request body.
+
+    The player's name is given by the 'player' query parameter. This isn't
+    verified, and is only taken when the game starts so that it can't be
+    changed by later updates.
+
+    Responds with 409 if a keyframe batch is needed to start the game.
+    """
+    if not _GAME_ID_REGEX.fullmatch(game_id):
+        abort(400, "Invalid game ID")
+    player = request.args.get("player", "")[:20]
+    if request.content_length and request.content_length > _MAX_BATCH_SIZE:
+        abort(413)
+    batch = request.get_data(cache=False)
+    if not batch or len(batch) > _MAX_BATCH_SIZE:
+        abort(400, "Invalid batch size")
+
+    with _games_lock:
+        game = _games.get(game_id)
+        if game is None:
+            if not is_keyframe(batch):
+                return "", 409
+            if len(_games) >= _MAX_GAMES:
+                abort(503, "Too many live games")
+            logger.info("Starting live game %s for player %r", game_id, player)
+            game = _games[game_id] = _LiveGame(game_id, player)
+            _games_by_stream[game.stream_id] = game
+    if not game.publish(batch):
+        return "", 409
+    return "", 200
+
+
+def api_v1_live_game_end(game_id: str):
+    """End a live game."""
+    with _games_lock:
+        game = _games.pop(game_id, None)
+        if game is not None:
+            del _games_by_stream[game.stream_id]
+    if game is None:
+        abort(404)
+    logger.info("Ending live game %s", game_id)
+    game.end()
+    return "", 200
+
+
+class _SpectatorStream:
+    """
+    The stream of a live game sent to a spectator, counting towards the
+    spectator limit until closed by the WSGI server.
+    """
+
+    def __init__(self, game: _LiveGame):
+        self._game = game
+        self._closed = False
+
+    def __iter__(self) -> Iterator[bytes]:
+        yield f"retry: {_RECONNECT_DELAY_MS}\n\n".encode()
+        deadline = time.monotonic() + _MAX_STREAM_DURATION
+        seq = 0
+        while time.monotonic() < deadline:
+            messages, seq = self._game.get_messages(seq, _KEEPALIVE_INTERVAL)
+            if messages:
+                yield b"".join(messages)
+            elif self._game.ended:
+                break
+            else:
+                yield b": keepalive\n\n"
+
+    def close(self) -> None:
+        global _nr_spectators
+        with _games_lock:
+            if not self._closed:
+                self._closed = True
+                _nr_spectators -= 1
+
+
+def api_v1_live_game_stream(stream_id: str):
+    """
+    Stream a live game as server-sent events, each containing a base64-encoded
+    batch (see minegauler.shared.live). The stream starts with the latest
+    keyframe batch, and is ended after a few minutes, after which the client
+    should reconnect.
+
+    Responds with 503 if there are too many spectators.
+    """
+    global _nr_spectators
+    with _games_lock:
+        game = _games_by_stream.get(stream_id)
+        if game is not None:
+            if _nr_spectators >= _max_spectators:
+                abort(503, "Too many spectators")
+            _nr_spectators += 1
+    if game is None:
+        abort(404)
+    return Response(
+        _SpectatorStream(game),
+        mimetype="text/event-stream",
+        headers={"Cache-Control": "no-cache", "X-Accel-Buffering": "no"},
+    )
+
+
+def activate_live_streaming(app: flask.app.Flask, *, max_spectators: int) -> None:
+    """
+    Register the routes for live games.
+
+    :param max_spectators:
+        The maximum number of spectators across all games, which should be
+        below the number of request threads.
+    """
+    global _max_spectators
+    _max_spectators = max_spectators
+    app.add_url_rule("/api/v1/live", "api_v1_live_games", api_v1_live_games)
+    app.add_url_rule(
+        "/api/v1/live/<game_id>",
+        "api_v1_live_game_update",
+        api_v1_live_game_update,
+        methods=["POST"],
+    )
+    app.add_url_rule(
+        "/api/v1/live/<game_id>",
+        "api_v1_live_game_end",
+        api_v1_live_game_end,
+        methods=["DELETE"],
+    )
+    app.add_url_rule(
+        "/api/v1/live/<stream_id>/stream",
+        "api_v1_live_game_stream",
+        api_v1_live_game_stream,
+    )
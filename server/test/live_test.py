@@ -0,0 +1,46 @@
+"""
+live_test.py - Test the live module
+
+October 2020, Lewis Gaul
+"""
+
+from unittest import mock
+
+import pytest
+
+from minegauler.shared.live import LiveEncoder
+from server import live
+
+
+@pytest.fixture(autouse=True)
+def clear_games():
+    yield
+    live._games.clear()
+    live._games_by_stream.clear()
+
+
+def _post(game_id: str, player: str, batch: bytes):
+    """Post a batch of updates for a live game."""
+    request = mock.Mock(content_length=len(batch))
+    request.args = {"player": player}
+    request.get_data.return_value = batch
+    with mock.patch.object(live, "request", request):
+        return live.api_v1_live_game_update(game_id)
+
+
+class TestLiveGames:
+    """Test relaying live games."""
+
+    def test_player_name(self):
+        """Test a game's player name is kept from the first keyframe."""
+        keyframe = LiveEncoder(4, 4).flush()
+        assert _post("game-one-id", "alice", keyframe) == ("", 200)
+        url = live.get_live_game_url("alice")
+        assert url is not None
+
+        # Another game streamed under the same name doesn't take over.
+        assert _post("game-two-id", "mallory", keyframe) == ("", 200)
+        assert _post("game-two-id", "alice", keyframe) == ("", 200)
+        assert live.get_live_game_url("alice") == url
+        assert live.get_live_game_url("mallory") != url
+        assert live._games["game-two-id"].player == "mallory"
@@ -7,8 +7,7 @@ from minegauler.shared import highscores as hs
 
 
 def is_highscore_new_best(h: hs.HighscoreStruct) -> Optional[str]:
-    all_highscores = hs.get_highscores(hs.HighscoresDatabases.REMOTE, settings=h)
-    return hs.is_highscore_new_best(h, all_highscores)
+    return hs.is_highscore_new_best(h, database=hs.HighscoresDatabases.REMOTE)
 
 
 @contextlib.contextmanager
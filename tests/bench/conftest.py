@@ -0,0 +1,96 @@
+# October 2020, Lewis Gaul
+
+"""
+Pytest conftest file for the benchmarks.
+
+Benchmarks on the largest boards and highscore tables are marked 'large' and
+are only run if '--bench-large' is passed.
+
+"""
+
+import pathlib
+import random
+import tempfile
+from typing import Iterator, List
+
+import pytest
+
+from minegauler.shared.highscores import HighscoreStruct, LocalHighscoresDB
+
+
+def pytest_addoption(parser):
+    parser.addoption(
+        "--bench-large",
+        action="store_true",
+        help="Include benchmarks on the largest boards and highscore tables",
+    )
+
+
+def pytest_configure(config):
+    config.addinivalue_line("markers", "large: slow benchmark on large inputs")
+
+
+def pytest_collection_modifyitems(config, items):
+    if config.getoption("--bench-large"):
+        return
+    skip_large = pytest.mark.skip(reason="Needs --bench-large to run")
+    for item in items:
+        if "large" in item.keywords:
+            item.add_marker(skip_large)
+
+
+def make_highscores(nr_rows: int, *, seed: int = 0) -> List[HighscoreStruct]:
+    """
+    Create random highscores spread across the settings groups.
+
+    :param nr_rows:
+        The number of highscores to create.
+    :param seed:
+        Seed for the random values.
+    """
+    rng = random.Random(seed)
+    names = [f"player{i}" for i in range(max(10, nr_rows // 1000))]
+    highscores = []
+    for i in range(nr_rows):
+        elapsed = round(rng.uniform(1, 500), 2)
+        bbbv = rng.randint(2, 300)
+        highscores.append(
+            HighscoreStruct(
+                difficulty=rng.choice("BIEM"),
+                per_cell=rng.randint(1, 3),
+                drag_select=rng.random() < 0.5,
+                name=rng.choice(names),
+                timestamp=1500000000 + i,
+                elapsed=elapsed,
+                bbbv=bbbv,
+                bbbvps=bbbv / elapsed,
+                flagging=rng.random(),
+            )
+        )
+    return highscores
+
+
+@pytest.fixture(scope="session")
+def tmpdir() -> Iterator[pathlib.Path]:
+    with tempfile.TemporaryDirectory() as tmpdir:
+        yield pathlib.Path(tmpdir)
+
+
+@pytest.fixture(
+    scope="session",
+    params=[
+        1_000,
+        10_000,
+        pytest.param(100_000, marks=pytest.mark.large),
+        pytest.param(1_000_000, marks=pytest.mark.large),
+    ],
+    ids=["1k", "10k", "100k", "1M"],
+)
+def local_db_path(request, tmpdir) -> pathlib.Path:
+    """Path to a local highscores DB filled with random highscores."""
+    path = tmpdir / f"highscores_{request.param}.db"
+    if not path.exists():
+        db = LocalHighscoresDB(path)
+        db.insert_highscores(make_highscores(request.param))
+        db.conn.close()
+    return path
@@ -0,0 +1,130 @@
+# October 2020, Lewis Gaul
+
+"""
+Benchmarks for the core game logic.
+
+"""
+
+from unittest import mock
+
+import pytest
+
+from minegauler.core import api
+from minegauler.core.board import Minefield
+from minegauler.core.engine import _GameController
+from minegauler.core.game import Game
+from minegauler.shared.types import CellContents
+from minegauler.shared.utils import GameOptsStruct
+
+
+@pytest.fixture(
+    params=[
+        (8, 8, 10),
+        (30, 16, 99),
+        (100, 100, 2000),
+        pytest.param((500, 500, 50000), marks=pytest.mark.large),
+    ],
+    ids=["beginner", "expert", "100x100", "500x500"],
+)
+def board_size(request):
+    """Board dimensions and number of mines, as (x_size, y_size, mines)."""
+    return request.param
+
+
+@pytest.fixture(params=[1, 2, 3], ids=["pc1", "pc2", "pc3"])
+def per_cell(request) -> int:
+    return request.param
+
+
+@pytest.fixture
+def minefield(board_size, per_cell) -> Minefield:
+    x_size, y_size, mines = board_size
+    return Minefield(x_size, y_size, mines=mines, per_cell=per_cell, seed=0)
+
+
+def _get_opening_coord(mf: Minefield):
+    """Get the coordinate of a blank cell in the largest opening of a minefield."""
+    if not mf.openings:
+        pytest.skip("Minefield has no openings")
+    opening = max(mf.openings, key=len)
+    return next(c for c in opening if mf.completed_board[c] is CellContents.Num(0))
+
+
+def _get_chord_coord(mf: Minefield):
+    """Get a coordinate of a number with the most unclicked neighbours to chord."""
+    completed = mf.completed_board
+    coords = [
+        c
+        for c in mf.all_coords
+        if type(completed[c]) is CellContents.Num and completed[c].num > 0
+    ]
+    if not coords:
+        pytest.skip("Minefield has no numbers to chord on")
+    return max(
+        coords,
+        key=lambda c: sum(not mf.cell_contains_mine(n) for n in mf.get_nbrs(c)),
+    )
+
+
+def test_create_minefield(benchmark, board_size, per_cell):
+    """Create a random minefield, including computing openings and 3bv."""
+    x_size, y_size, mines = board_size
+    benchmark(Minefield, x_size, y_size, mines=mines, per_cell=per_cell)
+
+
+def test_select_opening(benchmark, minefield):
+    """Select a cell in the largest opening at the start of a game."""
+    coord = _get_opening_coord(minefield)
+    benchmark.pedantic(
+        lambda game: game.select_cell(coord),
+        setup=lambda: ((Game(minefield=minefield),), {}),
+        rounds=20,
+    )
+
+
+def test_chord(benchmark, minefield):
+    """Chord on a number with its mines flagged."""
+    coord = _get_chord_coord(minefield)
+
+    def setup():
+        game = Game(minefield=minefield)
+        game.select_cell(coord)
+        for c in minefield.get_nbrs(coord):
+            if minefield.cell_contains_mine(c):
+                game.set_cell_flags(c, minefield[c])
+        return (game,), {}
+
+    benchmark.pedantic(lambda game: game.chord_on_cell(coord), setup=setup, rounds=50)
+
+
+def test_rem_3bv_first_call(benchmark, minefield):
+    """Get the remaining 3bv for the first time, after selecting an opening."""
+    coord = _get_opening_coord(minefield)
+
+    def setup():
+        game = Game(minefield=minefield)
+        game.select_cell(coord)
+        return (game,), {}
+
+    benchmark.pedantic(lambda game: game.get_rem_3bv(), setup=setup, rounds=20)
+
+
+def test_rem_3bv(benchmark, minefield):
+    """Get the remaining 3bv during a game, after the first call."""
+    game = Game(minefield=minefield)
+    game.select_cell(_get_opening_coord(minefield))
+    game.get_rem_3bv()
+    benchmark(game.get_rem_3bv)
+
+
+def test_get_game_info(benchmark, board_size, per_cell):
+    """Get the game info shown in the UI during a game."""
+    x_size, y_size, mines = board_size
+    opts = GameOptsStruct(
+        x_size=x_size, y_size=y_size, mines=mines, per_cell=per_cell, first_success=True
+    )
+    ctrlr = _GameController(opts, notif=mock.Mock(spec=api.AbstractListener))
+    ctrlr.select_cell((x_size // 2, y_size // 2))
+    if ctrlr._game.state.finished():
+        pytest.skip("Game finished on the first click")
+    benchmark(ctrlr.get_game_info)
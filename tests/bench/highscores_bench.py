@@ -0,0 +1,95 @@
+# October 2020, Lewis Gaul
+
+"""
+Benchmarks for the highscores databases and views.
+
+"""
+
+from unittest import mock
+
+import pytest
+
+from minegauler.shared import highscores
+from minegauler.shared.highscores import (
+    HighscoreSettingsStruct,
+    LocalHighscoresDB,
+    filter_and_sort,
+)
+from minegauler.shared.types import Difficulty
+
+
+@pytest.fixture
+def local_db(local_db_path) -> LocalHighscoresDB:
+    db = LocalHighscoresDB(local_db_path)
+    yield db
+    db.conn.close()
+
+
+def test_get_highscores(benchmark, local_db):
+    """Fetch all highscores for a settings group."""
+    benchmark(
+        lambda: list(
+            local_db.get_highscores(
+                difficulty=Difficulty.BEGINNER, per_cell=1, drag_select=False
+            )
+        )
+    )
+
+
+def test_get_player_highscores(benchmark, local_db):
+    """Fetch one player's highscores across all settings."""
+    benchmark(lambda: list(local_db.get_highscores(name="player1")))
+
+
+def test_get_leaderboard(benchmark, local_db):
+    """Fetch the ranked best highscore per player for a settings group."""
+    benchmark(
+        local_db.get_leaderboard,
+        difficulty=Difficulty.BEGINNER,
+        per_cell=1,
+        drag_select=False,
+        sort_by="time",
+    )
+
+
+def test_filter_and_sort(benchmark, local_db):
+    """Rank a settings group's highscores in Python."""
+    hscores = list(
+        local_db.get_highscores(
+            difficulty=Difficulty.BEGINNER, per_cell=1, drag_select=False
+        )
+    )
+    benchmark(filter_and_sort, hscores, "3bv/s", {"flagging": "F"})
+
+
+def test_model_filter_and_sort(benchmark, local_db_path):
+    """Update the highscores window model, fetching the ranking from the DB."""
+    pytest.importorskip("PyQt5")
+    from minegauler.frontend import highscores as frontend_highscores
+    from minegauler.frontend.state import HighscoreWindowState
+
+    model = frontend_highscores.HighscoresModel(None, HighscoreWindowState())
+    with mock.patch.object(
+        highscores.LocalHighscoresDB.__init__, "__defaults__", (local_db_path,)
+    ):
+        model.update_highscores_group(HighscoreSettingsStruct.get_default())
+        benchmark.pedantic(
+            model.filter_and_sort,
+            setup=frontend_highscores.clear_highscores_cache,
+            rounds=20,
+        )
+
+
+def test_model_filter_and_sort_cached(benchmark, local_db_path):
+    """Update the highscores window model from a cached ranking."""
+    pytest.importorskip("PyQt5")
+    from minegauler.frontend import highscores as frontend_highscores
+    from minegauler.frontend.state import HighscoreWindowState
+
+    model = frontend_highscores.HighscoresModel(None, HighscoreWindowState())
+    with mock.patch.object(
+        highscores.LocalHighscoresDB.__init__, "__defaults__", (local_db_path,)
+    ):
+        frontend_highscores.clear_highscores_cache()
+        model.update_highscores_group(HighscoreSettingsStruct.get_default())
+        benchmark(model.filter_and_sort)
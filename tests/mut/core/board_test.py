@@ -10,9 +10,10 @@ from typing import List
 
 import pytest
 
+from minegauler.core import board
 from minegauler.core.board import Board, Minefield
 from minegauler.shared.types import CellContents, Coord_T
-from minegauler.shared.utils import Grid
+from minegauler.shared.utils import Grid, get_nbr_table
 
 
 class TestMinefield:
@@ -177,6 +178,21 @@ class TestMinefield:
         else:
             assert False, "Expected to find a safe cell"
 
+    def test_create_seeded(self):
+        """Check seeded creation is reproducible, for sparse and dense boards."""
+        for mines in [5, 3 * self.x * self.y]:
+            safe_coords = [(0, 0), (1, 1), (self.x - 1, self.y - 1)]
+            mf1 = Minefield(
+                self.x, self.y, mines=mines, per_cell=4, safe_coords=safe_coords, seed=3
+            )
+            mf2 = Minefield(
+                self.x, self.y, mines=mines, per_cell=4, safe_coords=safe_coords, seed=3
+            )
+            self.check_mf_created(mf1)
+            assert mf1 == mf2
+            assert mf1.mine_coords == mf2.mine_coords
+            assert not any(mf1.cell_contains_mine(c) for c in safe_coords)
+
     def test_create_errors(self):
         """Check various creation errors."""
         # Check error when too many mines.
@@ -196,6 +212,38 @@ class TestMinefield:
         with pytest.raises(ValueError):
             Minefield(self.x, self.y, mines=mine_coords, per_cell=1)
 
+    def test_relocate_mines(self):
+        """Check moving mines out of safe cells matches creating from scratch."""
+        for per_cell, mines in [(1, 30), (2, 60), (3, 250)]:
+            mf = Minefield(12, 10, mines=mines, per_cell=per_cell, seed=1)
+            safe_coords = mf.get_nbrs((5, 5), include_origin=True)
+            mf.relocate_mines(safe_coords, seed=2)
+            exp_mf = Minefield(12, 10, mines=mf.mine_coords, per_cell=per_cell)
+            assert mf == exp_mf
+            assert mf.nr_mines == mines
+            assert not any(mf.cell_contains_mine(c) for c in safe_coords)
+            assert mf.completed_board == exp_mf.completed_board
+            assert sorted(mf.opening_idxs) == sorted(exp_mf.opening_idxs)
+            assert sorted(mf.openings) == sorted(exp_mf.openings)
+            assert mf.bbbv == exp_mf.bbbv
+            for label, opening in enumerate(mf.opening_idxs):
+                assert label in (mf.opening_ids[i] for i in opening)
+
+        # Check error when too many mines.
+        mf = Minefield(self.x, self.y, mines=self.x * self.y - 1, per_cell=1)
+        with pytest.raises(ValueError):
+            mf.relocate_mines([(0, 0), (1, 1)])
+
+    def test_box_sum(self):
+        """Check the neighbourhood sums used for the completed board."""
+        grid = Grid.from_2d_array([[0, 2, 0, 0], [1, 0, 0, 3], [0, 0, 1, 0]])
+        exp_sums = [3, 3, 5, 3, 3, 4, 6, 4, 1, 2, 4, 4]
+        assert board._box_sum_py(grid.cells, 4, 3) == exp_sums
+        assert board._box_sum_py([5], 1, 1) == [5]
+        if board.np is not None:
+            assert board._box_sum_numpy(grid.cells, 4, 3) == exp_sums
+            assert board._box_sum_numpy([5], 1, 1) == [5]
+
     def test_stringify(self):
         """Get coverage of stringify methods."""
         mf = Minefield(self.x, self.y, mines=self.mines, per_cell=self.per_cell)
@@ -268,3 +316,84 @@ class TestMinefield:
         for c in mf.all_coords:
             assert mf[c] == mf.mine_coords.count(c)
             assert mf.completed_board[c] == exp_completed_board[c]
+        # Check the opening index is consistent with the openings.
+        assert len(mf.opening_idxs) == len(mf.openings)
+        for i, opening in enumerate(mf.opening_idxs):
+            assert sorted(map(mf.idx_to_coord, opening)) in mf.openings
+            for idx in opening:
+                if mf.completed_board.cells[idx] == CellContents.Num(0).code:
+                    assert mf.opening_ids[idx] == i
+                else:
+                    assert mf.opening_ids[idx] == -1
+
+
+class TestBoard:
+    """Test the Board class."""
+
+    def test_flat_storage(self):
+        """Check the flat buffer of cell codes matches coordinate access."""
+        board = Board(4, 3)
+        assert len(board.cells) == 4 * 3
+        assert board.coord_to_idx((1, 2)) == 9
+        assert board.idx_to_coord(9) == (1, 2)
+
+        board[(1, 2)] = CellContents.Num(3)
+        assert board.cells[9] == CellContents.Num(3).code
+        board.cells[3] = CellContents.Flag(1).code
+        assert board[(3, 0)] is CellContents.Flag(1)
+        assert board.cells[0] == CellContents.Unclicked.code == 0
+
+        with pytest.raises(IndexError):
+            board[(4, 0)]
+        with pytest.raises(TypeError):
+            board[3]
+        with pytest.raises(TypeError):
+            board[(0, 0)] = 1
+
+    def test_bulk_operations(self):
+        """Check the bulk fill, copy and reset operations."""
+        board = Board(4, 3)
+        board.fill(CellContents.Num(0))
+        assert all(c == CellContents.Num(0).code for c in board.cells)
+
+        board_copy = board.copy()
+        assert type(board_copy) is Board
+        assert board_copy == board
+        board_copy[(0, 0)] = CellContents.Flag(1)
+        assert board_copy != board
+        assert board[(0, 0)] is CellContents.Num(0)
+
+        board.reset()
+        assert board == Board(4, 3)
+        assert list(board) == [[CellContents.Unclicked] * 4] * 3
+
+    def test_all_coords_shared(self):
+        """Check the list of coordinates is shared between same-sized grids."""
+        assert Board(4, 3).all_coords is Grid(4, 3).all_coords
+        assert Board(4, 3).all_coords[:4] == ((0, 0), (0, 1), (0, 2), (1, 0))
+
+    def test_nbr_table(self):
+        """Check the shared neighbour table."""
+        board = Board(4, 3)
+        assert board.nbr_table is get_nbr_table(4, 3)
+        assert board.nbr_table is Minefield(4, 3, mines=0).nbr_table
+        assert get_nbr_table(3, 4) is not get_nbr_table(4, 3)
+
+        # Corner cell.
+        assert list(board.get_nbr_idxs(0)) == [1, 4, 5]
+        assert list(board.get_nbr_idxs(0, include_origin=True)) == [0, 1, 4, 5]
+        # Central cell.
+        assert sorted(board.get_nbr_idxs(5)) == [0, 1, 2, 4, 6, 8, 9, 10]
+        # Coordinate API is consistent.
+        for c in board.all_coords:
+            nbrs = board.get_nbrs(c)
+            assert c not in nbrs
+            assert sorted(nbrs) == sorted(
+                (i, j)
+                for i in range(c[0] - 1, c[0] + 2)
+                for j in range(c[1] - 1, c[1] + 2)
+                if board.is_coord_in_grid((i, j)) and (i, j) != c
+            )
+            assert sorted(board.get_nbrs(c, include_origin=True)) == sorted(
+                nbrs + [c]
+            )
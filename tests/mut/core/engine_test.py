@@ -627,6 +627,31 @@ class TestGameController:
         assert not ctrlr._game.mf
         assert ctrlr._game.board == Board(opts.x_size, opts.y_size)
 
+    def test_pregenerated_minefield(self):
+        """Test the next minefield being created in the background."""
+        ctrlr = self.create_controller(set_mf=False)
+        key, future = ctrlr._pregen
+        assert key == (self.opts.x_size, self.opts.y_size, self.opts.mines, 2)
+        mf = future.result()
+        ctrlr.select_cell((0, 0))
+        assert ctrlr._game.mf is mf
+        assert ctrlr._game.board[(0, 0)] is CellContents.Num(0)
+        # The next game's minefield is started.
+        next_future = ctrlr._pregen[1]
+        assert next_future is not future
+        ctrlr.new_game()
+        assert ctrlr._pregen[1] is next_future
+        ctrlr.select_cell((0, 0))
+        assert ctrlr._game.mf is next_future.result()
+
+        # Changing the options discards the pregenerated minefield.
+        ctrlr.resize_board(x_size=6, y_size=6, mines=4)
+        assert ctrlr._pregen[0] == (6, 6, 4, 2)
+        ctrlr.set_per_cell(1)
+        assert ctrlr._pregen[0] == (6, 6, 4, 1)
+        ctrlr.select_cell((0, 0))
+        assert ctrlr._game.mf.per_cell == 1
+
     def test_lives(self):
         opts = self.opts.copy()
         opts.lives = 3
@@ -755,8 +780,8 @@ class TestGameController:
         with pytest.raises(ValueError):
             ctrlr.set_per_cell(0)
 
-    @mock.patch("builtins.open")
-    def test_save_minefield(self, mock_open):
+    @mock.patch("minegauler.core.mgb.save_minefield")
+    def test_save_minefield(self, mock_save_minefield):
         """Test the method to save the current minefield."""
         ctrlr = self.create_controller()
 
@@ -766,20 +791,19 @@ class TestGameController:
 
         # Success case.
         ctrlr._game.state = GameState.WON
-        with mock.patch("json.dump") as mock_json_dump:
-            ctrlr.save_current_minefield("file")
-        mock_open.assert_called_once_with("file", "w")
-        mock_json_dump.assert_called_once_with(ctrlr._game.mf.to_json(), mock.ANY)
+        ctrlr.save_current_minefield("file")
+        mock_save_minefield.assert_called_once_with(ctrlr._game.mf, "file")
 
-    @mock.patch("builtins.open")
-    def test_load_minefield(self, mock_open):
+    def test_load_minefield(self):
         """Test the method to load a minefield from file."""
         ctrlr = self.create_controller()
         mf = Minefield(11, 12, mines=10)
 
-        with mock.patch("json.load", return_value=mf.to_json()):
+        with mock.patch(
+            "minegauler.core.mgb.load_minefield", return_value=mf
+        ) as mock_load_minefield:
             ctrlr.load_minefield("file")
-        mock_open.assert_called_once_with("file")
+        mock_load_minefield.assert_called_once_with("file")
         assert ctrlr._opts.x_size == 11
         assert ctrlr._opts.y_size == 12
         assert ctrlr._opts.mines == 10
@@ -1014,8 +1038,7 @@ class TestCreateController:
         ctrlr.set_per_cell(2)
         assert ctrlr.get_game_info().per_cell == 2
 
-    @mock.patch("builtins.open")
-    def test_save_minefield(self, mock_open):
+    def test_save_minefield(self):
         """Test the method to save the current minefield."""
         ctrlr = self.create_controller(GameOptsStruct(x_size=3, y_size=3, per_cell=3))
         ctrlr.select_cell((0, 0))
@@ -1035,10 +1058,9 @@ class TestCreateController:
             per_cell=3,
         )
 
-        with mock.patch("json.dump") as mock_json_dump:
+        with mock.patch("minegauler.core.mgb.save_minefield") as mock_save_minefield:
             ctrlr.save_current_minefield("file")
-        mock_open.assert_called_once_with("file", "w")
-        mock_json_dump.assert_called_once_with(mf.to_json(), mock.ANY)
+        mock_save_minefield.assert_called_once_with(mf, "file")
 
     # --------------------------------------------------------------------------
     # Helper methods
@@ -186,6 +186,96 @@ class TestGame:
         assert game.get_rem_3bv() == 0
         assert game.get_prop_complete() == 1
 
+    def test_rem_3bv_tracking(self):
+        """Test the remaining 3bv is tracked incrementally once requested."""
+        mf = Minefield.from_2d_array([[0, 0, 0, 0, 0, 0, 1]])
+        game = Game(minefield=mf)
+        assert game.mf.bbbv == 1
+
+        # Split the opening using flags.
+        #   F . . . F # #
+        game.set_cell_flags((0, 0), 1)
+        game.set_cell_flags((4, 0), 1)
+        game.select_cell((2, 0))
+        # No tracking until the remaining 3bv is first requested.
+        assert game._bbbv_tracker is None
+        assert game.get_rem_3bv() == 2
+        assert game._bbbv_tracker is not None
+
+        # Updated from subsequent cell reveals.
+        #   . . . . F # #
+        game.set_cell_flags((0, 0), 0)
+        game.select_cell((0, 0))
+        assert game.get_rem_3bv() == 1
+        #   . . . . . 1 #
+        game.set_cell_flags((4, 0), 0)
+        game.select_cell((4, 0))
+        assert game.state is GameState.WON
+        assert game._bbbv_tracker.get_rem_3bv() == 0
+
+    def test_partially_revealed_opening(self):
+        """Test clicking part of an opening only reveals the connected cells."""
+        mf = Minefield.from_2d_array([[0, 0, 0, 0, 0, 0, 0, 0, 1]])
+        game = Game(minefield=mf)
+
+        # Reveal the middle of the opening, then remove the flags around it.
+        #   # F . . F # # # #
+        game.set_cell_flags((1, 0), 1)
+        game.set_cell_flags((4, 0), 1)
+        assert set(game.select_cell((2, 0))) == {(2, 0), (3, 0)}
+        game.set_cell_flags((1, 0), 0)
+        game.set_cell_flags((4, 0), 0)
+
+        # The revealed cells separate the rest of the opening into two parts.
+        #   . . . . # # # # #
+        assert set(game.select_cell((0, 0))) == {(0, 0), (1, 0)}
+        assert game.board[(5, 0)] is CellContents.Unclicked
+        assert game.state is GameState.ACTIVE
+        #   . . . . . . . 1 #
+        assert set(game.select_cell((5, 0))) >= {(4, 0), (5, 0), (6, 0), (7, 0)}
+        assert game.state is GameState.WON
+
+    def test_pregenerated_minefield(self):
+        """Test using a minefield created before the game is started."""
+        mf = Minefield(8, 8, mines=20, seed=1)
+        game = Game(x_size=8, y_size=8, mines=20, first_success=True)
+        game.pregenerated = mf
+        game.select_cell((3, 3))
+        assert game.mf is mf
+        assert game.pregenerated is None
+        assert not game.minefield_known
+        assert game.board[(3, 3)] is CellContents.Num(0)
+
+        # Minefields that don't match the game are ignored.
+        game = Game(x_size=8, y_size=8, mines=21)
+        game.pregenerated = Minefield(8, 8, mines=20)
+        game.select_cell((3, 3))
+        assert game.mf.nr_mines == 21
+
+    def test_completion(self):
+        """Test the game is won as soon as the last safe cell is revealed."""
+        mf = Minefield.from_2d_array([[0, 2, 0], [1, 0, 0]], per_cell=2)
+        game = Game(minefield=mf, lives=2)
+        game.select_cell((0, 1))
+        assert game.lives_remaining == 1
+        game.select_cell((2, 0))
+        game.select_cell((2, 1))
+        assert game.state is GameState.ACTIVE
+        game.set_cell_flags((0, 0), 1)
+        game.select_cell((1, 1))
+        assert game.state is GameState.ACTIVE
+        # Flagged safe cells must still be revealed.
+        game.set_cell_flags((0, 0), 0)
+        updates = game.select_cell((0, 0))
+        assert game.state is GameState.WON
+        assert game.mines_remaining == 0
+        # Mines are flagged in the same update, leaving the hit mine.
+        assert updates == {
+            (0, 0): CellContents.Num(3).code,
+            (1, 0): CellContents.Flag(2).code,
+        }
+        assert game.board[(0, 1)] is CellContents.HitMine(1)
+
     def test_empty_minefield(self):
         """Test game methods with an empty minefield."""
         game = Game(
@@ -0,0 +1,106 @@
+# October 2020, Lewis Gaul
+
+"""
+Test the mgb module.
+
+"""
+
+import json
+import pathlib
+import tempfile
+
+import pytest
+
+from minegauler import ROOT_DIR
+from minegauler.core import mgb
+from minegauler.core.board import Minefield
+
+
+@pytest.fixture
+def tmpdir() -> pathlib.Path:
+    with tempfile.TemporaryDirectory() as tmpdir:
+        yield pathlib.Path(tmpdir)
+
+
+def _assert_minefields_equal(mf1: Minefield, mf2: Minefield):
+    assert mf1.x_size == mf2.x_size
+    assert mf1.y_size == mf2.y_size
+    assert mf1.per_cell == mf2.per_cell
+    assert mf1.cells == mf2.cells
+    assert mf1.nr_mines == mf2.nr_mines
+    assert sorted(mf1.mine_coords) == sorted(mf2.mine_coords)
+    assert mf1.completed_board == mf2.completed_board
+    assert mf1.opening_ids == mf2.opening_ids
+    assert mf1.opening_idxs == mf2.opening_idxs
+    assert mf1.openings == mf2.openings
+    assert mf1.bbbv == mf2.bbbv
+
+
+class TestMGB:
+    """Test saving and loading minefield files."""
+
+    def test_save_load(self, tmpdir):
+        """Test saving and loading minefields, with and without precomputed info."""
+        path = tmpdir / "board.mgb"
+        for x_size, y_size, mines, per_cell in [
+            (1, 1, 0, 1),
+            (8, 8, 10, 1),
+            (30, 16, 99, 2),
+            (7, 9, 60, 3),
+            (5, 5, 100, 10),
+            (5, 5, 1000, 50),
+        ]:
+            mf = Minefield(x_size, y_size, mines=mines, per_cell=per_cell, seed=1)
+            for include_precomputed in [True, False]:
+                mgb.save_minefield(mf, path, include_precomputed=include_precomputed)
+                with open(path, "rb") as f:
+                    assert f.read(4) == mgb.MAGIC
+                _assert_minefields_equal(mgb.load_minefield(path), mf)
+                _assert_minefields_equal(
+                    mgb.load_minefield(path, use_precomputed=False), mf
+                )
+
+    def test_packed_size(self, tmpdir):
+        """Test mine counts are packed into 2 bits per cell."""
+        path = tmpdir / "board.mgb"
+        mf = Minefield(100, 100, mines=2000, per_cell=3, seed=1)
+        mgb.save_minefield(mf, path, include_precomputed=False)
+        assert path.stat().st_size == 24 + 100 * 100 // 4
+
+    def test_load_json(self, tmpdir):
+        """Test loading the legacy JSON format."""
+        mf = mgb.load_minefield(ROOT_DIR / "boards" / "sample.mgb")
+        assert (mf.x_size, mf.y_size, mf.per_cell, mf.nr_mines) == (8, 8, 3, 19)
+
+        path = tmpdir / "board.mgb"
+        mf = Minefield(6, 5, mines=12, per_cell=2, seed=1)
+        with open(path, "w") as f:
+            json.dump(mf.to_json(), f)
+        _assert_minefields_equal(mgb.load_minefield(path), mf)
+
+    def test_invalid(self, tmpdir):
+        """Test loading invalid files."""
+        path = tmpdir / "board.mgb"
+        mf = Minefield(8, 8, mines=10, seed=1)
+        mgb.save_minefield(mf, path)
+        data = path.read_bytes()
+
+        # Truncated.
+        path.write_bytes(data[:-1])
+        with pytest.raises(ValueError):
+            mgb.load_minefield(path)
+
+        # Unknown version.
+        path.write_bytes(data[:4] + b"\x03" + data[5:])
+        with pytest.raises(ValueError):
+            mgb.load_minefield(path)
+
+        # Too many mines in a cell for per_cell.
+        path.write_bytes(data[:24] + b"\xff" + data[25:])
+        with pytest.raises(ValueError):
+            mgb.load_minefield(path)
+
+        # Not JSON.
+        path.write_text("not a minefield")
+        with pytest.raises(ValueError):
+            mgb.load_minefield(path)
@@ -0,0 +1,87 @@
+# October 2020, Lewis Gaul
+
+"""
+Test the simulate module.
+
+"""
+
+import logging
+import random
+
+from minegauler.core import simulate
+from minegauler.core.simulate import (
+    GameResult,
+    SimulationConfig,
+    SimulationStats,
+    play_game,
+    run_simulation,
+)
+from minegauler.shared.types import Difficulty
+
+
+logger = logging.getLogger(__name__)
+
+
+class TestSimulate:
+    """Test running simulated games."""
+
+    def test_play_game(self):
+        """Test playing single games with each strategy."""
+        for strategy in simulate.STRATEGIES.values():
+            config = SimulationConfig.from_difficulty(
+                Difficulty.BEGINNER, strategy=strategy
+            )
+            result = play_game(config, random.Random(1))
+            assert result.bbbv > 0
+            assert result.clicks > 0
+            assert 0 <= result.prop_complete <= 1
+            assert result.won == (result.prop_complete == 1)
+            # The same RNG seed reproduces the game.
+            assert play_game(config, random.Random(1)).clicks == result.clicks
+
+        # A board with no mines is won with a single click.
+        config = SimulationConfig(4, 4, 0)
+        result = play_game(config, random.Random(1))
+        assert result.won is True
+        assert result.bbbv == 1
+        assert result.clicks == 1
+
+    def test_stats(self):
+        """Test aggregating game results."""
+        stats = SimulationStats()
+        stats.add_result(GameResult(True, 10, 1, 12, 0.5))
+        stats.add_result(GameResult(False, 20, 0.5, 4, 0.1))
+        assert stats.games == 2
+        assert stats.win_rate == 0.5
+        assert stats.mean_bbbv == 15
+        assert stats.mean_clicks == 8
+        assert stats.mean_prop_complete == 0.75
+        assert stats.bbbv_counts == {10: 1, 20: 1}
+
+        other = SimulationStats()
+        other.add_result(GameResult(True, 10, 1, 10, 0.2))
+        stats.merge(other)
+        assert stats.games == 3
+        assert stats.wins == 2
+        assert stats.clicks == 26
+        assert stats.bbbv_counts == {10: 2, 20: 1}
+
+    def test_run_simulation(self):
+        """Test running games in batches, in process and with a worker pool."""
+        config = SimulationConfig(8, 8, 10, per_cell=2)
+        games = []
+        for stats in run_simulation(config, 25, processes=1, batch_size=10, seed=3):
+            games.append(stats.games)
+        assert games == [10, 20, 25]
+        assert stats.seed == 3
+        assert sum(stats.bbbv_counts.values()) == 25
+
+        # Results don't depend on how batches are spread across processes.
+        for pool_stats in run_simulation(
+            config, 25, processes=2, batch_size=10, seed=3
+        ):
+            pass
+        assert pool_stats.games == 25
+        assert pool_stats.wins == stats.wins
+        assert pool_stats.clicks == stats.clicks
+        assert pool_stats.bbbv_counts == stats.bbbv_counts
@@ -0,0 +1,103 @@
+# October 2020, Lewis Gaul
+
+"""
+Test the solver module.
+
+"""
+
+import itertools
+import logging
+import math
+import random
+
+import pytest
+
+from minegauler.core.board import Board
+from minegauler.core.game import Game
+from minegauler.core.solver import ProbabilitySolver
+from minegauler.shared.types import CellContents
+
+
+logger = logging.getLogger(__name__)
+
+
+def _brute_force(board: Board, mines: int, per_cell: int):
+    """Calculate probabilities by trying every placement of mines in slots."""
+    cells = [CellContents.from_code(c) for c in board.cells]
+    unknown = [i for i, c in enumerate(cells) if type(c) is not CellContents.Num]
+    slots = [i for i in unknown for _ in range(per_cell)]
+    mine_counts = [0] * len(cells)
+    total = 0
+    for combo in itertools.combinations(slots, mines):
+        counts = [0] * len(cells)
+        for i in combo:
+            counts[i] += 1
+        if all(
+            sum(counts[j] for j in board.get_nbr_idxs(i)) == c.num
+            for i, c in enumerate(cells)
+            if type(c) is CellContents.Num
+        ):
+            total += 1
+            for i in unknown:
+                mine_counts[i] += counts[i] > 0
+    return [n / total for n in mine_counts]
+
+
+class TestProbabilitySolver:
+    """Test the probability solver."""
+
+    def test_simple_boards(self):
+        """Test boards with easily calculated probabilities."""
+        board = Board.from_2d_array([[1, 1], ["#", "#"]])
+        solver = ProbabilitySolver(board, mines=1)
+        assert solver.get_frontier_probabilities() == pytest.approx(
+            {(0, 1): 0.5, (1, 1): 0.5}
+        )
+        assert math.isnan(solver.get_interior_probability())
+        assert solver.get_probability((0, 0)) == 0
+
+        # The global mine count determines the interior probability.
+        board = Board.from_2d_array([["#", 1, "#", "#"]])
+        solver = ProbabilitySolver(board, mines=1)
+        assert solver.get_probabilities().cells == pytest.approx([0.5, 0, 0.5, 0])
+        solver = ProbabilitySolver(board, mines=2)
+        assert solver.get_probabilities().cells == pytest.approx([0.5, 0, 0.5, 1])
+
+        # Revealed mines count towards the numbers and the total.
+        board = Board.from_2d_array([["!1", 1, "#", "#"]])
+        solver = ProbabilitySolver(board, mines=2)
+        assert solver.get_probabilities().cells == [1, 0, 0, 1]
+
+    def test_matches_brute_force(self):
+        """Test against exhaustive enumeration, including multiple per cell."""
+        boards = [
+            (Board.from_2d_array([[1, "#", "#"], ["#", "#", "#"]]), 2, 1),
+            (Board.from_2d_array([["#", 2, "#", "#"], ["#", "#", "#", "#"]]), 3, 1),
+            (Board.from_2d_array([[1, 2, "#", "#"], ["#", "#", "#", 1]]), 2, 1),
+            (Board.from_2d_array([[2, "#", "#"], ["#", "#", "#"]]), 3, 2),
+            (Board.from_2d_array([[3, "#", 1], ["#", "#", "#"]]), 3, 2),
+        ]
+        for board, mines, per_cell in boards:
+            solver = ProbabilitySolver(board, mines=mines, per_cell=per_cell)
+            assert solver.get_probabilities().cells == pytest.approx(
+                _brute_force(board, mines, per_cell)
+            )
+
+    def test_incremental_updates(self):
+        """Test updating with cell updates matches solving from scratch."""
+        rng = random.Random(1)
+        for per_cell in [1, 2]:
+            game = Game(x_size=16, y_size=16, mines=40, per_cell=per_cell, seed=1)
+            solver = ProbabilitySolver(game.board, mines=40, per_cell=per_cell)
+            solver.update(game.select_cell((8, 8)))
+            for _ in range(10):
+                if game.state.finished():
+                    break
+                probs = solver.get_frontier_probabilities()
+                safest = min(probs.values())
+                coord = rng.choice([c for c, p in probs.items() if p == safest])
+                solver.update(game.select_cell(coord))
+                fresh = ProbabilitySolver(game.board, mines=40, per_cell=per_cell)
+                assert solver.get_probabilities().cells == pytest.approx(
+                    fresh.get_probabilities().cells
+                )
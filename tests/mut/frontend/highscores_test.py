@@ -5,11 +5,15 @@ Tests for the frontend highscores module (model/view).
 
 """
 
+from unittest import mock
+
 import pytest
 from PyQt5.QtCore import Qt
 
+from minegauler.frontend import highscores
 from minegauler.frontend.highscores import HighscoresModel
 from minegauler.frontend.state import HighscoreWindowState
+from minegauler.shared.highscores import HighscoreSettingsStruct, HighscoreStruct
 
 
 @pytest.fixture
@@ -40,3 +44,38 @@ class TestHighscoresModel:
             model.headerData(i, Qt.Vertical, Qt.DisplayRole).value() for i in range(10)
         ]
         assert row_indices == [str(x + 1) for x in range(10)]
+
+    @mock.patch("minegauler.shared.highscores.get_leaderboard")
+    def test_cached_lazy_rows(self, mock_get_leaderboard, hs_win_state):
+        """Test highscores are cached per group and rows fetched lazily."""
+        settings = HighscoreSettingsStruct.get_default()
+        data = [
+            HighscoreStruct("B", 1, False, f"NAME{i}", 1234, 3.0 + i, 5, 1.0, 0.0)
+            for i in range(250)
+        ]
+        mock_get_leaderboard.return_value = data
+        highscores.clear_highscores_cache()
+        model = HighscoresModel(None, hs_win_state)
+        model.update_highscores_group(settings)
+        assert model.rowCount() == model._FETCH_BATCH_SIZE
+        assert model.canFetchMore()
+        model.fetchMore()
+        model.fetchMore()
+        assert model.rowCount() == 250
+        assert not model.canFetchMore()
+
+        # Switching back to a group uses the cache.
+        model.update_highscores_group(HighscoreSettingsStruct("I", 1, False))
+        model.update_highscores_group(settings)
+        assert mock_get_leaderboard.call_count == 2
+
+        # New highscores are added to the cached ranking.
+        new_best = HighscoreStruct("B", 1, False, "name3", 1235, 1.0, 5, 1.0, 0.0)
+        highscores.cache_new_highscore(new_best)
+        hs_win_state.current_highscore = new_best
+        model.filter_and_sort()
+        assert mock_get_leaderboard.call_count == 2
+        assert model._get_active_row() == 0
+        assert model.data(model.index(0, 0), Qt.DisplayRole).value() == "name3"
+        assert model.data(model.index(4, 0), Qt.DisplayRole).value() == "NAME4"
+        highscores.clear_highscores_cache()
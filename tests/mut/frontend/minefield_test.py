@@ -14,8 +14,9 @@ from PyQt5.QtGui import QMouseEvent
 from pytestqt.qtbot import QtBot
 
 from minegauler.core import api
-from minegauler.frontend import state
+from minegauler.frontend import minefield, state
 from minegauler.frontend.minefield import _RAISED_CELL, _SUNKEN_CELL, MinefieldWidget
+from minegauler.shared.types import CellContents, CellImageType
 
 from . import utils
 
@@ -74,6 +75,69 @@ class TestMinefieldWidget:
         widget.show()
         utils.maybe_stop_for_interaction(qtbot)
 
+    def test_persistent_cell_items(self, mf_widget: MinefieldWidget):
+        """
+        Test each cell has a single scene item, which is reused.
+        """
+        nr_cells = self.state.x_size * self.state.y_size
+        mf_widget.flush_all_cell_images()
+        assert len(mf_widget._scene.items()) == nr_cells
+        for _ in range(3):
+            mf_widget.reset()
+            mf_widget.update_cells({(0, 0): CellContents.Num(1)})
+            mf_widget.update_style(CellImageType.BUTTONS, "standard")
+            mf_widget.flush_all_cell_images()
+        assert len(mf_widget._scene.items()) == nr_cells
+
+    def test_cell_images_coalesced(self, mf_widget: MinefieldWidget):
+        """
+        Test cell image updates are merged and applied on flush.
+        """
+        mf_widget.flush_all_cell_images()
+        item = mf_widget._cell_items[(0, 0)]
+        item.setPixmap = Mock(wraps=item.setPixmap)
+        mf_widget.update_cells({(0, 0): CellContents.Num(1)})
+        mf_widget.update_cells({(0, 0): CellContents.Num(2)})
+        item.setPixmap.assert_not_called()
+        assert mf_widget._flush_timer.isActive()
+
+        mf_widget.flush_cell_images()
+        item.setPixmap.assert_called_once_with(
+            mf_widget._cell_images[CellContents.Num(2)]
+        )
+        assert not mf_widget._flush_timer.isActive()
+        # No change if the cell is set back before the next flush.
+        mf_widget.update_cells({(0, 0): CellContents.Num(1)})
+        mf_widget.update_cells({(0, 0): CellContents.Num(2)})
+        mf_widget.flush_cell_images()
+        assert item.setPixmap.call_count == 1
+
+    def test_cell_images_cached(self, qtbot: QtBot, tmp_path, monkeypatch):
+        """
+        Test cell images are cached in memory and on disk.
+        """
+        monkeypatch.setattr(minefield, "CACHE_DIR", tmp_path)
+        monkeypatch.setattr(minefield, "_cell_images_cache", {})
+        make_atlas = Mock(wraps=minefield._make_atlas)
+        monkeypatch.setattr(minefield, "_make_atlas", make_atlas)
+
+        images = minefield._get_cell_images(CellImageType.MARKERS, "standard", 20)
+        assert make_atlas.call_count == 1
+        assert len(list(tmp_path.iterdir())) == 1
+        assert images[CellContents.Flag(1)].width() == 20
+        # Cached in memory.
+        assert (
+            minefield._get_cell_images(CellImageType.MARKERS, "standard", 20)
+            is images
+        )
+        # Cached on disk.
+        minefield._cell_images_cache.clear()
+        minefield._get_cell_images(CellImageType.MARKERS, "standard", 20)
+        assert make_atlas.call_count == 1
+        # Different size.
+        minefield._get_cell_images(CellImageType.MARKERS, "standard", 30)
+        assert make_atlas.call_count == 2
+
     def test_leftclick_no_drag(self, qtbot: QtBot, mf_widget: MinefieldWidget):
         """
         Test left-clicks with drag select off.
@@ -6,17 +6,26 @@ Tests for the highscores module.
 """
 
 import pathlib
+import sqlite3
 import tempfile
 from unittest import mock
 
+import attr
+import mysql.connector
 import pytest
+import requests
 
 from minegauler.shared.highscores import (
+    DBConnectionError,
     HighscoresDatabases,
     HighscoreSettingsStruct,
     HighscoreStruct,
     LocalHighscoresDB,
+    RemoteHighscoresDB,
+    _RemoteUploader,
+    filter_and_sort,
     get_highscores,
+    is_highscore_new_best,
 )
 from minegauler.shared.types import Difficulty
 
@@ -42,14 +51,64 @@ class TestLocalHighscoreDatabase:
         """Test creating a new highscores DB."""
         db = LocalHighscoresDB(tmp_local_db_path)
         assert db._path == tmp_local_db_path
-        assert db.get_db_version() == 0
+        assert db.get_db_version() == 4
         tables = list(
             db.execute(
                 "SELECT name FROM sqlite_master "
                 "WHERE type='table' AND name NOT LIKE 'sqlite_%'"
             )
         )
-        assert list(tables) == [("highscores",)]
+        assert sorted(tables) == [
+            ("highscores",),
+            ("personal_bests",),
+            ("remote_outbox",),
+        ]
+
+    def test_migrate_db(self, tmp_local_db_path):
+        """Test migrating a version 0 highscores DB."""
+        conn = sqlite3.connect(str(tmp_local_db_path))
+        conn.execute(LocalHighscoresDB._CREATE_TABLE_SQL)
+        conn.execute("PRAGMA user_version = 0")
+        # Include a duplicate, which gets removed.
+        for _ in range(2):
+            conn.execute(
+                "INSERT INTO highscores (difficulty, per_cell, drag_select, name, "
+                "timestamp, elapsed, bbbv, bbbvps, flagging) "
+                "VALUES ('B', 1, 0, 'Siwel G', 1234, 3.0, 5, 1.67, 0.0)"
+            )
+        conn.commit()
+        conn.close()
+
+        db = LocalHighscoresDB(tmp_local_db_path)
+        assert db.get_db_version() == 4
+        indexes = {
+            r[0]
+            for r in db.execute(
+                "SELECT name FROM sqlite_master "
+                "WHERE type='index' AND name NOT LIKE 'sqlite_%'"
+            )
+        }
+        assert indexes == {
+            "idx_highscores_settings_elapsed",
+            "idx_highscores_settings_bbbvps",
+            "idx_highscores_name_lower",
+            "idx_highscores_natural_key",
+        }
+        assert db.get_highscores(name="siwel g") == [
+            HighscoreStruct("B", 1, False, "Siwel G", 1234, 3.0, 5, 1.67, 0.0)
+        ]
+        # Check the index is used for filtering on settings.
+        sql, params = db._get_select_highscores_sql(
+            difficulty=Difficulty.BEGINNER, per_cell=1, drag_select=False
+        )
+        plan = " ".join(
+            str(r[-1]) for r in db.execute("EXPLAIN QUERY PLAN " + sql, params)
+        )
+        assert "idx_highscores_settings_elapsed" in plan
+        # Personal bests are filled in from existing highscores.
+        assert db.get_personal_best(
+            HighscoreSettingsStruct("B", 1, False), "SIWEL G"
+        ) == (3.0, 1.67)
 
     def test_insert_count_get(self, tmp_local_db_path):
         """Test inserting, counting and getting highscores."""
@@ -100,6 +159,142 @@ class TestLocalHighscoreDatabase:
         # Case insensitive name match.
         assert db.get_highscores(name="SIWel g") == [my_hs]
 
+    def test_get_leaderboard(self, tmp_local_db_path):
+        """Test getting the best highscore for each player."""
+        db = LocalHighscoresDB(tmp_local_db_path)
+        all_highscores = [
+            HighscoreStruct("B", 1, False, "NAME1", 1234, 3.00, 5, 1.67, 0.0),
+            HighscoreStruct("B", 1, False, "name1", 1234, 2.00, 3, 1.50, 0.5),
+            HighscoreStruct("B", 1, False, "NAME2", 1234, 3.11, 8, 2.57, 0.0),
+            HighscoreStruct("B", 1, False, "NAME3", 1234, 3.11, 9, 2.89, 0.0),
+            HighscoreStruct("B", 1, True, "NAME4", 1234, 1.00, 5, 5.00, 0.0),
+            HighscoreStruct("I", 1, False, "NAME4", 1234, 1.00, 5, 5.00, 0.0),
+        ]
+        for hs in all_highscores:
+            db.insert_highscore(hs)
+        settings = dict(difficulty=Difficulty.BEGINNER, per_cell=1, drag_select=False)
+        group = db.get_highscores(**settings)
+        assert len(group) == 4
+
+        for sort_by in ["time", "3bv/s"]:
+            for flagging in [None, "F", "NF"]:
+                exp = filter_and_sort(group, sort_by, {"flagging": flagging})
+                assert (
+                    db.get_leaderboard(**settings, sort_by=sort_by, flagging=flagging)
+                    == exp
+                )
+        assert [h.name for h in db.get_leaderboard(**settings)] == [
+            "name1",
+            "NAME3",
+            "NAME2",
+        ]
+        assert [h.name for h in db.get_leaderboard(**settings, sort_by="3bv/s")] == [
+            "NAME3",
+            "NAME2",
+            "NAME1",
+        ]
+        # Limit and offset.
+        assert [h.name for h in db.get_leaderboard(**settings, limit=1, offset=1)] == [
+            "NAME3"
+        ]
+        assert [h.name for h in db.get_leaderboard(**settings, offset=2)] == ["NAME2"]
+
+    def test_personal_best(self, tmp_local_db_path):
+        """Test personal bests are kept up to date."""
+        db = LocalHighscoresDB(tmp_local_db_path)
+        settings = HighscoreSettingsStruct("B", 1, False)
+        assert db.get_personal_best(settings, "NAME1") is None
+
+        db.insert_highscore(
+            HighscoreStruct("B", 1, False, "NAME1", 1234, 3.00, 5, 1.67, 0.0)
+        )
+        assert db.get_personal_best(settings, "name1") == (3.00, 1.67)
+        # Better 3bv/s only.
+        db.insert_highscore(
+            HighscoreStruct("B", 1, False, "name1", 1234, 4.00, 10, 2.50, 0.0)
+        )
+        assert db.get_personal_best(settings, "NAME1") == (3.00, 2.50)
+        # Better time only.
+        db.insert_highscore(
+            HighscoreStruct("B", 1, False, "NAME1", 1234, 2.00, 2, 1.00, 0.0)
+        )
+        assert db.get_personal_best(settings, "NAME1") == (2.00, 2.50)
+        # Different settings and names are separate.
+        db.insert_highscore(
+            HighscoreStruct("B", 1, True, "NAME1", 1234, 1.00, 5, 5.00, 0.0)
+        )
+        db.insert_highscore(
+            HighscoreStruct("B", 1, False, "NAME2", 1234, 1.00, 5, 5.00, 0.0)
+        )
+        assert db.get_personal_best(settings, "NAME1") == (2.00, 2.50)
+
+        with mock.patch.object(
+            HighscoresDatabases, "get_db_instance", return_value=db
+        ):
+            for hs, exp in [
+                (HighscoreStruct("B", 1, False, "NAME1", 1, 2.0, 2, 1.0, 0.0), "time"),
+                (HighscoreStruct("B", 1, False, "NAME1", 1, 3.0, 8, 2.6, 0.0), "3bv/s"),
+                (HighscoreStruct("B", 1, False, "NAME1", 1, 3.0, 5, 1.7, 0.0), None),
+                (HighscoreStruct("I", 1, False, "NAME1", 1, 9.0, 5, 0.5, 0.0), "time"),
+            ]:
+                assert is_highscore_new_best(hs) == exp
+                group = db.get_highscores(
+                    difficulty=hs.difficulty, per_cell=1, drag_select=False
+                )
+                assert is_highscore_new_best(hs, group) == exp
+
+    def test_get_highscores_page(self, tmp_local_db_path):
+        """Test paginating through highscores."""
+        db = LocalHighscoresDB(tmp_local_db_path)
+        assert db.get_latest_highscore_id() is None
+        assert db.get_highscores_page(limit=2) == []
+        highscores = [
+            HighscoreStruct("B", 1, False, "NAME", 1234 + i, elapsed, 5, 1.67, 0.0)
+            for i, elapsed in enumerate([5.0, 3.0, 4.0, 3.0, 6.0])
+        ]
+        for h in highscores:
+            db.insert_highscore(h)
+        highscores.append(
+            HighscoreStruct("I", 1, False, "NAME", 1234, 1.0, 5, 1.67, 0.0)
+        )
+        db.insert_highscore(highscores[-1])
+        assert db.get_latest_highscore_id() == 6
+
+        pages = []
+        after = None
+        while True:
+            page = db.get_highscores_page(
+                difficulty=Difficulty.BEGINNER, after=after, limit=2
+            )
+            if not page:
+                break
+            pages.append([i for i, _ in page])
+            after = (page[-1][1].elapsed, page[-1][0])
+        # Ties on time are ordered by ID.
+        assert pages == [[2, 4], [3, 1], [5]]
+        assert db.get_highscores_page(name="name", limit=1) == [(6, highscores[5])]
+
+    def test_outbox(self, tmp_local_db_path):
+        """Test queueing highscores to be posted to the remote server."""
+        db = LocalHighscoresDB(tmp_local_db_path)
+        highscores = [
+            HighscoreStruct("B", 1, False, "NAME", 1234, 3.0 + i, 5, 1.67, 0.0)
+            for i in range(3)
+        ]
+        db.insert_highscore(
+            HighscoreStruct("B", 1, False, "NAME", 1234, 2.0, 5, 1.67, 0.0)
+        )
+        for h in highscores:
+            db.insert_highscore(h, upload=True)
+        assert db.count_highscores() == 4
+
+        outbox = db.get_outbox(2)
+        assert [h for _, h in outbox] == highscores[:2]
+        db.remove_from_outbox([outbox[0][0]])
+        # Outbox persists across connections.
+        db = LocalHighscoresDB(tmp_local_db_path)
+        assert [h for _, h in db.get_outbox(10)] == highscores[1:]
+
     def test_merge_db(self, tmpdir):
         """Test merging DBs together."""
         # Setup
@@ -135,15 +330,36 @@ class TestLocalHighscoreDatabase:
         assert merge_db.get_highscores() == merge_highscores
 
         # Merge
-        base_db.merge_highscores(merge_db.path)
+        assert base_db.merge_highscores(merge_db.path) == 3
         combined_highscores = sorted(
             set(base_highscores) | set(merge_highscores), key=lambda h: h.elapsed
         )
         assert base_db.count_highscores() == len(combined_highscores)
         assert base_db.get_highscores() == combined_highscores
+        assert base_db.get_personal_best(
+            HighscoreSettingsStruct("B", 1, False), "blob"
+        ) == (4.11, 1.56)
         assert merge_db.count_highscores() == len(merge_highscores)
         assert merge_db.get_highscores() == merge_highscores
 
+        # Merging again is a no-op.
+        assert base_db.merge_highscores(merge_db.path) == 0
+        assert base_db.get_highscores() == combined_highscores
+
+    def test_insert_highscores(self, tmp_local_db_path):
+        """Test inserting highscores in bulk."""
+        db = LocalHighscoresDB(tmp_local_db_path)
+        highscores = [
+            HighscoreStruct("B", 1, False, "NAME", 1234 + i, 3.0 + i, 5, 1.67, 0.0)
+            for i in range(3)
+        ]
+        assert db.insert_highscores(highscores[:2]) == 2
+        assert db.insert_highscores(highscores) == 1
+        assert db.get_highscores() == highscores
+        assert db.get_personal_best(
+            HighscoreSettingsStruct("B", 1, False), "name"
+        ) == (3.0, 1.67)
+
     def test_merge_db_into_itself_error(self, tmp_local_db_path):
         """Test error is raised when trying to merge DB into itself."""
         db = LocalHighscoresDB(tmp_local_db_path)
@@ -151,6 +367,178 @@ class TestLocalHighscoreDatabase:
             db.merge_highscores(db.path)
 
 
+class TestRemoteHighscoreDatabase:
+    """Tests for the remote highscores DB connection handling."""
+
+    @pytest.fixture
+    def mock_connect(self):
+        with mock.patch.multiple(
+            RemoteHighscoresDB, _pool=None, _POOL_SIZE=5, _POOL_TIMEOUT=10
+        ), mock.patch.object(mysql.connector, "connect") as mock_connect:
+            mock_connect.side_effect = lambda **_: mock.MagicMock()
+            yield mock_connect
+
+    def test_connection_reuse(self, mock_connect):
+        """Test connections are checked out per operation and reused."""
+        RemoteHighscoresDB().count_highscores()
+        RemoteHighscoresDB().count_highscores()
+        assert mock_connect.call_count == 1
+        stats = RemoteHighscoresDB.pool_stats()
+        assert stats["checkouts"] == 2
+        assert stats["open"] == stats["idle"] == 1
+        assert stats["in_use"] == 0
+
+        # A stale connection is replaced on checkout.
+        RemoteHighscoresDB._pool._idle[0].is_connected.return_value = False
+        RemoteHighscoresDB().count_highscores()
+        assert mock_connect.call_count == 2
+        assert RemoteHighscoresDB.pool_stats()["stale"] == 1
+        assert RemoteHighscoresDB.pool_stats()["open"] == 1
+
+    def test_retry_on_lost_connection(self, mock_connect):
+        """Test a command is retried once on a new connection."""
+        db = RemoteHighscoresDB()
+        with db._connection():
+            first_conn = db.conn
+            first_conn.cursor.side_effect = mysql.connector.OperationalError
+            db.execute("SELECT 1")
+            assert db.conn is not first_conn
+            first_conn.close.assert_called_once()
+
+            # No retry within a transaction.
+            db.conn.cursor.side_effect = mysql.connector.OperationalError
+            with pytest.raises(DBConnectionError):
+                db.execute("SELECT 1")
+        assert mock_connect.call_count == 2
+        assert RemoteHighscoresDB.pool_stats()["reconnects"] == 1
+
+    def test_pool_exhausted(self, mock_connect):
+        """Test checkout times out when all connections are in use."""
+        RemoteHighscoresDB.configure_pool(max_size=1, timeout=0.01)
+        with RemoteHighscoresDB()._connection():
+            with pytest.raises(DBConnectionError):
+                RemoteHighscoresDB().count_highscores()
+        RemoteHighscoresDB().count_highscores()
+        assert RemoteHighscoresDB.pool_stats()["timeouts"] == 1
+
+
+class TestRemoteUploader:
+    """Tests for posting highscores to the remote server."""
+
+    def test_upload_batch(self, tmp_local_db_path):
+        """Test posting batches of highscores from the outbox."""
+        db = LocalHighscoresDB(tmp_local_db_path)
+        highscores = [
+            HighscoreStruct("B", 1, False, "NAME", 1234, 3.0 + i, 5, 1.67, 0.0)
+            for i in range(5)
+        ]
+        for h in highscores:
+            db.insert_highscore(h, upload=True)
+        uploader = _RemoteUploader(tmp_local_db_path)
+        uploader.BATCH_SIZE = 3
+        session = mock.Mock()
+
+        # Server fails part way through the batch.
+        session.post.return_value.status_code = 503
+        session.post.return_value.json.return_value = {"processed": 1}
+        session.post.return_value.raise_for_status.side_effect = requests.HTTPError
+        with pytest.raises(requests.HTTPError):
+            uploader.upload_batch(db, session)
+        assert session.post.call_args[1]["json"] == [
+            attr.asdict(h) for h in highscores[:3]
+        ]
+        assert [h for _, h in db.get_outbox(10)] == highscores[1:]
+
+        # Full batch succeeds, leaving more to post.
+        session.post.return_value.status_code = 200
+        session.post.return_value.raise_for_status.side_effect = None
+        assert uploader.upload_batch(db, session) is False
+        assert [h for _, h in db.get_outbox(10)] == highscores[4:]
+
+        # Final partial batch empties the outbox.
+        assert uploader.upload_batch(db, session) is True
+        assert db.get_outbox(10) == []
+        assert session.post.call_count == 3
+        assert uploader.upload_batch(db, session) is True
+        assert session.post.call_count == 3
+
+
+    @staticmethod
+    def _response(status_code: int, json=None) -> mock.Mock:
+        response = mock.Mock(status_code=status_code)
+        response.json.return_value = json
+        if status_code >= 400:
+            response.raise_for_status.side_effect = requests.HTTPError
+        else:
+            response.raise_for_status.side_effect = None
+        return response
+
+    def test_upload_mixed_batch(self, tmp_local_db_path):
+        """Test a batch containing invalid highscores only drops those."""
+        db = LocalHighscoresDB(tmp_local_db_path)
+        highscores = [
+            HighscoreStruct("B", 1, False, "NAME", 1234, 3.0 + i, 5, 1.67, 0.0)
+            for i in range(6)
+        ]
+        uploader = _RemoteUploader(tmp_local_db_path)
+        session = mock.Mock()
+
+        # Server skips the invalid highscore and stores the rest.
+        for h in highscores[:3]:
+            db.insert_highscore(h, upload=True)
+        session.post.return_value = self._response(
+            200, {"processed": 3, "rejected": [1]}
+        )
+        assert uploader.upload_batch(db, session) is True
+        assert db.get_outbox(10) == []
+
+        # An older server rejecting the whole batch leads to individual
+        #  posts, with only the invalid highscore dropped.
+        for h in highscores[3:]:
+            db.insert_highscore(h, upload=True)
+        session.post.reset_mock()
+        session.post.side_effect = [
+            self._response(400),
+            self._response(200),
+            self._response(400),
+            self._response(200),
+        ]
+        assert uploader.upload_batch(db, session) is True
+        assert db.get_outbox(10) == []
+        assert session.post.call_count == 4
+        assert [c[1]["json"] for c in session.post.call_args_list[1:]] == [
+            attr.asdict(h) for h in highscores[3:]
+        ]
+
+    def test_upload_retryable_errors(self, tmp_local_db_path):
+        """Test highscores are kept when the server can't take them yet."""
+        db = LocalHighscoresDB(tmp_local_db_path)
+        highscores = [
+            HighscoreStruct("B", 1, False, "NAME", 1234, 3.0 + i, 5, 1.67, 0.0)
+            for i in range(3)
+        ]
+        for h in highscores:
+            db.insert_highscore(h, upload=True)
+        uploader = _RemoteUploader(tmp_local_db_path)
+        session = mock.Mock()
+
+        for status in [408, 429]:
+            session.post.side_effect = [self._response(status)]
+            with pytest.raises(requests.HTTPError):
+                uploader.upload_batch(db, session)
+            assert [h for _, h in db.get_outbox(10)] == highscores
+
+        # No bulk endpoint, and the individual posts fail part way through.
+        session.post.side_effect = [
+            self._response(404),
+            self._response(200),
+            self._response(503),
+        ]
+        with pytest.raises(requests.HTTPError):
+            uploader.upload_batch(db, session)
+        assert [h for _, h in db.get_outbox(10)] == highscores[1:]
+
+
 class TestModuleAPIs:
     """
     Tests for the public module APIs.
@@ -0,0 +1,119 @@
+# October 2020, Lewis Gaul
+
+"""
+Test the live module.
+
+"""
+
+import logging
+
+import pytest
+
+from minegauler.shared import live
+from minegauler.shared.replay import Replay
+from minegauler.shared.types import CellContents
+
+
+logger = logging.getLogger(__name__)
+
+
+def _updates(n):
+    """Get updates for some cells along the top row of a board."""
+    return {(x, 0): CellContents.Num(x % 8) for x in range(n)}
+
+
+class TestLiveStream:
+    """Test encoding and decoding live streams."""
+
+    def test_round_trip(self):
+        """Test a spectator from the start sees every update."""
+        encoder = live.LiveEncoder(4, 3)
+        decoder = live.LiveDecoder()
+        assert encoder.flush() is not None  # initial keyframe
+        assert encoder.flush() is None
+
+        encoder.add_event(0, {(0, 0): CellContents.Flag(1)})
+        encoder.add_event(0.5, {(1, 1): CellContents.Num(2)})
+        encoder.add_metadata({"state": "ACTIVE"})
+        batch = encoder.flush()
+        assert not live.is_keyframe(batch)
+        # Ignored before the first keyframe.
+        assert decoder.feed(batch) == {}
+        assert not decoder.started
+
+        decoder = live.LiveDecoder()
+        encoder.request_keyframe()
+        batch = encoder.flush()
+        assert live.is_keyframe(batch)
+        assert len(decoder.feed(batch)) == 12
+        assert decoder.started
+        assert decoder.elapsed == 0.5
+        assert decoder.metadata == {"state": "ACTIVE"}
+
+        encoder.add_event(1.25, {(3, 2): CellContents.HitMine(1)})
+        assert decoder.feed(encoder.flush()) == {(3, 2): CellContents.HitMine(1)}
+        assert decoder.elapsed == 1.25
+        board = decoder.get_board()
+        assert board[0] == CellContents.Flag(1)
+        assert board[5] == CellContents.Num(2)
+        assert board[11] == CellContents.HitMine(1)
+
+    def test_late_joiner(self):
+        """Test joining from a keyframe gives the same board as from the start."""
+        encoder = live.LiveEncoder(8, 2, keyframe_interval=4)
+        batches = []
+        for i in range(10):
+            encoder.add_event(i / 10, {(i % 8, i // 8): CellContents.Num(i % 8)})
+            batches.append(encoder.flush())
+        keyframes = [i for i, b in enumerate(batches) if live.is_keyframe(b)]
+        assert keyframes == [0, 4, 8]
+
+        from_start = live.LiveDecoder()
+        for batch in batches:
+            from_start.feed(batch)
+        late = live.LiveDecoder()
+        for batch in batches[8:]:
+            late.feed(batch)
+        assert late.get_board() == from_start.get_board()
+        assert late.elapsed == from_start.elapsed == 0.9
+
+        # The stream from a keyframe up to the next is a valid replay log.
+        replay = Replay(b"".join(batches[4:8]))
+        assert (replay.x_size, replay.y_size) == (8, 2)
+        assert replay.nr_events == 3
+        assert replay.duration == 0.7
+        mid = live.LiveDecoder()
+        for batch in batches[:6]:
+            mid.feed(batch)
+        replay.seek_event(1)
+        assert replay.get_board() == mid.get_board()
+
+    def test_new_game(self):
+        """Test a new game starts with a keyframe of the new board size."""
+        encoder = live.LiveEncoder(4, 4)
+        decoder = live.LiveDecoder()
+        encoder.add_event(0, _updates(4))
+        decoder.feed(encoder.flush())
+        encoder.new_game(5, 2)
+        encoder.add_event(0, _updates(2))
+        batch = encoder.flush()
+        assert live.is_keyframe(batch)
+        decoder.feed(batch)
+        assert (decoder.x_size, decoder.y_size) == (5, 2)
+        assert decoder.get_board()[:3] == [
+            CellContents.Num(0),
+            CellContents.Num(1),
+            CellContents.Unclicked,
+        ]
+
+    def test_invalid(self):
+        """Test invalid batches are rejected."""
+        encoder = live.LiveEncoder(4, 4)
+        keyframe = encoder.flush()
+        decoder = live.LiveDecoder()
+        with pytest.raises(ValueError):
+            decoder.feed(keyframe[:-1])
+        assert not decoder.started
+        decoder.feed(keyframe)
+        with pytest.raises(ValueError):
+            decoder.feed(b"\xff")
@@ -0,0 +1,123 @@
+# October 2020, Lewis Gaul
+
+"""
+Test the metrics module.
+
+"""
+
+import logging
+import math
+
+import pytest
+
+from minegauler.shared import metrics
+
+
+logger = logging.getLogger(__name__)
+
+
+@pytest.fixture
+def enabled_metrics():
+    was_enabled = metrics.is_enabled()
+    metrics.enable()
+    metrics.reset()
+    yield
+    if not was_enabled:
+        metrics.disable()
+    metrics.reset()
+
+
+class TestHistogram:
+    """Test the Histogram class."""
+
+    def test_empty(self):
+        """Test a histogram with no samples."""
+        hist = metrics.Histogram()
+        assert hist.count == 0
+        assert math.isnan(hist.mean)
+        assert math.isnan(hist.percentile(50))
+
+    def test_percentiles(self):
+        """Test percentiles are estimated to within the bucket resolution."""
+        hist = metrics.Histogram()
+        for i in range(1, 1001):
+            hist.add(i / 1000)
+        assert hist.count == 1000
+        assert hist.mean == pytest.approx(0.5005)
+        assert hist.percentile(50) == pytest.approx(0.5, rel=0.1)
+        assert hist.percentile(90) == pytest.approx(0.9, rel=0.1)
+        assert hist.percentile(99) == pytest.approx(0.99, rel=0.1)
+        assert hist.percentile(100) == 1
+        assert hist.percentile(0) == 0.001
+
+    def test_extremes(self):
+        """Test values outside the bucket range are clamped to the samples."""
+        hist = metrics.Histogram()
+        hist.add(0)
+        hist.add(1e6)
+        assert hist.percentile(0) == 0
+        assert hist.percentile(100) == 1e6
+
+
+class TestRecording:
+    """Test recording metrics."""
+
+    def test_disabled(self, enabled_metrics):
+        """Test nothing is recorded when metrics are disabled."""
+        metrics.disable()
+
+        @metrics.timed("test.func")
+        def func(x):
+            return x + 1
+
+        assert func(1) == 2
+        with metrics.timer("test.block"):
+            pass
+        metrics.record("test.record", 1)
+        assert metrics.get_histograms() == {}
+
+    def test_enabled(self, enabled_metrics):
+        """Test recording with each of the hooks."""
+
+        @metrics.timed("test.func")
+        def func(x):
+            return x + 1
+
+        assert func(1) == 2
+        assert func(2) == 3
+        with metrics.timer("test.block", group="A"):
+            pass
+        metrics.record("test.record", 0.5)
+        hists = metrics.get_histograms()
+        assert set(hists) == {
+            ("test.func", None),
+            ("test.block", "A"),
+            ("test.record", None),
+        }
+        assert hists[("test.func", None)].count == 2
+        assert hists[("test.record", None)].total == 0.5
+
+        # Failing calls are still timed.
+        @metrics.timed("test.error")
+        def error():
+            raise ValueError
+
+        with pytest.raises(ValueError):
+            error()
+        assert metrics.get_histograms()[("test.error", None)].count == 1
+
+        metrics.reset()
+        assert metrics.get_histograms() == {}
+
+    def test_formatting(self, enabled_metrics):
+        """Test the report and Prometheus formats."""
+        assert metrics.format_report() == "No latency metrics recorded"
+        metrics.record("test.record", 0.002, group='say "hi"')
+        report = metrics.format_report()
+        assert 'test.record [say "hi"]' in report
+        prom = metrics.format_prometheus().splitlines()
+        assert "# TYPE minegauler_latency_seconds summary" in prom
+        assert (
+            'minegauler_latency_seconds_count{name="test.record",group="say \\"hi\\""}'
+            " 1"
+        ) in prom
@@ -0,0 +1,131 @@
+# October 2020, Lewis Gaul
+
+"""
+Tests for the replay module.
+
+"""
+
+import io
+import random
+
+import pytest
+
+from minegauler.shared import replay
+from minegauler.shared.replay import Replay, ReplayWriter
+from minegauler.shared.types import CellContents
+
+
+def _make_events(x_size, y_size, nr_events, *, seed=0):
+    """Create random events, as a list of (elapsed, updates)."""
+    rng = random.Random(seed)
+    states = [
+        CellContents.Unclicked,
+        CellContents.Num(0),
+        CellContents.Num(3),
+        CellContents.Num(24),
+        CellContents.Flag(1),
+        CellContents.Flag(3),
+        CellContents.WrongFlag(2),
+        CellContents.Mine(2),
+        CellContents.HitMine(1),
+    ]
+    coords = [(x, y) for x in range(x_size) for y in range(y_size)]
+    events = []
+    elapsed = 0
+    for _ in range(nr_events):
+        elapsed += rng.choice([0, 0.001, 0.05, 1.5])
+        updates = {
+            c: rng.choice(states) for c in rng.sample(coords, rng.randint(1, 10))
+        }
+        events.append((elapsed, updates))
+    return events
+
+
+def _replay_naively(x_size, y_size, events, up_to):
+    """Get the board after applying events up to the given time."""
+    board = {
+        (x, y): CellContents.Unclicked for x in range(x_size) for y in range(y_size)
+    }
+    for elapsed, updates in events:
+        if round(elapsed * 1000) > round(up_to * 1000):
+            break
+        board.update(updates)
+    return board
+
+
+class TestReplay:
+    """Test writing and reading replay logs."""
+
+    def test_cell_codes(self):
+        """Test encoding and decoding cell contents."""
+        for contents in [
+            CellContents.Unclicked,
+            CellContents.Num(0),
+            CellContents.Num(8),
+            CellContents.Mine(1),
+            CellContents.HitMine(2),
+            CellContents.Flag(10),
+            CellContents.WrongFlag(1),
+        ]:
+            assert replay.decode_cell(replay.encode_cell(contents)) is contents
+        assert replay.encode_cell(CellContents.Unclicked) == 0
+
+    def test_seek(self):
+        """Test seeking gives the board state of replaying up to that time."""
+        x_size, y_size = 7, 5
+        events = _make_events(x_size, y_size, 300)
+        buf = io.BytesIO()
+        with ReplayWriter(buf, x_size, y_size, keyframe_interval=16) as writer:
+            for elapsed, updates in events:
+                writer.add_event(elapsed, updates)
+            writer.add_metadata({"name": "NAME"})
+        game_replay = Replay(buf.getvalue())
+        assert (game_replay.x_size, game_replay.y_size) == (x_size, y_size)
+        assert game_replay.nr_events == 300
+        assert game_replay.duration == pytest.approx(events[-1][0])
+        assert game_replay.metadata == {"name": "NAME"}
+
+        # Track the displayed board using only the returned changes.
+        displayed = _replay_naively(x_size, y_size, [], 0)
+        rng = random.Random(1)
+        for _ in range(100):
+            t = rng.uniform(0, game_replay.duration)
+            displayed.update(game_replay.seek(t))
+            exp_board = _replay_naively(x_size, y_size, events, t)
+            board = game_replay.get_board()
+            for (x, y), contents in exp_board.items():
+                assert board[y * x_size + x] is contents
+                assert displayed[(x, y)] is contents
+            assert game_replay.elapsed <= t
+
+        game_replay.seek(0)
+        game_replay.seek_event(game_replay.nr_events)
+        assert game_replay.elapsed == pytest.approx(events[-1][0])
+
+    def test_truncated(self):
+        """Test a log with a truncated final record can be read."""
+        buf = io.BytesIO()
+        writer = ReplayWriter(buf, 3, 3)
+        writer.add_event(0, {(0, 0): CellContents.Num(1)})
+        writer.add_event(
+            1, {(1, 1): CellContents.Flag(1), (2, 2): CellContents.Num(2)}
+        )
+        data = buf.getvalue()
+        game_replay = Replay(data[:-2])
+        assert game_replay.nr_events == 1
+        game_replay.seek(10)
+        assert game_replay.get_board()[0] is CellContents.Num(1)
+
+        with pytest.raises(ValueError):
+            Replay(b"not a replay log")
+
+    def test_from_cell_updates(self):
+        """Test creating a replay from a list of cell updates."""
+        events = _make_events(4, 4, 20)
+        game_replay = Replay.from_cell_updates(4, 4, events, metadata={"a": 1})
+        assert game_replay.nr_events == 20
+        assert game_replay.metadata == {"a": 1}
+        game_replay.seek(events[-1][0])
+        board = game_replay.get_board()
+        for (x, y), contents in _replay_naively(4, 4, events, events[-1][0]).items():
+            assert board[y * 4 + x] is contents